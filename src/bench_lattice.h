@@ -0,0 +1,157 @@
+#ifndef BENCH_LATTICE_H
+#define BENCH_LATTICE_H
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include "doom_map.h"
+#include "space.h"
+
+// The synthetic map of the benchmarks, a lattice of square sectors 64 units wide with their
+// corners jittered up to 8 units. Every third cell can have a square pillar in it, and every fifth
+// pillar can share the lower left corner of its cell, so holes and loops meeting at a vertex
+// both occur. Every sector has a thing between its pillar and its right side. One sided lines
+// have their sector in front, as in DOOM, and every array of the records is filled.
+struct BenchLattice {
+	void AddLine (DoomMap& map, std::uint32_t v1, std::uint32_t v2, int front_sector, int back_sector) const {
+		static const std::uint64_t no_texture = DoomWad::LumpKey("-");
+		static const std::uint64_t wall_texture = DoomWad::LumpKey("STARTAN2");
+		
+		auto add_side = [&] (int sector) {
+			if(sector < 0) {
+				return DoomMap::no_index;
+			}
+			
+			map.sidedef_x_offset.push_back(0);
+			map.sidedef_y_offset.push_back(0);
+			map.sidedef_upper.push_back(no_texture);
+			map.sidedef_lower.push_back(no_texture);
+			map.sidedef_middle.push_back(back_sector < 0 ? wall_texture : no_texture);
+			map.sidedef_sector.push_back(sector);
+			return static_cast <std::uint32_t> (map.sidedef_sector.size() - 1);
+		};
+		
+		if(front_sector < 0) {
+			std::swap(v1, v2);
+			std::swap(front_sector, back_sector);
+		}
+		
+		// Blocking when one sided, two sided otherwise.
+		map.linedef_v1.push_back(v1);
+		map.linedef_v2.push_back(v2);
+		map.linedef_flags.push_back(back_sector < 0 ? 0x0001 : 0x0004);
+		map.linedef_special.push_back(0);
+		map.linedef_tag.push_back(0);
+		map.linedef_front.push_back(add_side(front_sector));
+		map.linedef_back.push_back(add_side(back_sector));
+		map.linedef_args.insert(map.linedef_args.end(), special_arg_count, 0);
+	}
+	
+	std::uint32_t AddVertex (DoomMap& map, float x, float y) const {
+		map.vertex_x.push_back(x);
+		map.vertex_y.push_back(y);
+		return map.vertex_x.size() - 1;
+	}
+	
+	DoomMap Make () const {
+		static const std::uint64_t floor_flat = DoomWad::LumpKey("FLOOR4_8");
+		static const std::uint64_t ceiling_flat = DoomWad::LumpKey("CEIL3_5");
+		
+		std::mt19937 random(seed);
+		std::uniform_real_distribution <float> jitter(-8, 8);
+		int step_count = 0 < jitter_step ? static_cast <int> (8 / jitter_step) : 0;
+		std::uniform_int_distribution <int> jitter_steps(-step_count, step_count);
+		int n = size;
+		DoomMap map;
+		map.format = doom_map_format;
+		
+		auto cell = [&] (int i, int j) {
+			return 0 <= i && i < n && 0 <= j && j < n ? i + j * n : -1;
+		};
+		
+		auto lattice_vertex = [&] (int i, int j) {
+			return static_cast <std::uint32_t> (i + j * (n + 1));
+		};
+		
+		auto jittered = [&] (float x) {
+			return x + (0 < jitter_step ? jitter_steps(random) * jitter_step : jitter(random));
+		};
+		
+		for(int j = 0; j <= n; j++) {
+			for(int i = 0; i <= n; i++) {
+				float x = jittered(64 * i);
+				AddVertex(map, x, jittered(64 * j));
+			}
+		}
+		
+		// Going right the cell below is on the right, going up the cell on the right.
+		for(int j = 0; j <= n; j++) {
+			for(int i = 0; i <= n; i++) {
+				if(i < n) {
+					AddLine(map, lattice_vertex(i, j), lattice_vertex(i + 1, j), cell(i, j - 1), cell(i, j));
+				}
+				
+				if(j < n) {
+					AddLine(map, lattice_vertex(i, j), lattice_vertex(i, j + 1), cell(i, j), cell(i - 1, j));
+				}
+			}
+		}
+		
+		for(int j = 0; has_pillars && j < n; j++) {
+			for(int i = 0; i < n; i++) {
+				if(0 != cell(i, j) % 3) {
+					continue;
+				}
+				
+				// Counter-clockwise so the cell around it is on the right of its lines.
+				bool is_touching = has_touching_pillars && 0 == cell(i, j) % 15;
+				float x = 64 * i + 20;
+				float y = 64 * j + 20;
+				std::uint32_t a = is_touching ? lattice_vertex(i, j) : AddVertex(map, x, y);
+				std::uint32_t b = AddVertex(map, x + 24, y);
+				std::uint32_t c = AddVertex(map, x + 24, y + 24);
+				std::uint32_t d = AddVertex(map, x, y + 24);
+				AddLine(map, a, b, cell(i, j), -1);
+				AddLine(map, b, c, cell(i, j), -1);
+				AddLine(map, c, d, cell(i, j), -1);
+				AddLine(map, d, a, cell(i, j), -1);
+			}
+		}
+		
+		// Things on every skill and in every mode.
+		for(int s = 0; s < n * n; s++) {
+			map.sector_floor_height.push_back(8 * (s % 16));
+			map.sector_ceiling_height.push_back(128 + 8 * (s % 7));
+			map.sector_floor_flat.push_back(floor_flat);
+			map.sector_ceiling_flat.push_back(ceiling_flat);
+			map.sector_light.push_back(96 + s % 160);
+			map.sector_special.push_back(0);
+			map.sector_tag.push_back(0);
+			
+			map.thing_x.push_back(64 * (s % n) + 50);
+			map.thing_y.push_back(64 * (s / n) + 32);
+			map.thing_angle.push_back(45 * (s % 8) * static_cast <float> (SpaceConst::DegToRadFactor()));
+			map.thing_type.push_back(3001 + s % 5);
+			map.thing_flags.push_back(0x0007);
+			map.thing_z.push_back(0);
+			map.thing_tid.push_back(0);
+			map.thing_special.push_back(0);
+			map.thing_args.insert(map.thing_args.end(), special_arg_count, 0);
+		}
+		
+		return map;
+	}
+	
+	// Cells on a side.
+	int size = 100;
+	unsigned seed = 1234;
+	
+	// Jitter in multiples of this, so coordinates survive a trip through a file, or any amount
+	// when zero.
+	float jitter_step = 0;
+	
+	bool has_pillars = false;
+	bool has_touching_pillars = false;
+};
+
+#endif
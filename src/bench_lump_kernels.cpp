@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "lump_kernels.h"
+
+// Micro-benchmark of the lump conversion kernels on synthetic lumps of a million records each,
+// with things and linedefs in DOOM and in Hexen layout. Every kernel is checked against the
+// scalar one before it is timed.
+//
+//	bench_lump_kernels [record count] [repeat count]
+struct LumpKernelBench {
+	template <typename Func>
+	double BestSeconds (Func func) {
+		double best = 1e30;
+		
+		for(int r = 0; r < repeat_count; r++) {
+			auto start = std::chrono::steady_clock::now();
+			func();
+			std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::min(best, seconds.count());
+		}
+		
+		return best;
+	}
+	
+	void Report (const char* kernel, const char* lump, int record_size, double seconds, bool is_correct) {
+		double mb = 1e-6 * record_size * record_count;
+		
+		std::cout << std::left << std::setw(8) << kernel << std::setw(16) << lump
+			<< std::right << std::fixed << std::setprecision(3)
+			<< std::setw(10) << seconds * 1e3 << " ms"
+			<< std::setw(10) << mb / seconds << " MB/s"
+			<< std::setw(10) << 1e-6 * record_count / seconds << " M records/s"
+			<< (is_correct ? "" : "  MISMATCH") << std::endl;
+	}
+	
+	int Run () {
+		std::mt19937 random(1234);
+		std::uniform_int_distribution <int> byte(0, 255);
+		
+		// One lump of random bytes serves as all kinds of records.
+		std::vector <char> lump(HexenThingRecord::size * record_count);
+		
+		for(auto& b: lump) {
+			b = static_cast <char> (byte(random));
+		}
+		
+		std::vector <float> reference_floats(3 * record_count + 1);
+		std::vector <int> reference_ints(2 * record_count);
+		std::vector <float> floats(3 * record_count + 1);
+		std::vector <int> ints(2 * record_count);
+		
+		const auto* scalar = ScalarLumpKernels();
+		const LumpKernels* kernel_sets [] = { ScalarLumpKernels(), Sse2LumpKernels(), Avx2LumpKernels() };
+		
+		for(const auto* kernels: kernel_sets) {
+			if(!kernels) {
+				continue;
+			}
+			
+			scalar->vertexes_to_float(lump.data(), record_count, reference_floats.data());
+			kernels->vertexes_to_float(lump.data(), record_count, floats.data());
+			bool is_correct = 0 == std::memcmp(floats.data(), reference_floats.data(), 2 * sizeof(float) * record_count);
+			double seconds = BestSeconds( [&] () { kernels->vertexes_to_float(lump.data(), record_count, floats.data()); } );
+			Report(kernels->name, "VERTEXES", 4, seconds, is_correct);
+			
+			for(int f = 0; f < binary_map_format_count; f++) {
+				auto format = static_cast <MapFormat> (f);
+				bool is_hexen = hexen_map_format == format;
+				
+				scalar->things_to_float [f] (lump.data(), record_count, reference_floats.data());
+				kernels->things_to_float [f] (lump.data(), record_count, floats.data());
+				is_correct = 0 == std::memcmp(floats.data(), reference_floats.data(), 3 * sizeof(float) * record_count);
+				seconds = BestSeconds( [&] () { kernels->things_to_float [f] (lump.data(), record_count, floats.data()); } );
+				Report(kernels->name, is_hexen ? "THINGS hexen" : "THINGS", ThingRecordSize(format), seconds, is_correct);
+				
+				scalar->linedefs_to_indices [f] (lump.data(), record_count, reference_ints.data());
+				kernels->linedefs_to_indices [f] (lump.data(), record_count, ints.data());
+				is_correct = reference_ints == ints;
+				seconds = BestSeconds( [&] () { kernels->linedefs_to_indices [f] (lump.data(), record_count, ints.data()); } );
+				Report(kernels->name, is_hexen ? "LINEDEFS hexen" : "LINEDEFS", LinedefRecordSize(format), seconds, is_correct);
+			}
+		}
+		
+		std::cout << "dispatch picks " << BestLumpKernels().name << std::endl;
+		return 0;
+	}
+	
+	int record_count = 1000000;
+	int repeat_count = 20;
+};
+
+int main (int argc, char * argv []) {
+	LumpKernelBench bench;
+	
+	if(2 <= argc) {
+		bench.record_count = std::max(1, std::atoi(argv [1]));
+	}
+	
+	if(3 <= argc) {
+		bench.repeat_count = std::max(1, std::atoi(argv [2]));
+	}
+	
+	return bench.Run();
+}
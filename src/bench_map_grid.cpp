@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+#include "doom_map.h"
+#include "map_grid.h"
+
+// Benchmark of map grid queries against a linear scan over the whole map. The map is a synthetic
+// maze of short lines on a jittered lattice, about the size of the largest community maps. Grid
+// answers are checked against the scan first.
+//
+//	bench_map_grid [lattice size] [query count]
+struct MapGridBench {
+	void MakeMap (DoomMap& map) {
+		std::mt19937 random(1234);
+		std::uniform_real_distribution <float> jitter(-24, 24);
+		std::uniform_int_distribution <int> coin(0, 1);
+		
+		for(int j = 0; j < lattice_size; j++) {
+			for(int i = 0; i < lattice_size; i++) {
+				map.vertex_x.push_back(64 * i + jitter(random));
+				map.vertex_y.push_back(64 * j + jitter(random));
+			}
+		}
+		
+		// Connect every vertex to its right or upper neighbour.
+		for(int j = 0; j < lattice_size; j++) {
+			for(int i = 0; i < lattice_size; i++) {
+				int v = i + j * lattice_size;
+				bool is_right = coin(random) ? i + 1 < lattice_size : lattice_size <= j + 1;
+				
+				if(is_right && i + 1 < lattice_size) {
+					map.linedef_v1.push_back(v);
+					map.linedef_v2.push_back(v + 1);
+				}
+				
+				else if(j + 1 < lattice_size) {
+					map.linedef_v1.push_back(v);
+					map.linedef_v2.push_back(v + lattice_size);
+				}
+				
+				if(0 == v % 8) {
+					map.thing_x.push_back(map.vertex_x [v] + 32);
+					map.thing_y.push_back(map.vertex_y [v] + 32);
+				}
+			}
+		}
+	}
+	
+	template <typename Func>
+	double Seconds (Func func) {
+		auto start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+		return seconds.count();
+	}
+	
+	void Report (const char* query, const char* method, int count, double seconds, bool is_correct) {
+		std::cout << std::left << std::setw(16) << query << std::setw(8) << method
+			<< std::right << std::fixed << std::setprecision(3)
+			<< std::setw(12) << 1e6 * seconds / count << " us/query"
+			<< std::setw(14) << std::setprecision(0) << count / seconds << " queries/s"
+			<< (is_correct ? "" : "  MISMATCH") << std::endl;
+	}
+	
+	int Run () {
+		DoomMap map;
+		MakeMap(map);
+		
+		MapGrid grid;
+		double build_seconds = Seconds( [&] () { grid.Build(map); } );
+		
+		std::cout << map.LinedefCount() << " lines, " << map.VertexCount() << " vertices, "
+			<< map.ThingCount() << " things, grid " << grid.column_count << " x " << grid.row_count
+			<< " built in " << std::fixed << std::setprecision(3) << build_seconds * 1e3 << " ms" << std::endl;
+		
+		std::mt19937 random(5678);
+		std::uniform_real_distribution <float> coord(-256, 64 * lattice_size + 256);
+		std::vector <float> query_x(query_count);
+		std::vector <float> query_y(query_count);
+		
+		for(int q = 0; q < query_count; q++) {
+			query_x [q] = coord(random);
+			query_y [q] = coord(random);
+		}
+		
+		// The scan is so slow that it only gets a slice of the queries.
+		int scan_count = std::max(1, query_count / 100);
+		const float no_limit = std::numeric_limits <float>::max();
+		std::vector <int> scan_found(scan_count);
+		std::vector <int> grid_found(query_count);
+		
+		double scan_seconds = Seconds( [&] () {
+			for(int q = 0; q < scan_count; q++) {
+				int best = -1;
+				float best_distance = no_limit;
+				
+				for(int l = 0; l < map.LinedefCount(); l++) {
+					float d = MapGrid::LinedefDistanceSquared(map, l, query_x [q], query_y [q]);
+					
+					if(d < best_distance) {
+						best = l;
+						best_distance = d;
+					}
+				}
+				
+				scan_found [q] = best;
+			}
+		});
+		
+		double grid_seconds = Seconds( [&] () {
+			for(int q = 0; q < query_count; q++) {
+				grid_found [q] = grid.NearestLinedef(map, query_x [q], query_y [q], no_limit);
+			}
+		});
+		
+		bool is_correct = std::equal(scan_found.begin(), scan_found.end(), grid_found.begin());
+		Report("nearest line", "scan", scan_count, scan_seconds, true);
+		Report("nearest line", "grid", query_count, grid_seconds, is_correct);
+		
+		// Point in radius, the size of a hover test at a typical zoom.
+		const float radius = 48;
+		std::vector <int> found;
+		std::vector <std::size_t> scan_sizes(scan_count);
+		std::vector <std::size_t> grid_sizes(query_count);
+		
+		scan_seconds = Seconds( [&] () {
+			for(int q = 0; q < scan_count; q++) {
+				found.clear();
+				
+				for(int l = 0; l < map.LinedefCount(); l++) {
+					if(MapGrid::LinedefDistanceSquared(map, l, query_x [q], query_y [q]) <= radius * radius) {
+						found.push_back(l);
+					}
+				}
+				
+				scan_sizes [q] = found.size();
+			}
+		});
+		
+		grid_seconds = Seconds( [&] () {
+			for(int q = 0; q < query_count; q++) {
+				grid.LinedefsInRadius(map, query_x [q], query_y [q], radius, found);
+				grid_sizes [q] = found.size();
+			}
+		});
+		
+		is_correct = std::equal(scan_sizes.begin(), scan_sizes.end(), grid_sizes.begin());
+		Report("lines in radius", "scan", scan_count, scan_seconds, true);
+		Report("lines in radius", "grid", query_count, grid_seconds, is_correct);
+		
+		grid_seconds = Seconds( [&] () {
+			for(int q = 0; q < query_count; q++) {
+				grid_found [q] = grid.NearestVertex(map, query_x [q], query_y [q], radius);
+			}
+		});
+		
+		Report("nearest vertex", "grid", query_count, grid_seconds, true);
+		
+		grid_seconds = Seconds( [&] () {
+			for(int q = 0; q < query_count; q++) {
+				grid_found [q] = grid.NearestThing(map, query_x [q], query_y [q], radius);
+			}
+		});
+		
+		Report("nearest thing", "grid", query_count, grid_seconds, true);
+		return 0;
+	}
+	
+	int lattice_size = 256;
+	int query_count = 1000000;
+};
+
+int main (int argc, char * argv []) {
+	MapGridBench bench;
+	
+	if(2 <= argc) {
+		bench.lattice_size = std::max(2, std::atoi(argv [1]));
+	}
+	
+	if(3 <= argc) {
+		bench.query_count = std::max(1, std::atoi(argv [2]));
+	}
+	
+	return bench.Run();
+}
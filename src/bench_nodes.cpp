@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_lattice.h"
+#include "doom_map.h"
+#include "node_builder.h"
+#include "sector_mesh.h"
+#include "wad_file.h"
+
+// Benchmark of the node builder on a synthetic map and on the maps of reference wads. The
+// synthetic map is a jittered lattice of square sectors, every third with a pillar in it. Every
+// map is built on one thread and on all cores, and the tree is checked by looking up the
+// middle of every sector triangle and comparing the sector the tree finds there. The nodes the
+// wad came with are listed for comparison.
+//
+//	bench_nodes [lattice size] [repeat count] [reference.wad ...]
+struct NodeBench {
+	// Triangles whose middle the tree puts into another sector.
+	int CountMisplaced (const DoomMap& map, const MapBsp& bsp, int& checked_count) {
+		SectorMesh mesh;
+		mesh.Build(map, 1);
+		int misplaced_count = 0;
+		checked_count = mesh.TriangleCount();
+		
+		for(int t = 0; t < mesh.TriangleCount(); t++) {
+			const int* corner = mesh.indices.data() + 3 * t;
+			float x = 0;
+			float y = 0;
+			
+			for(int k = 0; k < 3; k++) {
+				x += mesh.vertices [2 * corner [k]] / 3;
+				y += mesh.vertices [2 * corner [k] + 1] / 3;
+			}
+			
+			if(bsp.SubsectorSector(map, bsp.SubsectorAt(x, y)) != mesh.vertex_sectors [corner [0]]) {
+				misplaced_count++;
+			}
+		}
+		
+		return misplaced_count;
+	}
+	
+	double BestSeconds (const DoomMap& map, NodeBuilder& builder, int thread_count) {
+		double best = 1e30;
+		
+		for(int r = 0; r < repeat_count; r++) {
+			auto start = std::chrono::steady_clock::now();
+			builder.Build(map, thread_count);
+			std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::min(best, seconds.count());
+		}
+		
+		return best;
+	}
+	
+	// One row per map. Returns false when the tree misplaces any point.
+	bool BenchMap (const std::string& name, const DoomMap& map, const MapBsp* reference) {
+		NodeBuilder builder;
+		int core_count = std::max(1u, std::thread::hardware_concurrency());
+		double single_seconds = BestSeconds(map, builder, 1);
+		double parallel_seconds = BestSeconds(map, builder, core_count);
+		
+		MapBsp bsp;
+		builder.ToBsp(bsp);
+		int checked_count = 0;
+		int misplaced_count = CountMisplaced(map, bsp, checked_count);
+		
+		std::cout << std::left << std::setw(10) << name << std::right
+			<< std::setw(8) << map.LinedefCount()
+			<< std::setw(9) << builder.SegCount()
+			<< std::setw(8) << builder.SubsectorCount()
+			<< std::setw(8) << builder.NodeCount()
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(12) << 1e3 * single_seconds
+			<< std::setw(12) << 1e3 * parallel_seconds
+			<< "  " << checked_count - misplaced_count << " of " << checked_count << " in place";
+		
+		if(reference) {
+			std::cout << ", wad nodes " << reference->SegCount() << " segs " << reference->SubsectorCount() << " subsectors";
+		}
+		
+		std::cout << std::endl;
+		return 0 == misplaced_count;
+	}
+	
+	int Run (const std::vector <std::string>& wad_paths) {
+		int core_count = std::max(1u, std::thread::hardware_concurrency());
+		std::cout << "map          lines     segs    subs   nodes   1 thread ms  " << core_count << " thread ms" << std::endl;
+		
+		// Whole units, as the vertices of a binary map are.
+		BenchLattice lattice;
+		lattice.size = lattice_size;
+		lattice.jitter_step = 1;
+		lattice.has_pillars = true;
+		DoomMap map = lattice.Make();
+		bool is_correct = BenchMap("lattice", map, nullptr);
+		
+		// Real maps may have sectors that are not closed, those are reported but do not fail.
+		for(const auto& path : wad_paths) {
+			DoomWad wad(path);
+			
+			for(int m = 0; m < wad.maps.size(); m++) {
+				map.Decode(wad, m);
+				MapBsp reference;
+				bool has_reference = reference.Decode(wad, m, map);
+				BenchMap(DoomWad::LumpKeyName(map.name_key), map, has_reference ? &reference : nullptr);
+			}
+		}
+		
+		return is_correct ? 0 : 1;
+	}
+	
+	int lattice_size = 100;
+	int repeat_count = 3;
+};
+
+int main (int argc, char * argv []) {
+	NodeBench bench;
+	std::vector <std::string> wad_paths;
+	
+	if(2 <= argc) {
+		bench.lattice_size = std::max(1, std::atoi(argv [1]));
+	}
+	
+	if(3 <= argc) {
+		bench.repeat_count = std::max(1, std::atoi(argv [2]));
+	}
+	
+	for(int k = 3; k < argc; k++) {
+		wad_paths.push_back(argv [k]);
+	}
+	
+	return bench.Run(wad_paths);
+}
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flat_array.h"
+#include "palette.h"
+#include "wad_stack.h"
+
+// Benchmark of expanding paletted pixels to RGBA. Random pixels go through a synthetic palette
+// and colormap as one large image and as 64 by 64 flats with a light table for each, and every
+// kernel is checked against the scalar one before it is timed. The same flats are built into a
+// flat array with their mip levels, on one thread and on all cores. Given wads are pushed as a
+// stack, all of their flats go through the palette and colormap from the stack at every light
+// level and into a flat array.
+//
+//	bench_palette [megapixels] [repeat count] [wad ...]
+struct PaletteBench {
+	static constexpr int flat_size = 64 * 64;
+	
+	template <typename Func>
+	double BestSeconds (Func func) {
+		double best = 1e30;
+		
+		for(int r = 0; r < repeat_count; r++) {
+			auto start = std::chrono::steady_clock::now();
+			func();
+			std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::min(best, seconds.count());
+		}
+		
+		return best;
+	}
+	
+	void Report (const char* kernel, const std::string& workload, double pixel_count, double seconds, bool is_correct) {
+		std::cout << std::left << std::setw(8) << kernel << std::setw(28) << workload
+			<< std::right << std::fixed << std::setprecision(3)
+			<< std::setw(10) << seconds * 1e3 << " ms"
+			<< std::setw(10) << 1e-6 * pixel_count / seconds << " MP/s"
+			<< std::setw(10) << 4e-6 * pixel_count / seconds << " MB/s out"
+			<< (is_correct ? "" : "  MISMATCH") << std::endl;
+	}
+	
+	// Pixels in runs of flats, each with the light table of its own light level.
+	static void ExpandFlats (const PaletteKernels& kernels, const DoomPalette& palette, const std::uint8_t* pixels, std::size_t flat_count, std::uint32_t* rgba) {
+		std::uint32_t table [palette_color_count];
+		
+		for(std::size_t f = 0; f < flat_count; f++) {
+			palette.LightTable(0, f % colormap_light_levels, table);
+			kernels.expand(pixels + flat_size * f, flat_size, table, rgba + flat_size * f);
+		}
+	}
+	
+	int Run (const std::vector <std::string>& wad_paths) {
+		std::mt19937 random(1234);
+		std::uniform_int_distribution <int> byte(0, 255);
+		
+		// Random bytes as palette and colormap lumps.
+		std::vector <char> playpal(14 * playpal_palette_size);
+		std::vector <char> colormap(34 * palette_color_count);
+		
+		for(auto* lump: { &playpal, &colormap }) {
+			for(auto& b: *lump) {
+				b = static_cast <char> (byte(random));
+			}
+		}
+		
+		DoomPalette palette;
+		palette.ReadPlaypal(playpal.data(), playpal.size());
+		palette.ReadColormap(colormap.data(), colormap.size());
+		
+		std::size_t flat_count = std::max <std::size_t> (1, megapixels * 1e6 / flat_size);
+		std::size_t pixel_count = flat_count * flat_size;
+		std::vector <std::uint8_t> pixels(pixel_count);
+		
+		for(auto& p: pixels) {
+			p = byte(random);
+		}
+		
+		std::uint32_t table [palette_color_count];
+		palette.LightTable(0, 0, table);
+		std::vector <std::uint32_t> reference(pixel_count);
+		std::vector <std::uint32_t> rgba(pixel_count);
+		std::string flats_name = std::to_string(flat_count) + " flats";
+		std::string image_name = "image " + std::to_string(pixel_count) + " px";
+		
+		const auto* scalar = ScalarPaletteKernels();
+		const PaletteKernels* kernel_sets [] = { ScalarPaletteKernels(), Avx2PaletteKernels() };
+		
+		for(const auto* kernels: kernel_sets) {
+			if(!kernels) {
+				continue;
+			}
+			
+			scalar->expand(pixels.data(), pixel_count, table, reference.data());
+			kernels->expand(pixels.data(), pixel_count, table, rgba.data());
+			bool is_correct = reference == rgba;
+			double seconds = BestSeconds( [&] () { kernels->expand(pixels.data(), pixel_count, table, rgba.data()); } );
+			Report(kernels->name, image_name, pixel_count, seconds, is_correct);
+			
+			ExpandFlats(*scalar, palette, pixels.data(), flat_count, reference.data());
+			ExpandFlats(*kernels, palette, pixels.data(), flat_count, rgba.data());
+			is_correct = reference == rgba;
+			seconds = BestSeconds( [&] () { ExpandFlats(*kernels, palette, pixels.data(), flat_count, rgba.data()); } );
+			Report(kernels->name, flats_name, pixel_count, seconds, is_correct);
+		}
+		
+		// The flats as one wad in memory, built into a flat array as the viewer does for a stack.
+		WadStack flat_stack;
+		flat_stack.Push(MakeFlatWad(pixels, flat_count));
+		BenchFlatArray(flat_stack, palette, flat_count);
+		
+		if(!wad_paths.empty()) {
+			BenchWads(wad_paths);
+		}
+		
+		std::cout << "dispatch picks " << BestPaletteKernels().name << std::endl;
+		return 0;
+	}
+	
+	static std::vector <char> MakeFlatWad (const std::vector <std::uint8_t>& pixels, std::size_t flat_count) {
+		std::vector <char> wad(12);
+		std::vector <char> directory;
+		
+		auto add_lump = [&] (const std::string& name, const std::uint8_t* data, int size) {
+			std::int32_t entry [2] = { static_cast <std::int32_t> (wad.size()), size };
+			char lump_name [8] = {};
+			std::memcpy(lump_name, name.data(), std::min <std::size_t> (8, name.size()));
+			directory.insert(directory.end(), reinterpret_cast <const char*> (entry), reinterpret_cast <const char*> (entry) + 8);
+			directory.insert(directory.end(), lump_name, lump_name + 8);
+			wad.insert(wad.end(), data, data + size);
+		};
+		
+		add_lump("F_START", nullptr, 0);
+		
+		for(std::size_t f = 0; f < flat_count; f++) {
+			add_lump("FL" + std::to_string(f), pixels.data() + flat_size * f, flat_size);
+		}
+		
+		add_lump("F_END", nullptr, 0);
+		std::int32_t header [3] = { 0, static_cast <std::int32_t> (flat_count + 2), static_cast <std::int32_t> (wad.size()) };
+		std::memcpy(header, "IWAD", 4);
+		std::memcpy(wad.data(), header, 12);
+		wad.insert(wad.end(), directory.begin(), directory.end());
+		return wad;
+	}
+	
+	// Expanding and mip mapping every flat of a stack, on one thread and on all cores. Rows count
+	// the pixels of the full size flats.
+	void BenchFlatArray (const WadStack& wads, const DoomPalette& palette, std::size_t expected_count) {
+		int core_count = std::max(1u, std::thread::hardware_concurrency());
+		std::vector <int> thread_counts = { 1 };
+		
+		if(1 < core_count) {
+			thread_counts.push_back(core_count);
+		}
+		
+		FlatArray reference;
+		reference.Build(wads, palette, 1);
+		
+		for(int threads: thread_counts) {
+			FlatArray flats;
+			double seconds = BestSeconds( [&] () { flats.Build(wads, palette, threads); } );
+			bool is_correct = flats.LayerCount() == expected_count;
+			
+			for(int level = 0; level < flat_level_count; level++) {
+				is_correct = is_correct && flats.pixels.levels [level] == reference.pixels.levels [level];
+			}
+			
+			std::string workload = "flat array " + std::to_string(flats.LayerCount()) + ", " + std::to_string(threads) + " threads";
+			Report(BestPaletteKernels().name, workload, static_cast <double> (flats.LayerCount()) * flat_size, seconds, is_correct);
+		}
+	}
+	
+	// The flats between F_START and F_END, or FF_START and FF_END in PWADs, at every light level.
+	void BenchWads (const std::vector <std::string>& wad_paths) {
+		WadStack wads;
+		
+		for(const auto& path: wad_paths) {
+			if(!wads.Push(path)) {
+				std::cout << "Can not open " << path << std::endl;
+			}
+		}
+		
+		DoomPalette palette;
+		
+		if(!palette.Read(wads)) {
+			std::cout << "No PLAYPAL and COLORMAP, using a gray ramp" << std::endl;
+		}
+		
+		std::vector <const std::uint8_t*> flats;
+		
+		for(const auto& wad: wads.wads) {
+			bool is_in_flats = false;
+			
+			for(int k = 0; k < wad.lump_count; k++) {
+				auto name = wad.LumpName(k);
+				is_in_flats = name.ends_with("F_START") ? true : name.ends_with("F_END") ? false : is_in_flats;
+				
+				if(is_in_flats && flat_size == wad.Lump(k).size && wad.IsLumpValid(wad.Lump(k))) {
+					flats.push_back(reinterpret_cast <const std::uint8_t*> (wad.LumpData(wad.Lump(k))));
+				}
+			}
+		}
+		
+		std::vector <std::uint32_t> rgba(flat_size);
+		double pixel_count = static_cast <double> (flats.size()) * colormap_light_levels * flat_size;
+		
+		for(const auto* kernels: { ScalarPaletteKernels(), Avx2PaletteKernels() }) {
+			if(!kernels || flats.empty()) {
+				continue;
+			}
+			
+			double seconds = BestSeconds( [&] () {
+				std::uint32_t table [palette_color_count];
+				
+				for(int level = 0; level < colormap_light_levels; level++) {
+					palette.LightTable(0, level, table);
+					
+					for(const auto* flat: flats) {
+						kernels->expand(flat, flat_size, table, rgba.data());
+					}
+				}
+			});
+			
+			Report(kernels->name, std::to_string(flats.size()) + " wad flats x 32 lights", pixel_count, seconds, true);
+		}
+		
+		FlatArray flat_array;
+		flat_array.Build(wads, palette);
+		BenchFlatArray(wads, palette, flat_array.LayerCount());
+	}
+	
+	double megapixels = 16;
+	int repeat_count = 10;
+};
+
+int main (int argc, char * argv []) {
+	PaletteBench bench;
+	std::vector <std::string> wad_paths;
+	
+	if(2 <= argc) {
+		bench.megapixels = std::clamp(std::atof(argv [1]), 0.01, 1000.0);
+	}
+	
+	if(3 <= argc) {
+		bench.repeat_count = std::max(1, std::atoi(argv [2]));
+	}
+	
+	for(int k = 3; k < argc; k++) {
+		wad_paths.push_back(argv [k]);
+	}
+	
+	return bench.Run(wad_paths);
+}
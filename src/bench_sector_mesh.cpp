@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "bench_lattice.h"
+#include "doom_map.h"
+#include "sector_mesh.h"
+
+// Benchmark of sector triangulation on a synthetic map. Every cell of a jittered lattice is a
+// sector of its own, every third cell has a pillar in it and every fifth pillar touches a
+// corner of its cell, so holes and loops meeting at a vertex both occur. The area covered by the
+// triangles is checked against the area of the sectors.
+//
+//	bench_sector_mesh [lattice size] [repeat count]
+struct SectorMeshBench {
+	// The area all sectors should cover. Lines run clockwise around the sector in front, and the
+	// other way around the sector behind.
+	double SectorArea (const DoomMap& map) {
+		double area = 0;
+		
+		for(int l = 0; l < map.LinedefCount(); l++) {
+			std::uint32_t v1 = map.linedef_v1 [l];
+			std::uint32_t v2 = map.linedef_v2 [l];
+			double cross = static_cast <double> (map.vertex_x [v1]) * map.vertex_y [v2] - static_cast <double> (map.vertex_x [v2]) * map.vertex_y [v1];
+			int sides = (DoomMap::no_index != map.linedef_back [l]) - (DoomMap::no_index != map.linedef_front [l]);
+			area += 0.5 * sides * cross;
+		}
+		
+		return area;
+	}
+	
+	double TriangleArea (const SectorMesh& mesh) {
+		double area = 0;
+		
+		for(int t = 0; t < mesh.TriangleCount(); t++) {
+			const int* corner = mesh.indices.data() + 3 * t;
+			const float* a = mesh.vertices.data() + 2 * corner [0];
+			const float* b = mesh.vertices.data() + 2 * corner [1];
+			const float* c = mesh.vertices.data() + 2 * corner [2];
+			area += 0.5 * std::abs((b [0] - a [0]) * (c [1] - a [1]) - (c [0] - a [0]) * (b [1] - a [1]));
+		}
+		
+		return area;
+	}
+	
+	double BestSeconds (const DoomMap& map, SectorMesh& mesh, int thread_count) {
+		double best = 1e30;
+		
+		for(int r = 0; r < repeat_count; r++) {
+			auto start = std::chrono::steady_clock::now();
+			mesh.Build(map, thread_count);
+			std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::min(best, seconds.count());
+		}
+		
+		return best;
+	}
+	
+	int Run () {
+		BenchLattice lattice;
+		lattice.size = lattice_size;
+		lattice.has_pillars = true;
+		lattice.has_touching_pillars = true;
+		DoomMap map = lattice.Make();
+		double area = SectorArea(map);
+		SectorMesh mesh;
+		
+		int core_count = std::max(1u, std::thread::hardware_concurrency());
+		double single_seconds = BestSeconds(map, mesh, 1);
+		double parallel_seconds = BestSeconds(map, mesh, core_count);
+		
+		double mesh_area = TriangleArea(mesh);
+		bool is_correct = std::abs(mesh_area - area) < 1e-6 * area && 0 == mesh.open_side_count;
+		
+		std::cout << map.SectorCount() << " sectors, " << map.LinedefCount() << " lines, "
+			<< mesh.TriangleCount() << " triangles" << std::endl;
+		std::cout << std::fixed << std::setprecision(3)
+			<< "1 thread   " << std::setw(10) << 1e3 * single_seconds << " ms" << std::endl
+			<< core_count << " threads " << std::setw(10) << 1e3 * parallel_seconds << " ms" << std::endl
+			<< "area " << mesh_area << " of " << area << (is_correct ? "" : "  MISMATCH") << std::endl;
+		
+		return is_correct ? 0 : 1;
+	}
+	
+	int lattice_size = 100;
+	int repeat_count = 5;
+};
+
+int main (int argc, char * argv []) {
+	SectorMeshBench bench;
+	
+	if(2 <= argc) {
+		bench.lattice_size = std::max(1, std::atoi(argv [1]));
+	}
+	
+	if(3 <= argc) {
+		bench.repeat_count = std::max(1, std::atoi(argv [2]));
+	}
+	
+	return bench.Run();
+}
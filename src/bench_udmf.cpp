@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench_lattice.h"
+#include "doom_map.h"
+#include "space.h"
+#include "udmf.h"
+#include "wad_file.h"
+
+// Benchmark of the UDMF parser. The synthetic TEXTMAP is a jittered lattice of square sectors
+// written the way map editors write it, one field per line, with every inner line two sided and
+// a thing in every sector. Its records are kept and compared with what the parser reads back.
+// The TEXTMAP of every UDMF map in the given wads is parsed too.
+//
+//	bench_udmf [lattice size] [repeat count] [wad ...]
+struct UdmfBench {
+	void Append (const char* format, double a = 0, double b = 0) {
+		char line [128];
+		int length = std::snprintf(line, sizeof(line), format, a, b);
+		text.append(line, length);
+	}
+	
+	void WriteText () {
+		text.clear();
+		text += "// Written by bench_udmf\n/* A lattice of square sectors. */\nnamespace = \"zdoom\";\n";
+		
+		for(int v = 0; v < map.VertexCount(); v++) {
+			Append("\nvertex // %.0f\n{\n", v);
+			Append("x = %.3f;\ny = %.3f;\n}\n", map.vertex_x [v], map.vertex_y [v]);
+		}
+		
+		for(int l = 0; l < map.LinedefCount(); l++) {
+			Append("\nlinedef // %.0f\n{\n", l);
+			Append("v1 = %.0f;\nv2 = %.0f;\n", map.linedef_v1 [l], map.linedef_v2 [l]);
+			Append("sidefront = %.0f;\n", map.linedef_front [l]);
+			
+			if(DoomMap::no_index != map.linedef_back [l]) {
+				Append("sideback = %.0f;\ntwosided = true;\n", map.linedef_back [l]);
+			}
+			
+			else {
+				text += "blocking = true;\n";
+			}
+			
+			text += "}\n";
+		}
+		
+		for(int s = 0; s < map.SidedefCount(); s++) {
+			Append("\nsidedef // %.0f\n{\n", s);
+			Append("sector = %.0f;\n", map.sidedef_sector [s]);
+			text += "texturemiddle = \"" + DoomWad::LumpKeyName(map.sidedef_middle [s]) + "\";\n}\n";
+		}
+		
+		for(int s = 0; s < map.SectorCount(); s++) {
+			Append("\nsector // %.0f\n{\n", s);
+			Append("heightfloor = %.0f;\nheightceiling = %.0f;\n", map.sector_floor_height [s], map.sector_ceiling_height [s]);
+			text += "texturefloor = \"" + DoomWad::LumpKeyName(map.sector_floor_flat [s]) + "\";\n";
+			text += "textureceiling = \"" + DoomWad::LumpKeyName(map.sector_ceiling_flat [s]) + "\";\n";
+			Append("lightlevel = %.0f;\n}\n", map.sector_light [s]);
+		}
+		
+		for(int t = 0; t < map.ThingCount(); t++) {
+			Append("\nthing // %.0f\n{\n", t);
+			Append("x = %.3f;\ny = %.3f;\n", map.thing_x [t], map.thing_y [t]);
+			Append("angle = %.0f;\ntype = %.0f;\n", map.thing_angle [t] * SpaceConst::RadToDegFactor(), map.thing_type [t]);
+			text += "skill1 = true;\nskill2 = true;\nskill3 = true;\nskill4 = true;\nskill5 = true;\nsingle = true;\ncoop = true;\ndm = true;\n}\n";
+		}
+	}
+	
+	// Every field the text holds, against the records it was written from.
+	bool IsParsedCorrectly (const DoomMap& parsed) const {
+		auto same_angles = [&] () {
+			for(int t = 0; t < map.ThingCount(); t++) {
+				if(1e-5f < std::abs(parsed.thing_angle [t] - map.thing_angle [t])) {
+					return false;
+				}
+			}
+			
+			return true;
+		};
+		
+		return
+			parsed.vertex_x == map.vertex_x && parsed.vertex_y == map.vertex_y &&
+			parsed.linedef_v1 == map.linedef_v1 && parsed.linedef_v2 == map.linedef_v2 &&
+			parsed.linedef_flags == map.linedef_flags &&
+			parsed.linedef_front == map.linedef_front && parsed.linedef_back == map.linedef_back &&
+			parsed.sidedef_sector == map.sidedef_sector && parsed.sidedef_middle == map.sidedef_middle &&
+			parsed.sector_floor_flat == map.sector_floor_flat && parsed.sector_ceiling_flat == map.sector_ceiling_flat &&
+			parsed.sector_floor_height == map.sector_floor_height &&
+			parsed.sector_ceiling_height == map.sector_ceiling_height &&
+			parsed.sector_light == map.sector_light &&
+			parsed.thing_x == map.thing_x && parsed.thing_y == map.thing_y &&
+			parsed.thing_type == map.thing_type && parsed.thing_flags == map.thing_flags &&
+			parsed.thing_angle.size() == map.thing_angle.size() && same_angles();
+	}
+	
+	// One row per TEXTMAP. Returns the map as parsed by the last run.
+	bool BenchText (const std::string& name, const char* data, std::size_t size, DoomMap& parsed) {
+		UdmfParser parser;
+		double best = 1e30;
+		bool is_parsed = true;
+		
+		for(int r = 0; r < repeat_count; r++) {
+			parsed.Clear();
+			auto start = std::chrono::steady_clock::now();
+			is_parsed = parser.Parse(data, size, parsed);
+			std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::min(best, seconds.count());
+		}
+		
+		std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(10) << size / double(1 << 20)
+			<< std::setw(12) << 1e3 * best
+			<< std::setw(10) << std::setprecision(1) << size / best / (1 << 20)
+			<< std::setw(10) << parsed.VertexCount()
+			<< std::setw(10) << parsed.LinedefCount()
+			<< std::setw(10) << parsed.SidedefCount()
+			<< std::setw(10) << parsed.SectorCount()
+			<< std::setw(10) << parsed.ThingCount();
+		
+		if(!is_parsed) {
+			std::cout << "  syntax error at byte " << parser.error_offset;
+		}
+		
+		return is_parsed;
+	}
+	
+	int Run (const std::vector <std::string>& wad_paths) {
+		static const std::uint64_t textmap_key = DoomWad::LumpKey("TEXTMAP");
+		std::cout << "map              MB     best ms      MB/s  vertices     lines     sides   sectors    things" << std::endl;
+		
+		// Coordinates are multiples of 1/8, so the three decimals in the text read back exactly.
+		BenchLattice lattice;
+		lattice.size = lattice_size;
+		lattice.jitter_step = 0.125f;
+		map = lattice.Make();
+		WriteText();
+		DoomMap parsed;
+		bool is_correct = BenchText("lattice", text.data(), text.size(), parsed) && IsParsedCorrectly(parsed);
+		std::cout << (is_correct ? "  ok" : "  WRONG") << std::endl;
+		
+		for(const auto& path : wad_paths) {
+			DoomWad wad(path);
+			
+			for(int m = 0; m < wad.maps.size(); m++) {
+				int lump_index = wad.FindMapLump(m, textmap_key);
+				
+				if(0 <= lump_index && wad.IsLumpValid(wad.Lump(lump_index))) {
+					const auto& lump = wad.Lump(lump_index);
+					BenchText(wad.LumpName(wad.maps [m].marker_lump), wad.LumpData(lump), lump.size, parsed);
+					std::cout << std::endl;
+				}
+			}
+		}
+		
+		return is_correct ? 0 : 1;
+	}
+	
+	int lattice_size = 250;
+	int repeat_count = 5;
+	DoomMap map;
+	std::string text;
+};
+
+int main (int argc, char * argv []) {
+	UdmfBench bench;
+	std::vector <std::string> wad_paths;
+	
+	if(2 <= argc) {
+		bench.lattice_size = std::max(1, std::atoi(argv [1]));
+	}
+	
+	if(3 <= argc) {
+		bench.repeat_count = std::max(1, std::atoi(argv [2]));
+	}
+	
+	for(int k = 3; k < argc; k++) {
+		wad_paths.push_back(argv [k]);
+	}
+	
+	return bench.Run(wad_paths);
+}
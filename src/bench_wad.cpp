@@ -0,0 +1,487 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "map_cache.h"
+#include "wad_file.h"
+#include "wad_funcs.h"
+#include "wad_stack.h"
+
+// Every allocation in the process goes through here, so each benchmark can report how many it
+// made. Counting is a relaxed atomic add, cheap next to the allocation itself.
+static std::atomic <std::uint64_t> allocation_count = 0;
+static std::atomic <std::uint64_t> allocated_bytes = 0;
+
+void* operator new (std::size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	
+	if(void* p = std::malloc(std::max <std::size_t> (size, 1))) {
+		return p;
+	}
+	
+	throw std::bad_alloc();
+}
+
+void operator delete (void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete (void* p, std::size_t size) noexcept {
+	std::free(p);
+}
+
+// Benchmark of opening wads, directory lookups, the map lump conversions and the map cache on a
+// synthetic wad. The wad is generated from a fixed seed, so the same arguments give the same file
+// on every machine. Results go to standard output as CSV, one row per benchmark with the same
+// columns every time, so runs can be appended to one file and compared over time. Throughput
+// columns that do not apply to a benchmark are zero. Allocations are per run of the benchmark.
+// Given a wad path the synthetic wad is written there and kept, as training input for other tools.
+//
+//	bench_wad [lump count] [map count] [vertices per map] [repeat count] [wad path]
+struct WadBench {
+	
+	// Work done by one run of a benchmark, the base of the throughput columns.
+	struct Work {
+		double bytes;
+		double lumps;
+		double maps;
+	};
+	
+	static void Put16 (std::vector <char>& lump, int value) {
+		lump.push_back(static_cast <char> (value & 0xFF));
+		lump.push_back(static_cast <char> ((value >> 8) & 0xFF));
+	}
+	
+	static void Put32 (std::vector <char>& lump, int value) {
+		Put16(lump, value & 0xFFFF);
+		Put16(lump, (value >> 16) & 0xFFFF);
+	}
+	
+	static void PutName (std::vector <char>& lump, const std::string& name) {
+		char padded [8] = {};
+		std::memcpy(padded, name.data(), std::min <std::size_t> (8, name.size()));
+		lump.insert(lump.end(), padded, padded + 8);
+	}
+	
+	static std::string MapName (int map) {
+		return "MAP" + std::string(map < 9 ? "0" : "") + std::to_string(map + 1);
+	}
+	
+	// A map on a jittered lattice, every vertex joined to its right and lower neighbour. Counts
+	// stay inside what 16 bit vanilla indices can address.
+	void AddMap (int map, std::mt19937& random) {
+		std::uniform_int_distribution <int> jitter(-16, 16);
+		int vertex_count = std::clamp(vertices_per_map, 4, 0xFFFF);
+		int side = static_cast <int> (std::ceil(std::sqrt(vertex_count)));
+		
+		std::vector <char> vertexes;
+		
+		for(int v = 0; v < vertex_count; v++) {
+			Put16(vertexes, (v % side) * 64 - side * 32 + jitter(random));
+			Put16(vertexes, (v / side) * 64 - side * 32 + jitter(random));
+		}
+		
+		std::vector <int> line_vertices;
+		
+		for(int v = 0; v < vertex_count && line_vertices.size() < 2 * 0xFFFF; v++) {
+			if(v % side + 1 < side && v + 1 < vertex_count) {
+				line_vertices.push_back(v);
+				line_vertices.push_back(v + 1);
+			}
+			
+			if(v + side < vertex_count && line_vertices.size() < 2 * 0xFFFF) {
+				line_vertices.push_back(v);
+				line_vertices.push_back(v + side);
+			}
+		}
+		
+		int line_count = line_vertices.size() / 2;
+		int sector_count = 1 + vertex_count / 64;
+		std::vector <char> linedefs, sidedefs, segs;
+		
+		for(int l = 0; l < line_count; l++) {
+			Put16(linedefs, line_vertices [2 * l]);
+			Put16(linedefs, line_vertices [2 * l + 1]);
+			Put16(linedefs, 1);
+			Put16(linedefs, 0);
+			Put16(linedefs, 0);
+			Put16(linedefs, l);
+			Put16(linedefs, 0xFFFF);
+			
+			Put16(sidedefs, 0);
+			Put16(sidedefs, 0);
+			PutName(sidedefs, "-");
+			PutName(sidedefs, "-");
+			PutName(sidedefs, "STARTAN3");
+			Put16(sidedefs, l % sector_count);
+			
+			Put16(segs, line_vertices [2 * l]);
+			Put16(segs, line_vertices [2 * l + 1]);
+			Put16(segs, 0);
+			Put16(segs, l);
+			Put16(segs, 0);
+			Put16(segs, 0);
+		}
+		
+		// Subsectors of up to 16 segs, and a chain of nodes over them.
+		int subsector_count = (line_count + 15) / 16;
+		std::vector <char> ssectors, nodes;
+		
+		for(int s = 0; s < subsector_count; s++) {
+			Put16(ssectors, std::min(16, line_count - 16 * s));
+			Put16(ssectors, 16 * s);
+		}
+		
+		for(int n = 0; n + 1 < subsector_count; n++) {
+			for(int k = 0; k < 12; k++) {
+				Put16(nodes, k % 4 < 2 ? side * 32 : -side * 32);
+			}
+			
+			Put16(nodes, 0x8000 | n);
+			Put16(nodes, 0 == n ? 0x8000 | (subsector_count - 1) : n - 1);
+		}
+		
+		std::vector <char> sectors;
+		
+		for(int s = 0; s < sector_count; s++) {
+			Put16(sectors, 0);
+			Put16(sectors, 128);
+			PutName(sectors, "FLOOR4_8");
+			PutName(sectors, "CEIL3_5");
+			Put16(sectors, 160);
+			Put16(sectors, 0);
+			Put16(sectors, 0);
+		}
+		
+		std::vector <char> things;
+		
+		for(int t = 0; t < 1 + vertex_count / 16; t++) {
+			Put16(things, (t % side) * 64 - side * 32 + 32);
+			Put16(things, (t / side) * 64 - side * 32 + 32);
+			Put16(things, 45 * (t % 8));
+			Put16(things, 1 + t % 3000);
+			Put16(things, 7);
+		}
+		
+		std::vector <char> reject((sector_count * sector_count + 7) / 8, 0);
+		std::vector <char> blockmap;
+		
+		for(int k = 0; k < 4; k++) {
+			Put16(blockmap, 0);
+		}
+		
+		AddLump(MapName(map), {});
+		AddLump("THINGS", things);
+		AddLump("LINEDEFS", linedefs);
+		AddLump("SIDEDEFS", sidedefs);
+		AddLump("VERTEXES", vertexes);
+		AddLump("SEGS", segs);
+		AddLump("SSECTORS", ssectors);
+		AddLump("NODES", nodes);
+		AddLump("SECTORS", sectors);
+		AddLump("REJECT", reject);
+		AddLump("BLOCKMAP", blockmap);
+	}
+	
+	void AddLump (const std::string& name, const std::vector <char>& lump) {
+		Put32(directory, 12 + lump_bytes.size());
+		Put32(directory, lump.size());
+		PutName(directory, name);
+		lump_bytes.insert(lump_bytes.end(), lump.begin(), lump.end());
+		written_lump_count++;
+	}
+	
+	// Filler lumps of random size come first, the way graphics and sounds sit in front of the
+	// maps of most wads, then the maps.
+	bool WriteWad (const std::string& path) {
+		std::mt19937 random(1234);
+		std::uniform_int_distribution <int> filler_size(16, 4096);
+		written_lump_count = 0;
+		lump_bytes.clear();
+		directory.clear();
+		
+		int filler_count = std::max(0, lump_count - 11 * map_count);
+		
+		for(int k = 0; k < filler_count; k++) {
+			std::string name = std::to_string(k);
+			name = "F" + std::string(7 - std::min <std::size_t> (7, name.size()), '0') + name;
+			AddLump(name, std::vector <char> (filler_size(random), static_cast <char> (k)));
+		}
+		
+		for(int map = 0; map < map_count; map++) {
+			AddMap(map, random);
+		}
+		
+		std::vector <char> header;
+		PutName(header, "PWAD");
+		header.resize(4);
+		Put32(header, written_lump_count);
+		Put32(header, 12 + lump_bytes.size());
+		
+		std::ofstream f(path, std::ios::binary);
+		f.write(header.data(), header.size());
+		f.write(lump_bytes.data(), lump_bytes.size());
+		f.write(directory.data(), directory.size());
+		file_bytes = header.size() + lump_bytes.size() + directory.size();
+		return f.good();
+	}
+	
+	template <typename Func>
+	void Bench (const char* name, Work work, Func func) {
+		double best = 1e30;
+		auto first_count = allocation_count.load();
+		auto first_bytes = allocated_bytes.load();
+		
+		for(int r = 0; r < repeat_count; r++) {
+			auto start = std::chrono::steady_clock::now();
+			func();
+			std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::min(best, seconds.count());
+		}
+		
+		best = std::max(best, 1e-9);
+		
+		std::cout << name << ',' << lump_count << ',' << map_count << ',' << vertices_per_map << ','
+			<< file_bytes << ',' << repeat_count << ','
+			<< std::fixed << std::setprecision(3) << 1e3 * best << ','
+			<< 1e-6 * work.bytes / best << ','
+			<< work.lumps / best << ','
+			<< work.maps / best << ','
+			<< (allocation_count.load() - first_count) / repeat_count << ','
+			<< (allocated_bytes.load() - first_bytes) / repeat_count << std::endl;
+	}
+	
+	int Run () {
+		bool is_kept = !wad_path.empty();
+		auto path = is_kept ? wad_path : (std::filesystem::temp_directory_path() / "bench_wad.wad").string();
+		
+		if(!WriteWad(path)) {
+			std::cerr << "Could not write " << path << std::endl;
+			return 1;
+		}
+		
+		DoomWad wad(path);
+		
+		if(!wad.IsLoaded() || wad.maps.size() != map_count) {
+			std::cerr << "Synthetic wad did not load as expected" << std::endl;
+			return 1;
+		}
+		
+		int total_lumps = wad.lump_count;
+		double directory_bytes = 16.0 * total_lumps;
+		WadFuncs wad_funcs;
+		
+		// Bytes of a lump kind over all maps, for the conversion throughput.
+		auto map_lump_bytes = [&] (const char* lump_name) {
+			double bytes = 0;
+			
+			for(int map = 0; map < map_count; map++) {
+				int lump = wad.FindMapLump(map, DoomWad::LumpKey(lump_name));
+				bytes += 0 <= lump ? wad.Lump(lump).size : 0;
+			}
+			
+			return bytes;
+		};
+		
+		double all_map_bytes = 0;
+		
+		for(const auto& map: wad.maps) {
+			for(int lump = map.first_lump; lump < map.end_lump; lump++) {
+				all_map_bytes += wad.Lump(lump).size;
+			}
+		}
+		
+		std::cout << "benchmark,lump_count,map_count,vertices_per_map,file_bytes,repeat_count,"
+			"best_ms,mb_per_s,lumps_per_s,maps_per_s,allocations,allocated_bytes" << std::endl;
+		
+		Bench("open_mapped", { static_cast <double> (file_bytes), 1.0 * total_lumps, 1.0 * map_count }, [&] () {
+			DoomWad opened(path, true);
+		});
+		
+		Bench("open_read", { static_cast <double> (file_bytes), 1.0 * total_lumps, 1.0 * map_count }, [&] () {
+			DoomWad opened(path, false);
+		});
+		
+		Bench("parse_directory", { directory_bytes, 1.0 * total_lumps, 1.0 * map_count }, [&] () {
+			wad.ParseHeader();
+		});
+		
+		// The lump iterator walks the directory from the top for every map.
+		Bench("find_lump", { 0, 1.0 * map_count, 0 }, [&] () {
+			for(int map = 0; map < map_count; map++) {
+				wad_funcs.StoreLump(wad, { MapName(map), "VERTEXES" });
+			}
+		});
+		
+		// A mod stack of the same wad twenty times over. Lookups go through the merged index and
+		// should cost the same as with one wad.
+		Bench("stack_push_20", { 20.0 * file_bytes, 20.0 * total_lumps, 20.0 * map_count }, [&] () {
+			WadStack stack;
+			
+			for(int k = 0; k < 20; k++) {
+				stack.Push(path);
+			}
+		});
+		
+		WadStack stack_of_one;
+		WadStack stack_of_twenty;
+		stack_of_one.Push(path);
+		
+		for(int k = 0; k < 20; k++) {
+			stack_of_twenty.Push(path);
+		}
+		
+		// Every wad of a stack is the same wad, so every lookup lands in the top one.
+		auto find_every_lump = [&] (const WadStack& stack) {
+			std::int64_t wad_index_sum = 0;
+			
+			for(int k = 0; k < total_lumps; k++) {
+				wad_index_sum += stack.FindLump(wad.lump_keys [k]).wad_index;
+			}
+			
+			if(static_cast <std::int64_t> (stack.WadCount() - 1) * total_lumps != wad_index_sum) {
+				std::cerr << "Stack lookups found lumps in the wrong wads" << std::endl;
+			}
+		};
+		
+		Bench("stack_1_find_lump", { 0, 1.0 * total_lumps, 0 }, [&] () {
+			find_every_lump(stack_of_one);
+		});
+		
+		Bench("stack_20_find_lump", { 0, 1.0 * total_lumps, 0 }, [&] () {
+			find_every_lump(stack_of_twenty);
+		});
+		
+		static const char* map_lump_names [] = {
+			"THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS",
+			"SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP"
+		};
+		
+		Bench("store_map_lump", { 0, 10.0 * map_count, 0 }, [&] () {
+			for(int map = 0; map < map_count; map++) {
+				for(const char* lump_name: map_lump_names) {
+					wad_funcs.StoreMapLump(wad, map, lump_name);
+				}
+			}
+		});
+		
+		Bench("vertexes_to_float", { map_lump_bytes("VERTEXES"), 1.0 * map_count, 1.0 * map_count }, [&] () {
+			for(int map = 0; map < map_count; map++) {
+				wad_funcs.StoreMapLump(wad, map, "VERTEXES");
+				wad_funcs.VanillaVertexesLumpToFloat();
+			}
+		});
+		
+		Bench("linedefs_to_indices", { map_lump_bytes("LINEDEFS"), 1.0 * map_count, 1.0 * map_count }, [&] () {
+			for(int map = 0; map < map_count; map++) {
+				wad_funcs.StoreMapLump(wad, map, "LINEDEFS");
+				wad_funcs.VanillaLinedefsLumpToVertexIndices();
+			}
+		});
+		
+		Bench("things_to_float", { map_lump_bytes("THINGS"), 1.0 * map_count, 1.0 * map_count }, [&] () {
+			for(int map = 0; map < map_count; map++) {
+				wad_funcs.StoreMapLump(wad, map, "THINGS");
+				wad_funcs.VanillaThingsLumpToFloat();
+			}
+		});
+		
+		// From lumps to the arrays a thumbnail draws.
+		Bench("build_map_package", { all_map_bytes, 11.0 * map_count, 1.0 * map_count }, [&] () {
+			for(int map = 0; map < map_count; map++) {
+				MapPackage package;
+				wad_funcs.BuildMapPackage(wad, map, package);
+			}
+		});
+		
+		// The whole path the viewer takes on a cache miss, from lumps to a package ready for upload.
+		Bench("decode_map_model", { all_map_bytes, 11.0 * map_count, 1.0 * map_count }, [&] () {
+			for(int map = 0; map < map_count; map++) {
+				MapPackage package;
+				wad_funcs.BuildMapPackage(wad, map, package);
+				wad_funcs.DecodeMapModel(wad, map, package);
+			}
+		});
+		
+		// Every map a second time, from the cache. The key hashes the map lumps, so that is part of
+		// a hit too.
+		MapCache cache;
+		cache.directory = (std::filesystem::temp_directory_path() / "bench_wad_cache").string();
+		
+		for(int map = 0; map < map_count; map++) {
+			MapPackage package;
+			wad_funcs.BuildMapPackage(wad, map, package);
+			wad_funcs.DecodeMapModel(wad, map, package);
+			cache.Store(MapCache::MapKey(wad, map), package);
+		}
+		
+		Bench("map_cache_load", { all_map_bytes, 11.0 * map_count, 1.0 * map_count }, [&] () {
+			for(int map = 0; map < map_count; map++) {
+				MapPackage package;
+				
+				if(!cache.Load(MapCache::MapKey(wad, map), package)) {
+					std::cerr << "Map " << map << " missed the cache" << std::endl;
+				}
+			}
+		});
+		
+		std::error_code error;
+		std::filesystem::remove_all(cache.directory, error);
+		
+		if(!is_kept) {
+			std::filesystem::remove(path);
+		}
+		
+		return 0;
+	}
+	
+	int lump_count = 4096;
+	int map_count = 32;
+	int vertices_per_map = 4096;
+	int repeat_count = 10;
+	std::string wad_path;
+	
+	// The wad being generated.
+	std::vector <char> lump_bytes;
+	std::vector <char> directory;
+	int written_lump_count = 0;
+	std::uint64_t file_bytes = 0;
+};
+
+int main (int argc, char * argv []) {
+	WadBench bench;
+	
+	if(2 <= argc) {
+		bench.lump_count = std::max(0, std::atoi(argv [1]));
+	}
+	
+	if(3 <= argc) {
+		bench.map_count = std::max(1, std::atoi(argv [2]));
+	}
+	
+	if(4 <= argc) {
+		bench.vertices_per_map = std::max(4, std::atoi(argv [3]));
+	}
+	
+	if(5 <= argc) {
+		bench.repeat_count = std::max(1, std::atoi(argv [4]));
+	}
+	
+	if(6 <= argc) {
+		bench.wad_path = argv [5];
+	}
+	
+	return bench.Run();
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "wad_file.h"
+#include "wad_writer.h"
+
+// Benchmark of writing and patching a large wad. A synthetic wad of random lumps with one map in
+// the middle is written to a scratch directory. It is then copied whole with the bytes going
+// through the process and with kernel copies, and patched by replacing the LINEDEFS of the map,
+// once by writing a new wad and once in place. Every output is opened again and checked lump by
+// lump against what it should hold.
+//
+//	bench_wad_edit [size in MB] [lump count] [repeat count] [scratch directory]
+struct WadEditBench {
+	std::string ScratchPath (const std::string& name) const {
+		return (std::filesystem::path(scratch_directory) / name).string();
+	}
+	
+	bool MakeWad (const std::string& path) {
+		std::mt19937 random(1234);
+		std::size_t lump_size = std::max <std::size_t> (1, (size_mb << 20) / lump_count);
+		WadWriter writer;
+		writer.is_iwad = true;
+		
+		for(int k = 0; k < lump_count; k++) {
+			std::vector <char> data(lump_size / 2 + random() % (lump_size + 1));
+			
+			for(std::size_t i = 0; i + 4 <= data.size(); i += 4) {
+				std::uint32_t value = random();
+				std::memcpy(data.data() + i, &value, 4);
+			}
+			
+			if(k == lump_count / 2) {
+				writer.AddLump("MAP01", {});
+				writer.AddLump("LINEDEFS", std::move(data));
+			}
+			
+			else {
+				writer.AddLump("L" + std::to_string(k), std::move(data));
+			}
+		}
+		
+		return writer.Write(path);
+	}
+	
+	// The lumps of the source wad with the patched one swapped in.
+	bool IsWadCorrect (const std::string& path, const DoomWad& source, const std::vector <char>* patch) const {
+		DoomWad wad(path);
+		
+		if(!wad.IsLoaded() || wad.lump_count != source.lump_count) {
+			return false;
+		}
+		
+		int patched_lump = source.FindLumpIndex(DoomWad::LumpKey("LINEDEFS"));
+		
+		for(int k = 0; k < wad.lump_count; k++) {
+			const auto& lump = wad.Lump(k);
+			const auto& source_lump = source.Lump(k);
+			const char* expected = source.LumpData(source_lump);
+			std::size_t expected_size = source_lump.size;
+			
+			if(patch && k == patched_lump) {
+				expected = patch->data();
+				expected_size = patch->size();
+			}
+			
+			if(
+			wad.lump_keys [k] != source.lump_keys [k] || !wad.IsLumpValid(lump) || lump.size != expected_size ||
+			0 != std::memcmp(wad.LumpData(lump), expected, expected_size)) {
+				return false;
+			}
+		}
+		
+		return true;
+	}
+	
+	double BestSeconds (const std::function <bool ()>& prepare, const std::function <bool ()>& run) const {
+		double best = 1e30;
+		
+		for(int r = 0; r < repeat_count; r++) {
+			if(!prepare()) {
+				return -1;
+			}
+			
+			auto start = std::chrono::steady_clock::now();
+			
+			if(!run()) {
+				return -1;
+			}
+			
+			std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::min(best, seconds.count());
+		}
+		
+		return best;
+	}
+	
+	void PrintRow (const std::string& name, double seconds, double bytes, bool is_correct) const {
+		std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(12) << 1e3 * seconds
+			<< std::setw(12) << (0 < seconds ? bytes / seconds / (1 << 20) : 0)
+			<< "  " << (is_correct ? "ok" : "WRONG") << std::endl;
+	}
+	
+	int Run () {
+		std::error_code error;
+		std::filesystem::create_directories(scratch_directory, error);
+		auto source_path = ScratchPath("bench_wad_edit_source.wad");
+		auto output_path = ScratchPath("bench_wad_edit_output.wad");
+		
+		if(!MakeWad(source_path)) {
+			std::cout << "Can not write " << source_path << std::endl;
+			return 1;
+		}
+		
+		DoomWad source(source_path);
+		double source_bytes = source.byte_count;
+		std::vector <char> patch(source.Lump(source.FindLumpIndex(DoomWad::LumpKey("LINEDEFS"))).size + 1400, 7);
+		bool is_correct = true;
+		
+		std::cout << "wad of " << std::fixed << std::setprecision(1) << source_bytes / (1 << 20) << " MB, " << source.lump_count << " lumps" << std::endl;
+		std::cout << "benchmark                         best ms        MB/s" << std::endl;
+		
+		// Every write starts without an old output, so the rows do not include deleting it.
+		auto remove_output = [&] () {
+			std::filesystem::remove(output_path, error);
+			return true;
+		};
+		
+		auto copy = [&] (bool is_copying_in_kernel) {
+			DoomWad wad(source_path);
+			WadWriter writer;
+			writer.is_iwad = true;
+			writer.is_copying_in_kernel = is_copying_in_kernel;
+			writer.AddWad(wad);
+			return writer.Write(output_path);
+		};
+		
+		auto patch_lump = [&] (const std::string& path, bool is_in_place) {
+			DoomWad wad(path);
+			WadWriter writer;
+			writer.is_iwad = true;
+			writer.AddWad(wad);
+			writer.ReplaceLump(writer.FindLump("LINEDEFS"), patch);
+			return is_in_place ? writer.WriteInPlace(path) : writer.Write(output_path);
+		};
+		
+		auto check = [&] (const std::string& name, double seconds, const std::vector <char>* expected_patch) {
+			bool is_row_correct = 0 <= seconds && IsWadCorrect(output_path, source, expected_patch);
+			is_correct = is_correct && is_row_correct;
+			PrintRow(name, seconds, source_bytes, is_row_correct);
+		};
+		
+		check("copy, through process", BestSeconds(remove_output, [&] () { return copy(false); }), nullptr);
+		check("copy, kernel", BestSeconds(remove_output, [&] () { return copy(true); }), nullptr);
+		check("patch lump, new wad", BestSeconds(remove_output, [&] () { return patch_lump(source_path, false); }), &patch);
+		
+		// In place patches go to one copy of the source, each appending to it. The first one also
+		// waits for the copy to reach the disk and is not timed.
+		std::filesystem::copy_file(source_path, output_path, std::filesystem::copy_options::overwrite_existing, error);
+		patch_lump(output_path, true);
+		
+		auto no_prepare = [] () {
+			return true;
+		};
+		
+		check("patch lump, in place", BestSeconds(no_prepare, [&] () { return patch_lump(output_path, true); }), &patch);
+		
+		std::filesystem::remove(source_path, error);
+		std::filesystem::remove(output_path, error);
+		return is_correct ? 0 : 1;
+	}
+	
+	std::size_t size_mb = 300;
+	int lump_count = 3000;
+	int repeat_count = 3;
+	std::string scratch_directory = std::filesystem::temp_directory_path().string();
+};
+
+int main (int argc, char * argv []) {
+	WadEditBench bench;
+	
+	if(2 <= argc) {
+		bench.size_mb = std::max(1, std::atoi(argv [1]));
+	}
+	
+	if(3 <= argc) {
+		bench.lump_count = std::max(1, std::atoi(argv [2]));
+	}
+	
+	if(4 <= argc) {
+		bench.repeat_count = std::max(1, std::atoi(argv [3]));
+	}
+	
+	if(5 <= argc) {
+		bench.scratch_directory = argv [4];
+	}
+	
+	return bench.Run();
+}
@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_lattice.h"
+#include "file_helper.h"
+#include "inflate.h"
+#include "space.h"
+#include "wad_stack.h"
+#include "wad_writer.h"
+#include "zip_archive.h"
+
+// Deflate with the fixed codes and greedy matches from a one entry hash table. Far from what zip
+// tools produce in size, but the streams use literals, lengths and distances all over the range,
+// which is what the inflater spends its time on.
+struct FixedDeflater {
+	void Bits (std::uint32_t value, int count) {
+		buffer |= static_cast <std::uint64_t> (value) << bit_count;
+		bit_count += count;
+		
+		while(8 <= bit_count) {
+			out.push_back(static_cast <char> (buffer));
+			buffer >>= 8;
+			bit_count -= 8;
+		}
+	}
+	
+	// Huffman codes go out from their top bit.
+	void Code (std::uint32_t code, int length) {
+		std::uint32_t reversed = 0;
+		
+		for(int k = 0; k < length; k++) {
+			reversed |= (code >> k & 1) << (length - 1 - k);
+		}
+		
+		Bits(reversed, length);
+	}
+	
+	void Symbol (int symbol) {
+		if(symbol < 144) {
+			Code(0x30 + symbol, 8);
+		}
+		
+		else if(symbol < 256) {
+			Code(0x190 + symbol - 144, 9);
+		}
+		
+		else if(symbol < 280) {
+			Code(symbol - 256, 7);
+		}
+		
+		else {
+			Code(0xC0 + symbol - 280, 8);
+		}
+	}
+	
+	void Match (int length, int distance) {
+		static const int length_base [] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static const int length_extra [] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static const int distance_base [] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static const int distance_extra [] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+		
+		int l = 28;
+		
+		while(length < length_base [l]) {
+			l--;
+		}
+		
+		Symbol(257 + l);
+		Bits(length - length_base [l], length_extra [l]);
+		
+		int d = 29;
+		
+		while(distance < distance_base [d]) {
+			d--;
+		}
+		
+		Code(d, 5);
+		Bits(distance - distance_base [d], distance_extra [d]);
+	}
+	
+	std::vector <char> Deflate (const char* data, std::size_t size) {
+		static constexpr int hash_bits = 15;
+		static constexpr std::size_t window_size = 32768;
+		std::vector <std::int64_t> heads(1 << hash_bits, -1);
+		out.clear();
+		buffer = 0;
+		bit_count = 0;
+		
+		// One final block with the fixed codes.
+		Bits(1, 1);
+		Bits(1, 2);
+		
+		for(std::size_t k = 0; k < size; ) {
+			int length = 0;
+			std::size_t distance = 0;
+			
+			if(k + 3 <= size) {
+				std::uint32_t word = static_cast <std::uint8_t> (data [k]) | static_cast <std::uint8_t> (data [k + 1]) << 8 | static_cast <std::uint8_t> (data [k + 2]) << 16;
+				auto& head = heads [(word * 2654435761u) >> (32 - hash_bits)];
+				
+				if(0 <= head && k - head <= window_size) {
+					std::size_t max_length = std::min <std::size_t> (258, size - k);
+					distance = k - head;
+					
+					while(length < max_length && data [k + length] == data [head + length]) {
+						length++;
+					}
+				}
+				
+				head = k;
+			}
+			
+			if(3 <= length) {
+				Match(length, distance);
+				k += length;
+			}
+			
+			else {
+				Symbol(static_cast <std::uint8_t> (data [k]));
+				k++;
+			}
+		}
+		
+		Symbol(256);
+		Bits(0, 7);
+		return std::move(out);
+	}
+	
+	std::vector <char> out;
+	std::uint64_t buffer;
+	int bit_count;
+};
+
+// Benchmark of reading map wads out of a PK3. A synthetic archive holds map wads of jittered
+// lattices under maps/, most of them deflated and every fourth stored. The wads are inflated on
+// one thread and on all cores, opened as wads and pushed onto a wad stack, and each is compared
+// with the wad it was made from. The map wads of any given PK3 files are read the same way.
+//
+//	bench_zip [map count] [lattice size] [repeat count] [pk3 ...]
+struct ZipBench {
+	template <typename T>
+	static void Append (std::vector <char>& out, T value) {
+		out.insert(out.end(), reinterpret_cast <const char*> (&value), reinterpret_cast <const char*> (&value) + sizeof(T));
+	}
+	
+	// The binary DOOM lumps of a map, field by field in record order.
+	static void AddMapLumps (const DoomMap& map, WadWriter& writer) {
+		std::vector <char> things, linedefs, sidedefs, vertexes, sectors;
+		
+		for(int t = 0; t < map.ThingCount(); t++) {
+			Append <std::int16_t> (things, map.thing_x [t]);
+			Append <std::int16_t> (things, map.thing_y [t]);
+			Append <std::int16_t> (things, std::round(map.thing_angle [t] * SpaceConst::RadToDegFactor()));
+			Append <std::uint16_t> (things, map.thing_type [t]);
+			Append <std::uint16_t> (things, map.thing_flags [t]);
+		}
+		
+		for(int l = 0; l < map.LinedefCount(); l++) {
+			Append <std::uint16_t> (linedefs, map.linedef_v1 [l]);
+			Append <std::uint16_t> (linedefs, map.linedef_v2 [l]);
+			Append <std::uint16_t> (linedefs, map.linedef_flags [l]);
+			Append <std::uint16_t> (linedefs, map.linedef_special [l]);
+			Append <std::uint16_t> (linedefs, map.linedef_tag [l]);
+			Append <std::uint16_t> (linedefs, map.linedef_front [l]);
+			Append <std::uint16_t> (linedefs, map.linedef_back [l]);
+		}
+		
+		// Names are packed like lump names, eight bytes padded with zeros.
+		for(int s = 0; s < map.SidedefCount(); s++) {
+			Append <std::int16_t> (sidedefs, map.sidedef_x_offset [s]);
+			Append <std::int16_t> (sidedefs, map.sidedef_y_offset [s]);
+			Append <std::uint64_t> (sidedefs, map.sidedef_upper [s]);
+			Append <std::uint64_t> (sidedefs, map.sidedef_lower [s]);
+			Append <std::uint64_t> (sidedefs, map.sidedef_middle [s]);
+			Append <std::uint16_t> (sidedefs, map.sidedef_sector [s]);
+		}
+		
+		for(int v = 0; v < map.VertexCount(); v++) {
+			Append <std::int16_t> (vertexes, map.vertex_x [v]);
+			Append <std::int16_t> (vertexes, map.vertex_y [v]);
+		}
+		
+		for(int s = 0; s < map.SectorCount(); s++) {
+			Append <std::int16_t> (sectors, map.sector_floor_height [s]);
+			Append <std::int16_t> (sectors, map.sector_ceiling_height [s]);
+			Append <std::uint64_t> (sectors, map.sector_floor_flat [s]);
+			Append <std::uint64_t> (sectors, map.sector_ceiling_flat [s]);
+			Append <std::int16_t> (sectors, map.sector_light [s]);
+			Append <std::uint16_t> (sectors, map.sector_special [s]);
+			Append <std::uint16_t> (sectors, map.sector_tag [s]);
+		}
+		
+		writer.AddLump("THINGS", std::move(things));
+		writer.AddLump("LINEDEFS", std::move(linedefs));
+		writer.AddLump("SIDEDEFS", std::move(sidedefs));
+		writer.AddLump("VERTEXES", std::move(vertexes));
+		writer.AddLump("SECTORS", std::move(sectors));
+	}
+	
+	// A lattice map with whole unit vertices, as one PWAD written to path and read back.
+	std::vector <char> MakeMapWad (int map_number, const std::string& path) const {
+		BenchLattice lattice;
+		lattice.size = lattice_size;
+		lattice.seed = map_number;
+		lattice.jitter_step = 1;
+		
+		char marker [9];
+		std::snprintf(marker, sizeof(marker), "MAP%02d", map_number % 100);
+		WadWriter writer;
+		writer.AddLump(marker, {});
+		AddMapLumps(lattice.Make(), writer);
+		std::vector <char> wad;
+		
+		if(!writer.Write(path) || !SlurpByteFile(wad, path)) {
+			wad.clear();
+		}
+		
+		return wad;
+	}
+	
+	// Local headers with the data, then the central directory and the end record.
+	bool WriteZip (const std::string& path, const std::vector <std::string>& names, const std::vector <std::vector <char>>& files) const {
+		std::vector <char> zip;
+		std::vector <char> directory;
+		FixedDeflater deflater;
+		
+		for(std::size_t k = 0; k < files.size(); k++) {
+			bool is_stored = 3 == k % 4;
+			auto stored = is_stored ? files [k] : deflater.Deflate(files [k].data(), files [k].size());
+			std::uint32_t crc = Crc32(files [k].data(), files [k].size());
+			std::uint32_t offset = zip.size();
+			
+			auto header = [&] (std::vector <char>& out, bool is_central) {
+				Append <std::uint32_t> (out, is_central ? 0x02014B50 : 0x04034B50);
+				
+				if(is_central) {
+					Append <std::uint16_t> (out, 20);
+				}
+				
+				Append <std::uint16_t> (out, 20);
+				Append <std::uint16_t> (out, 0);
+				Append <std::uint16_t> (out, is_stored ? 0 : 8);
+				Append <std::uint32_t> (out, 0);
+				Append <std::uint32_t> (out, crc);
+				Append <std::uint32_t> (out, stored.size());
+				Append <std::uint32_t> (out, files [k].size());
+				Append <std::uint16_t> (out, names [k].size());
+				Append <std::uint16_t> (out, 0);
+				
+				if(is_central) {
+					Append <std::uint16_t> (out, 0);
+					Append <std::uint16_t> (out, 0);
+					Append <std::uint16_t> (out, 0);
+					Append <std::uint32_t> (out, 0);
+					Append <std::uint32_t> (out, offset);
+				}
+				
+				out.insert(out.end(), names [k].begin(), names [k].end());
+			};
+			
+			header(zip, false);
+			zip.insert(zip.end(), stored.begin(), stored.end());
+			header(directory, true);
+		}
+		
+		std::uint32_t directory_offset = zip.size();
+		zip.insert(zip.end(), directory.begin(), directory.end());
+		Append <std::uint32_t> (zip, 0x06054B50);
+		Append <std::uint16_t> (zip, 0);
+		Append <std::uint16_t> (zip, 0);
+		Append <std::uint16_t> (zip, files.size());
+		Append <std::uint16_t> (zip, files.size());
+		Append <std::uint32_t> (zip, directory.size());
+		Append <std::uint32_t> (zip, directory_offset);
+		Append <std::uint16_t> (zip, 0);
+		
+		std::ofstream file(path, std::ios::binary);
+		file.write(zip.data(), zip.size());
+		return file.good();
+	}
+	
+	double BestSeconds (const std::function <void ()>& func) const {
+		double best = 1e30;
+		
+		for(int r = 0; r < repeat_count; r++) {
+			auto start = std::chrono::steady_clock::now();
+			func();
+			std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::min(best, seconds.count());
+		}
+		
+		return best;
+	}
+	
+	void PrintRow (const std::string& name, double seconds, double bytes, bool is_correct) const {
+		std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(12) << 1e3 * seconds
+			<< std::setw(12) << std::setprecision(1) << bytes / seconds / (1 << 20)
+			<< "  " << (is_correct ? "ok" : "WRONG") << std::endl;
+	}
+	
+	// Inflating on one thread and on all cores, opening the wads and pushing them on a stack.
+	// Rows are in MB/s of wad bytes.
+	bool BenchArchive (const std::string& path, const std::vector <std::vector <char>>* expected) const {
+		int core_count = std::max(1u, std::thread::hardware_concurrency());
+		ZipArchive archive;
+		double open_seconds = BestSeconds( [&] () { archive = ZipArchive(path); } );
+		auto map_wads = archive.MapWadEntries();
+		double wad_bytes = 0;
+		double compressed_bytes = 0;
+		
+		for(int entry: map_wads) {
+			wad_bytes += archive.entries [entry].size;
+			compressed_bytes += archive.entries [entry].compressed_size;
+		}
+		
+		std::cout << path << ": " << archive.entries.size() << " entries, " << map_wads.size() << " map wads, "
+			<< std::fixed << std::setprecision(1) << wad_bytes / (1 << 20) << " MB in "
+			<< compressed_bytes / (1 << 20) << " MB" << std::endl;
+		std::cout << "benchmark                         best ms        MB/s" << std::endl;
+		PrintRow("open archive", open_seconds, wad_bytes, archive.IsLoaded());
+		
+		std::vector <std::vector <char>> files;
+		bool is_correct = true;
+		
+		std::vector <int> thread_counts = { 1 };
+		
+		if(1 < core_count) {
+			thread_counts.push_back(core_count);
+		}
+		
+		for(int threads: thread_counts) {
+			bool is_read = true;
+			double seconds = BestSeconds( [&] () { is_read = archive.ReadEntries(map_wads, files, threads); } );
+			is_read = is_read && (!expected || files == *expected);
+			is_correct = is_correct && is_read;
+			PrintRow("read entries, " + std::to_string(threads) + " threads", seconds, wad_bytes, is_read);
+		}
+		
+		std::vector <DoomWad> wads;
+		double seconds = BestSeconds( [&] () { wads = archive.OpenWads(map_wads); } );
+		bool is_opened = wads.size() == map_wads.size();
+		
+		for(std::size_t k = 0; is_opened && k < wads.size(); k++) {
+			is_opened =
+				wads [k].IsLoaded() && 1 == wads [k].maps.size() &&
+				(!expected || 0 == std::memcmp(wads [k].bytes, (*expected) [k].data(), (*expected) [k].size()));
+		}
+		
+		is_correct = is_correct && is_opened;
+		PrintRow("open wads, " + std::to_string(core_count) + " threads", seconds, wad_bytes, is_opened);
+		
+		WadStack stack;
+		seconds = BestSeconds( [&] () { stack.Clear(); stack.Push(path); } );
+		bool is_pushed = stack.WadCount() == map_wads.size() && 0 < stack.MapCount();
+		is_correct = is_correct && is_pushed;
+		PrintRow("push onto wad stack", seconds, wad_bytes, is_pushed);
+		return is_correct;
+	}
+	
+	int Run (const std::vector <std::string>& pk3_paths) {
+		auto path = (std::filesystem::temp_directory_path() / "bench_zip.pk3").string();
+		auto wad_path = (std::filesystem::temp_directory_path() / "bench_zip_map.wad").string();
+		std::vector <std::string> names;
+		std::vector <std::vector <char>> files;
+		bool is_written = true;
+		
+		for(int m = 0; m < map_count && is_written; m++) {
+			char name [32];
+			std::snprintf(name, sizeof(name), "maps/map%02d.wad", m + 1);
+			names.push_back(name);
+			files.push_back(MakeMapWad(m + 1, wad_path));
+			is_written = !files.back().empty();
+		}
+		
+		std::filesystem::remove(wad_path);
+		
+		if(!is_written || !WriteZip(path, names, files)) {
+			std::cout << "Can not write " << (is_written ? path : wad_path) << std::endl;
+			return 1;
+		}
+		
+		bool is_correct = BenchArchive(path, &files);
+		std::filesystem::remove(path);
+		
+		for(const auto& pk3_path: pk3_paths) {
+			BenchArchive(pk3_path, nullptr);
+		}
+		
+		return is_correct ? 0 : 1;
+	}
+	
+	int map_count = 32;
+	int lattice_size = 100;
+	int repeat_count = 3;
+};
+
+int main (int argc, char * argv []) {
+	ZipBench bench;
+	std::vector <std::string> pk3_paths;
+	
+	if(2 <= argc) {
+		bench.map_count = std::clamp(std::atoi(argv [1]), 1, 99);
+	}
+	
+	if(3 <= argc) {
+		bench.lattice_size = std::clamp(std::atoi(argv [2]), 1, 180);
+	}
+	
+	if(4 <= argc) {
+		bench.repeat_count = std::max(1, std::atoi(argv [3]));
+	}
+	
+	for(int k = 4; k < argc; k++) {
+		pk3_paths.push_back(argv [k]);
+	}
+	
+	return bench.Run(pk3_paths);
+}
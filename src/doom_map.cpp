@@ -0,0 +1,353 @@
+#include "doom_map.h"
+#include "space.h"
+#include "map_bsp.h"
+#include "udmf.h"
+#include <cstring>
+
+// Map records are packed and lumps have no alignment, so fields are copied out.
+template <typename T>
+static T ReadField (const char* record, int offset) {
+	T value;
+	std::memcpy(&value, record + offset, sizeof(T));
+	return value;
+}
+
+// Vanilla references are 16 bit and 0xFFFF means none. Reading them unsigned lets maps with more
+// than 32767 sidedefs or vertices work, the same as the common source ports.
+static std::uint32_t ReadIndex (const char* record, int offset) {
+	auto index = ReadField <std::uint16_t> (record, offset);
+	return 0xFFFF == index ? DoomMap::no_index : index;
+}
+
+static std::uint64_t ReadName (const char* record, int offset) {
+	return DoomWad::LumpKey(record + offset, 8);
+}
+
+// Binary angles, a full turn is 65536.
+static float ReadAngle (const char* record, int offset) {
+	return ReadField <std::uint16_t> (record, offset) * static_cast <float> (2 * SpaceConst::Pi() / 65536);
+}
+
+// Specials are a byte in Hexen records.
+template <typename Record>
+static std::uint16_t ReadSpecial (const char* record) {
+	if constexpr(1 == Record::special_size) {
+		return ReadField <std::uint8_t> (record, Record::special);
+	}
+	
+	else {
+		return ReadField <std::uint16_t> (record, Record::special);
+	}
+}
+
+template <typename Record>
+static void ReadArgs (const char* record, std::int32_t* args) {
+	for(int a = 0; a < special_arg_count; a++) {
+		args [a] = ReadField <std::uint8_t> (record, Record::args + a);
+	}
+}
+
+// One decoder for THINGS and LINEDEFS in every binary format. The layout is a template argument,
+// so the loops have constant offsets and no test of the format per record. Fields the format
+// does not have stay zero.
+template <typename Record>
+static void DecodeThings (const char* data, int size, DoomMap& map) {
+	int count = size / Record::size;
+	map.thing_x.resize(count);
+	map.thing_y.resize(count);
+	map.thing_angle.resize(count);
+	map.thing_type.resize(count);
+	map.thing_flags.resize(count);
+	map.thing_z.resize(count);
+	map.thing_tid.resize(count);
+	map.thing_special.resize(count);
+	map.thing_args.resize(special_arg_count * count);
+	
+	for(int t = 0; t < count; t++) {
+		const char* record = data + Record::size * t;
+		map.thing_x [t] = ReadField <std::int16_t> (record, Record::x);
+		map.thing_y [t] = ReadField <std::int16_t> (record, Record::y);
+		
+		// Thing angles are in degrees.
+		map.thing_angle [t] = ReadField <std::int16_t> (record, Record::angle) * static_cast <float> (SpaceConst::DegToRadFactor());
+		map.thing_type [t] = ReadField <std::uint16_t> (record, Record::type);
+		map.thing_flags [t] = ReadField <std::uint16_t> (record, Record::flags);
+		
+		if constexpr(no_field != Record::z) {
+			
+			// Hexen uses 0x10 for dormant and has its own mode bits, keep skills and ambush and turn a
+			// clear single player bit into the DOOM multiplayer only bit.
+			std::uint16_t flags = map.thing_flags [t];
+			map.thing_flags [t] = (flags & 0x000f) | (0 == (flags & 0x0100) ? 0x0010 : 0);
+			map.thing_z [t] = ReadField <std::int16_t> (record, Record::z);
+			map.thing_tid [t] = ReadField <std::uint16_t> (record, Record::tid);
+			map.thing_special [t] = ReadSpecial <Record> (record);
+			ReadArgs <Record> (record, map.thing_args.data() + special_arg_count * t);
+		}
+	}
+}
+
+template <typename Record>
+static void DecodeLinedefs (const char* data, int size, DoomMap& map) {
+	int count = size / Record::size;
+	map.linedef_v1.resize(count);
+	map.linedef_v2.resize(count);
+	map.linedef_flags.resize(count);
+	map.linedef_special.resize(count);
+	map.linedef_tag.resize(count);
+	map.linedef_front.resize(count);
+	map.linedef_back.resize(count);
+	map.linedef_args.resize(special_arg_count * count);
+	
+	for(int l = 0; l < count; l++) {
+		const char* record = data + Record::size * l;
+		map.linedef_v1 [l] = ReadField <std::uint16_t> (record, Record::v1);
+		map.linedef_v2 [l] = ReadField <std::uint16_t> (record, Record::v2);
+		map.linedef_flags [l] = ReadField <std::uint16_t> (record, Record::flags);
+		map.linedef_special [l] = ReadSpecial <Record> (record);
+		map.linedef_front [l] = ReadIndex(record, Record::front);
+		map.linedef_back [l] = ReadIndex(record, Record::back);
+		
+		if constexpr(no_field != Record::tag) {
+			map.linedef_tag [l] = ReadField <std::uint16_t> (record, Record::tag);
+		}
+		
+		if constexpr(no_field != Record::args) {
+			ReadArgs <Record> (record, map.linedef_args.data() + special_arg_count * l);
+		}
+	}
+}
+
+DoomMap::DoomMap () {
+	name_key = 0;
+	format = doom_map_format;
+}
+
+void DoomMap::Clear () {
+	*this = DoomMap();
+}
+
+bool DoomMap::Decode (const DoomWad& wad, int map_index) {
+	static const std::uint64_t things_key = DoomWad::LumpKey("THINGS");
+	static const std::uint64_t linedefs_key = DoomWad::LumpKey("LINEDEFS");
+	static const std::uint64_t sidedefs_key = DoomWad::LumpKey("SIDEDEFS");
+	static const std::uint64_t vertexes_key = DoomWad::LumpKey("VERTEXES");
+	static const std::uint64_t segs_key = DoomWad::LumpKey("SEGS");
+	static const std::uint64_t ssectors_key = DoomWad::LumpKey("SSECTORS");
+	static const std::uint64_t nodes_key = DoomWad::LumpKey("NODES");
+	static const std::uint64_t sectors_key = DoomWad::LumpKey("SECTORS");
+	static const std::uint64_t reject_key = DoomWad::LumpKey("REJECT");
+	static const std::uint64_t blockmap_key = DoomWad::LumpKey("BLOCKMAP");
+	static const std::uint64_t textmap_key = DoomWad::LumpKey("TEXTMAP");
+	
+	Clear();
+	
+	if(map_index < 0 || wad.maps.size() <= map_index) {
+		return false;
+	}
+	
+	const auto& map_info = wad.maps [map_index];
+	name_key = map_info.key;
+	format = map_info.format;
+	bool is_hexen = hexen_map_format == format;
+	
+	// Nodes in the other formats change the seg and subsector records too, those are left to
+	// MapBsp and the BSP arrays stay empty.
+	bool is_vanilla_bsp = true;
+	int nodes_lump = wad.FindMapLump(map_index, nodes_key);
+	
+	if(0 <= nodes_lump && wad.IsLumpValid(wad.Lump(nodes_lump))) {
+		is_vanilla_bsp = MapBsp::IsVanillaNodesLump(wad.LumpData(wad.Lump(nodes_lump)), wad.Lump(nodes_lump).size);
+	}
+	
+	for(int k = map_info.first_lump; k < map_info.end_lump; k++) {
+		const auto& lump = wad.Lump(k);
+		
+		if(!wad.IsLumpValid(lump)) {
+			continue;
+		}
+		
+		const char* data = wad.LumpData(lump);
+		auto key = wad.lump_keys [k];
+		
+		if(things_key == key && is_hexen) {
+			DecodeThings <HexenThingRecord> (data, lump.size, *this);
+		}
+		
+		else if(things_key == key) {
+			DecodeThings <DoomThingRecord> (data, lump.size, *this);
+		}
+		
+		else if(linedefs_key == key && is_hexen) {
+			DecodeLinedefs <HexenLinedefRecord> (data, lump.size, *this);
+		}
+		
+		else if(linedefs_key == key) {
+			DecodeLinedefs <DoomLinedefRecord> (data, lump.size, *this);
+		}
+		
+		else if(sidedefs_key == key) {
+			int count = lump.size / 30;
+			sidedef_x_offset.resize(count);
+			sidedef_y_offset.resize(count);
+			sidedef_upper.resize(count);
+			sidedef_lower.resize(count);
+			sidedef_middle.resize(count);
+			sidedef_sector.resize(count);
+			
+			for(int s = 0; s < count; s++) {
+				const char* record = data + 30 * s;
+				sidedef_x_offset [s] = ReadField <std::int16_t> (record, 0);
+				sidedef_y_offset [s] = ReadField <std::int16_t> (record, 2);
+				sidedef_upper [s] = ReadName(record, 4);
+				sidedef_lower [s] = ReadName(record, 12);
+				sidedef_middle [s] = ReadName(record, 20);
+				sidedef_sector [s] = ReadIndex(record, 28);
+			}
+		}
+		
+		else if(vertexes_key == key) {
+			int count = lump.size / 4;
+			vertex_x.resize(count);
+			vertex_y.resize(count);
+			
+			for(int v = 0; v < count; v++) {
+				vertex_x [v] = ReadField <std::int16_t> (data, 4 * v);
+				vertex_y [v] = ReadField <std::int16_t> (data, 4 * v + 2);
+			}
+		}
+		
+		else if(segs_key == key && is_vanilla_bsp) {
+			int count = lump.size / 12;
+			seg_v1.resize(count);
+			seg_v2.resize(count);
+			seg_angle.resize(count);
+			seg_linedef.resize(count);
+			seg_side.resize(count);
+			seg_offset.resize(count);
+			
+			for(int s = 0; s < count; s++) {
+				const char* record = data + 12 * s;
+				seg_v1 [s] = ReadField <std::uint16_t> (record, 0);
+				seg_v2 [s] = ReadField <std::uint16_t> (record, 2);
+				seg_angle [s] = ReadAngle(record, 4);
+				seg_linedef [s] = ReadIndex(record, 6);
+				seg_side [s] = 0 != ReadField <std::uint16_t> (record, 8);
+				seg_offset [s] = ReadField <std::int16_t> (record, 10);
+			}
+		}
+		
+		else if(ssectors_key == key && is_vanilla_bsp) {
+			int count = lump.size / 4;
+			subsector_seg_count.resize(count);
+			subsector_first_seg.resize(count);
+			
+			for(int s = 0; s < count; s++) {
+				subsector_seg_count [s] = ReadField <std::uint16_t> (data, 4 * s);
+				subsector_first_seg [s] = ReadField <std::uint16_t> (data, 4 * s + 2);
+			}
+		}
+		
+		else if(nodes_key == key && is_vanilla_bsp) {
+			int count = lump.size / 28;
+			node_x.resize(count);
+			node_y.resize(count);
+			node_dx.resize(count);
+			node_dy.resize(count);
+			node_boxes.resize(8 * count);
+			node_right.resize(count);
+			node_left.resize(count);
+			
+			// Vanilla children use the top bit of 16 for subsectors.
+			auto read_child = [] (const char* record, int offset) {
+				auto child = ReadField <std::uint16_t> (record, offset);
+				return 0 != (child & 0x8000) ? subsector_child | (child & 0x7FFF) : child;
+			};
+			
+			for(int n = 0; n < count; n++) {
+				const char* record = data + 28 * n;
+				node_x [n] = ReadField <std::int16_t> (record, 0);
+				node_y [n] = ReadField <std::int16_t> (record, 2);
+				node_dx [n] = ReadField <std::int16_t> (record, 4);
+				node_dy [n] = ReadField <std::int16_t> (record, 6);
+				
+				for(int b = 0; b < 8; b++) {
+					node_boxes [8 * n + b] = ReadField <std::int16_t> (record, 8 + 2 * b);
+				}
+				
+				node_right [n] = read_child(record, 24);
+				node_left [n] = read_child(record, 26);
+			}
+		}
+		
+		else if(sectors_key == key) {
+			int count = lump.size / 26;
+			sector_floor_height.resize(count);
+			sector_ceiling_height.resize(count);
+			sector_floor_flat.resize(count);
+			sector_ceiling_flat.resize(count);
+			sector_light.resize(count);
+			sector_special.resize(count);
+			sector_tag.resize(count);
+			
+			for(int s = 0; s < count; s++) {
+				const char* record = data + 26 * s;
+				sector_floor_height [s] = ReadField <std::int16_t> (record, 0);
+				sector_ceiling_height [s] = ReadField <std::int16_t> (record, 2);
+				sector_floor_flat [s] = ReadName(record, 4);
+				sector_ceiling_flat [s] = ReadName(record, 12);
+				sector_light [s] = ReadField <std::uint16_t> (record, 20);
+				sector_special [s] = ReadField <std::uint16_t> (record, 22);
+				sector_tag [s] = ReadField <std::uint16_t> (record, 24);
+			}
+		}
+		
+		else if(reject_key == key) {
+			reject.assign(data, data + lump.size);
+		}
+		
+		else if(blockmap_key == key) {
+			blockmap.assign(data, data + lump.size);
+		}
+		
+		// UDMF maps have every record in this one lump.
+		else if(textmap_key == key) {
+			UdmfParser parser;
+			parser.Parse(data, lump.size, *this);
+		}
+	}
+	
+	return true;
+}
+
+int DoomMap::VertexCount () const {
+	return vertex_x.size();
+}
+
+int DoomMap::LinedefCount () const {
+	return linedef_v1.size();
+}
+
+int DoomMap::SidedefCount () const {
+	return sidedef_sector.size();
+}
+
+int DoomMap::SectorCount () const {
+	return sector_floor_height.size();
+}
+
+int DoomMap::ThingCount () const {
+	return thing_x.size();
+}
+
+int DoomMap::SegCount () const {
+	return seg_v1.size();
+}
+
+int DoomMap::SubsectorCount () const {
+	return subsector_first_seg.size();
+}
+
+int DoomMap::NodeCount () const {
+	return node_x.size();
+}
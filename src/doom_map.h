@@ -0,0 +1,109 @@
+#ifndef DOOM_MAP_H
+#define DOOM_MAP_H
+
+#include <cstdint>
+#include <vector>
+#include "map_records.h"
+#include "wad_file.h"
+
+// All records of a map, decoded into one array per field. A pass that only needs line vertices
+// or sector heights streams over just those arrays. Element k of every array of a kind belongs
+// to record k, references between records are indices and no_index marks a missing one.
+// Texture and flat names are packed into 64 bits like lump names. Fields only Hexen and UDMF maps
+// have are zero for DOOM maps.
+struct DoomMap {
+	static constexpr std::uint32_t no_index = 0xFFFFFFFF;
+	
+	// Node children with this bit set are subsectors, the others are nodes.
+	static constexpr std::uint32_t subsector_child = 0x80000000;
+	
+	DoomMap ();
+	
+	void Clear ();
+	
+	// Decode every map lump in one pass over the map's directory range, binary lumps in DOOM or
+	// Hexen format or a UDMF TEXTMAP. Lumps that are missing or cut short leave their arrays
+	// empty or shorter. Returns false for an invalid map index.
+	bool Decode (const DoomWad& wad, int map_index);
+	
+	int VertexCount () const;
+	int LinedefCount () const;
+	int SidedefCount () const;
+	int SectorCount () const;
+	int ThingCount () const;
+	int SegCount () const;
+	int SubsectorCount () const;
+	int NodeCount () const;
+	
+	std::uint64_t name_key;
+	MapFormat format;
+	
+	std::vector <float> vertex_x;
+	std::vector <float> vertex_y;
+	
+	std::vector <std::uint32_t> linedef_v1;
+	std::vector <std::uint32_t> linedef_v2;
+	std::vector <std::uint16_t> linedef_flags;
+	std::vector <std::uint16_t> linedef_special;
+	std::vector <std::uint16_t> linedef_tag;
+	std::vector <std::uint32_t> linedef_front;
+	std::vector <std::uint32_t> linedef_back;
+	
+	// Action arguments, special_arg_count per record.
+	std::vector <std::int32_t> linedef_args;
+	
+	std::vector <float> sidedef_x_offset;
+	std::vector <float> sidedef_y_offset;
+	std::vector <std::uint64_t> sidedef_upper;
+	std::vector <std::uint64_t> sidedef_lower;
+	std::vector <std::uint64_t> sidedef_middle;
+	std::vector <std::uint32_t> sidedef_sector;
+	
+	std::vector <float> sector_floor_height;
+	std::vector <float> sector_ceiling_height;
+	std::vector <std::uint64_t> sector_floor_flat;
+	std::vector <std::uint64_t> sector_ceiling_flat;
+	std::vector <std::uint16_t> sector_light;
+	std::vector <std::uint16_t> sector_special;
+	std::vector <std::uint16_t> sector_tag;
+	
+	std::vector <float> thing_x;
+	std::vector <float> thing_y;
+	std::vector <float> thing_angle;
+	std::vector <std::uint16_t> thing_type;
+	
+	// Skill, ambush and multiplayer only bits in the DOOM layout, whatever the format.
+	std::vector <std::uint16_t> thing_flags;
+	std::vector <float> thing_z;
+	std::vector <std::uint16_t> thing_tid;
+	std::vector <std::uint16_t> thing_special;
+	std::vector <std::int32_t> thing_args;
+	
+	// BSP output of the node builder, angles in radians. Only vanilla nodes decode here, MapBsp
+	// reads every format into a tree for queries.
+	std::vector <std::uint32_t> seg_v1;
+	std::vector <std::uint32_t> seg_v2;
+	std::vector <float> seg_angle;
+	std::vector <std::uint32_t> seg_linedef;
+	std::vector <std::uint8_t> seg_side;
+	std::vector <float> seg_offset;
+	
+	std::vector <std::uint32_t> subsector_seg_count;
+	std::vector <std::uint32_t> subsector_first_seg;
+	
+	// Partition lines and the children on their right (front) and left (back) side. Boxes hold
+	// top, bottom, left and right, for the right child first.
+	std::vector <float> node_x;
+	std::vector <float> node_y;
+	std::vector <float> node_dx;
+	std::vector <float> node_dy;
+	std::vector <float> node_boxes;
+	std::vector <std::uint32_t> node_right;
+	std::vector <std::uint32_t> node_left;
+	
+	// Raw lumps without a field structure worth splitting up.
+	std::vector <char> reject;
+	std::vector <char> blockmap;
+};
+
+#endif
@@ -1,323 +1,160 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <thread>
 #include <vector>
-#include <algorithm>
-#include <cmath>
-#include <glad/glad.h>
-#include <glfw/glfw3.h>
-#include "gl_helper.cpp"
-#include "space.cpp"
+#include "doom_wad.h"
+#include "map_raster.h"
+#include "work_pool.h"
 
-struct WadApp {
-	WadApp (WadAppData& app_data) : d(app_data) {}
-	
-	// Open a DOOM wad file for display. This resets the display.
-	void OpenWad (std::string path) {
-		d.wad_map_index = 0;
-		d.open_wad_path = path;
-		d.wad = DoomWad(d.open_wad_path);
-		d.display_timer = d.wad.IsLoaded() ? 0 : -1;
+// Renders an overview image of every map in a list of wads, without a window or open-gl. Every
+// map is a job of its own and the jobs run on the work pool, so a single large megawad spreads
+// over all cores as well.
+struct HeadlessRenderer {
+	HeadlessRenderer () {
+		output_path = ".";
+		image_size = 512;
+		thread_count = 0;
 	}
 	
-	void OnFirstTick () {
-		
-		// User settings.
-		d.window_x_size = 1280;
-		d.window_y_size = 720;
-		d.zoom_f = 1.0;
-		d.zoom_target_f = d.zoom_f;
-		d.map_rotation_rad_target = 0;
-		d.map_rotation_rad = 0;
-		d.display_timer = -1;
-		
-		// Initialise GLFW for rendering and viewing.
-		glfwInit();
-		glfwDefaultWindowHints();
-		d.window = glfwCreateWindow(d.window_x_size, d.window_y_size, "Map Viewer", nullptr, nullptr);
-		glfwMakeContextCurrent(d.window);
-		
-		glfwSetWindowUserPointer(d.window, this);
-		
-		glfwSetScrollCallback(d.window, [] (GLFWwindow* window, double scroll_x, double scroll_y) {
-			auto* app = reinterpret_cast <WadApp*> (glfwGetWindowUserPointer(window));
-			app->d.zoom_target_f = std::clamp(app->d.zoom_target_f + scroll_y / 15, 0.25, 4.0);
+	// Arguments are [-o output directory] [-s image size] [-j thread count] wad files...
+	bool ParseArgs (int arg_count, char** args) {
+		for(int k = 0; k < arg_count; k++) {
+			std::string arg = args [k];
+			bool has_value = k + 1 < arg_count;
 			
-		});
-		
-		glfwSetDropCallback(d.window, [] (GLFWwindow* window, int path_count, const char* paths []) {
-			auto* app = reinterpret_cast <WadApp*> (glfwGetWindowUserPointer(window));
-			app->OpenWad(paths [0]);
-		});
-		
-		// Ensure the viewport resizes with the window.
-		glfwSetFramebufferSizeCallback(d.window, [] (GLFWwindow* window, int x_size, int y_size) {
-			glViewport(0, 0, x_size, y_size);
-		});
-		
-		glfwGetCursorPos(d.window, &d.cursor_x_pos, &d.cursor_y_pos);
-		d.cursor_dx = 0;
-		d.cursor_dy = 0;
-		
-		glfwGetWindowSize(d.window, &d.window_x_size, &d.window_y_size);
-		
-		// Rendering setup for open-gl.
-		gladLoadGL();
-		glDisable(GL_LINE_SMOOTH);
-		glPointSize(3);
-		glLineWidth(1);
-		
-		d.map_draw_program = d.gl_funcs.LoadProgram( {
-			{ "shader_map_vertex.txt", GL_VERTEX_SHADER },
-			{ "shader_map_fragment.txt", GL_FRAGMENT_SHADER }
-		});
-		
-		d.bar_draw_program = d.gl_funcs.LoadProgram( {
-			{ "shader_zoom_bar_vertex.txt", GL_VERTEX_SHADER },
-			{ "shader_zoom_bar_fragment.txt", GL_FRAGMENT_SHADER }
-		});
-		
-		d.grid_draw_program = d.gl_funcs.LoadProgram( {
-			{ "shader_map_grid_vertex.txt", GL_VERTEX_SHADER },
-			{ "shader_map_grid_fragment.txt", GL_FRAGMENT_SHADER }
-		});
-		
-		// If there is a command line argument, try opening it.
-		if(2 <= d.cmd_arg_count) {
-			OpenWad(d.cmd_args [1]);
+			if("-o" == arg && has_value) {
+				output_path = args [++k];
+			}
 			
-			if(d.wad.IsLoaded() && 3 <= d.cmd_arg_count) {
-				d.wad_map_index = std::stoi(d.cmd_args [2]);
+			else if("-s" == arg && has_value) {
+				image_size = std::max(16, std::atoi(args [++k]));
+			}
+			
+			else if("-j" == arg && has_value) {
+				thread_count = std::max(1, std::atoi(args [++k]));
+			}
+			
+			else {
+				wad_paths.push_back(arg);
 			}
 		}
-	}
-	
-	void OnFirstMapTick () {
-		
-		d.zoom_f = 1.0;
-		d.zoom_target_f = d.zoom_f;
-		
-		std::string current_map;
-		d.wad_funcs.Doom2MapLumpName(current_map, d.wad_map_index);
-		
-		// Open up a DOOM wad and see what's inside.
-		d.wad.BeginLumpSearch();
-		d.wad.FindLump(current_map);
-		
-		if(!d.wad.LumpExists()) {
-			d.display_timer = -1;
-			return;
-		}
-		
-		d.wad_funcs.StoreLump(d.wad, { current_map, "VERTEXES" });
-		d.map_vertices = d.wad_funcs.VanillaVertexesLumpToFloat();
-		
-		d.wad_funcs.StoreLump(d.wad, { current_map, "LINEDEFS" });
-		auto indices = d.wad_funcs.VanillaLinedefsLumpToVertexIndices();
-		
-		d.wad_funcs.StoreLump(d.wad, { current_map, "THINGS" });
-		auto things = d.wad_funcs.VanillaThingsLumpToFloat();
-				
-		glBindBuffer(GL_ARRAY_BUFFER, 1);
-		glBufferData(GL_ARRAY_BUFFER, d.map_vertices.size() * sizeof(float), d.map_vertices.data(), GL_STATIC_DRAW);
-		
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 2);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices [0]), indices.data(), GL_STATIC_DRAW);
 		
-		glBindBuffer(GL_ARRAY_BUFFER, 3);
-		glBufferData(GL_ARRAY_BUFFER, things.size() * sizeof(float), things.data(), GL_STATIC_DRAW);
-				
-		d.vertex_count = indices.size();
-		d.thing_count = things.size();
-		
-		std::vector <float> quad;
-		d.gl_model_funcs.Make2dQuadTris(quad);
-		glBindBuffer(GL_ARRAY_BUFFER, 200);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * quad.size(), quad.data(), GL_STATIC_DRAW);
-		
-		// Full screen quad for the background grid.
-		std::vector <float> screen_quad;
-		d.gl_model_funcs.Make2dQuadTris(screen_quad);
-		d.gl_model_funcs.Rescale2dModel(screen_quad, 2, 0.5, 0.5);
-		glBindBuffer(GL_ARRAY_BUFFER, 201);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * screen_quad.size(), screen_quad.data(), GL_STATIC_DRAW);
-		
-		// Arrows for things.
-		std::vector <float> arrow;
-		d.gl_model_funcs.Make2dArrow(arrow);
-		d.gl_model_funcs.Rescale2dModel(arrow, 1, 0.5, 0.5);
-		glBindBuffer(GL_ARRAY_BUFFER, 202);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * arrow.size(), arrow.data(), GL_STATIC_DRAW);
-	}
-	
-	void OnLastTick () {
-		glfwTerminate();
+		return !wad_paths.empty();
 	}
 	
-	void OnTick () {
-		if(0 == d.display_timer) {
-			OnFirstMapTick();
+	int Run (int arg_count, char** args) {
+		if(!ParseArgs(arg_count, args)) {
+			std::cout << "Usage: --headless [-o output directory] [-s image size] [-j threads] file.wad..." << std::endl;
+			return 1;
 		}
 		
-		auto old_cursor_x_pos = d.cursor_x_pos;
-		auto old_cursor_y_pos = d.cursor_y_pos;
+		auto start_time = std::chrono::steady_clock::now();
+		std::filesystem::create_directories(output_path);
+		WorkPool pool(thread_count);
 		
-		glfwGetCursorPos(d.window, &d.cursor_x_pos, &d.cursor_y_pos);
+		// Opening only maps the files and reads their directories.
+		std::vector <DoomWad> wads(wad_paths.size());
 		
-		d.cursor_dx = d.cursor_x_pos - old_cursor_x_pos;
-		d.cursor_dy = d.cursor_y_pos - old_cursor_y_pos;
-		
-		float zoom_lerp_f = 0.25;
-		d.zoom_f = zoom_lerp_f * d.zoom_target_f + (1 - zoom_lerp_f) * d.zoom_f;
+		pool.Run(wads.size(), [&] (int k, int thread) {
+			wads [k] = DoomWad(wad_paths [k]);
+		});
 		
-		float rot_lerp_f = 0.25;
-		d.map_rotation_rad = rot_lerp_f * d.map_rotation_rad_target + (1 - rot_lerp_f) * d.map_rotation_rad;
+		struct MapJob {
+			int wad_index;
+			int map_index;
+		};
 		
-		auto map_scale = 1.0 / 2000 * d.zoom_f;
+		std::vector <MapJob> jobs;
 		
-		// Handle mouse button inputs. Here is panning.
-		if(glfwGetMouseButton(d.window, 0)) {
-			d.map_x_pos -= d.cursor_dx * d.zoom_f;
-			d.map_y_pos += d.cursor_dy * d.zoom_f;
-		}
-		
-		// Mouse input for rotation.
-		if(glfwGetMouseButton(d.window, 1)) {
-			d.map_rotation_rad_target += d.cursor_dx * 0.005;
+		for(int w = 0; w < wads.size(); w++) {
+			if(!wads [w].IsLoaded()) {
+				std::cout << "Could not open wad: " << wad_paths [w] << std::endl;
+			}
+			
+			for(int m = 0; m < wads [w].maps.size(); m++) {
+				jobs.push_back( { w, m } );
+			}
 		}
 		
-		// Shader inputs to scale the map lines and grid.
-		auto zoom_unit_f = (d.zoom_f - 0.25) / (4.0 - 0.25);
-		auto aspect_ratio_f = 1.0 * d.window_x_size / d.window_y_size;
-		
-		glUseProgram(d.map_draw_program);
-		glUniform2f(0, (float)d.map_x_pos, (float)d.map_y_pos);
-		// glUniform2f(0, 0, 0);
-		glUniform1f(1, map_scale);
-		glUniform1f(2, 0);
-		glUniform1f(3, aspect_ratio_f);
-		glUniform1f(4, d.map_rotation_rad);
-		
-		glUseProgram(d.bar_draw_program);
-		glUniform1f(0, zoom_unit_f);
-		glUniform4f(1, 1, 0, 0, 1);
-		
-		glUseProgram(d.grid_draw_program);
-		glUniform1f(2, map_scale);
-		glUniform1f(3, aspect_ratio_f);
-		glUniform2f(4, (float)d.map_x_pos, (float)d.map_y_pos);
-		glUniform1f(5, d.map_rotation_rad);
+		// Images are named after the wad file. Wads of the same name from different folders get
+		// their place in the argument list as well, so they do not overwrite each other.
+		std::vector <std::string> stems(wads.size());
 		
-		auto normal_cursor_x = d.cursor_x_pos / d.window_x_size;
-		auto normal_cursor_y = d.cursor_y_pos / d.window_y_size;
-		
-		auto window_mid_x = d.window_x_size / 2;
-		auto window_mid_y = d.window_y_size / 2;
-		
-		auto cursor_map_x =  (d.cursor_x_pos - window_mid_x) / map_scale / d.window_x_size * 2;
-		auto cursor_map_y = -(d.cursor_y_pos - window_mid_y) / map_scale / d.window_y_size * 2;
+		for(int w = 0; w < wads.size(); w++) {
+			stems [w] = std::filesystem::path(wad_paths [w]).stem().string();
+		}
 		
-		if(0 <= d.display_timer) {
-			/* Vec2f p = Vec2f(cursor_map_x, cursor_map_y) + 3 * RadVec2 <float> (0.02 * d.timer);
-			glBindBuffer(GL_ARRAY_BUFFER, 1);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(p), (void*)&p); */
+		std::vector <std::string> image_stems = stems;
 		
-			d.display_timer++;
-		}
-	}
-	
-	void OnDraw () {
-		if(0 <= d.display_timer) {
-			OnDrawMap();
+		for(int w = 0; w < wads.size(); w++) {
+			if(1 < std::count(stems.begin(), stems.end(), stems [w])) {
+				image_stems [w] += "_" + std::to_string(w + 1);
+			}
 		}
-	}
-	
-	void OnDrawMap () {
 		
-		// Draw the background grid.
-		glUseProgram(d.grid_draw_program);
-		glBindBuffer(GL_ARRAY_BUFFER, 201);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		std::atomic <int> failed_count(0);
 		
-		// Draw the map lines and vertices.
-		glUseProgram(d.map_draw_program);
-		glBindBuffer(GL_ARRAY_BUFFER, 1);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 2);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glDrawElements(GL_LINES, d.vertex_count, GL_UNSIGNED_INT, nullptr);
-		glDrawElements(GL_POINTS, d.vertex_count, GL_UNSIGNED_INT, nullptr);
-		glDisableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		// Decoding and drawing buffers are reused by each thread.
+		struct ThreadState {
+			WadFuncs wad_funcs;
+			MapPackage package;
+			MapRaster raster;
+		};
 		
-		// Draw the thing dots.
-		glBindBuffer(GL_ARRAY_BUFFER, 3);
-		// glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 3);
-		// glBindBuffer(GL_ARRAY_BUFFER, 202);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(sizeof(float)) );
-		glDrawArrays(GL_POINTS, 0, d.thing_count);
-		// glDrawElements(GL_LINES, d.thing_count, GL_FLOAT, nullptr);
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		std::vector <ThreadState> states(pool.thread_count);
 		
-		// Draw the zoom bar.
-		glUseProgram(d.bar_draw_program);
-		glBindBuffer(GL_ARRAY_BUFFER, 200);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glDisableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-	}
-	
-	int MainLoop () {
-		d.timer = 0;
-		d.exit_pressed = 0;
+		for(auto& state: states) {
+			state.raster.Resize(image_size, image_size);
+		}
 		
-		while(d.exit_pressed < 1) {
-			glfwPollEvents();
-			
-			if(glfwWindowShouldClose(d.window)) {
-				d.exit_pressed++;
-			}
+		pool.Run(jobs.size(), [&] (int k, int thread) {
+			auto* state = &states [thread];
+			const auto& job = jobs [k];
+			const auto& wad = wads [job.wad_index];
 			
-			if(0 == d.timer) {
-				OnFirstTick();
-			}
+			// Only the arrays to draw, the full map model is for the viewer.
+			state->wad_funcs.BuildMapPackage(wad, job.map_index, state->package);
+			state->raster.DrawMap(state->package);
 			
-			OnTick();
+			auto png_path = std::filesystem::path(output_path) / (image_stems [job.wad_index] + "_" + state->package.map_name + ".png");
 			
-			glClearColor(0.343, 0.03030, 0.143, 1.0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			OnDraw();
-			glfwSwapBuffers(d.window);
-			d.timer++;
-		}
+			if(!state->raster.SavePng(png_path.string())) {
+				failed_count++;
+			}
+		});
 		
-		OnLastTick();
+		std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start_time;
 		
-		return 0;
+		std::cout << "Rendered " << jobs.size() - failed_count << " maps from " << wads.size() << " wads in "
+			<< seconds.count() << " s (" << 60 * jobs.size() / std::max(1e-6, seconds.count()) << " maps per minute)"
+			<< std::endl;
+		
+		return 0 == failed_count ? 0 : 1;
 	}
 	
-	WadAppData& d;
+	std::vector <std::string> wad_paths;
+	std::string output_path;
+	int image_size;
+	int thread_count;
 };
 
 int main (int argc, char * argv []) {
+	
+	// Map thumbnails without a window, for example: wad-viewer.exe --headless -o thumbs a.wad b.wad
+	if(2 <= argc && std::string("--headless") == argv [1]) {
+		HeadlessRenderer renderer;
+		return renderer.Run(argc - 2, argv + 2);
+	}
+	
 	WadAppData app_data;
 	app_data.cmd_arg_count		= argc;
 	app_data.cmd_args			= argv;
 	
 	WadApp app(app_data);
 	return app.MainLoop();
-}
\ No newline at end of file
+}
@@ -0,0 +1,1192 @@
+#ifndef DOOM_WAD_H
+#define DOOM_WAD_H
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "gl_helper.h"
+#include "space.h"
+#include "wad_funcs.h"
+#include "map_cache.h"
+#include "wad_stack.h"
+#include "flat_array.h"
+
+// Opens wads and decodes maps on a worker thread. The render thread posts requests and picks up
+// finished packages, it never waits for the disk or for decoding. Only the newest request counts,
+// older requests that have not started yet are dropped.
+struct MapLoader {
+	MapLoader () {
+		has_request = false;
+		has_package = false;
+		stop_requested = false;
+		request_map_index = 0;
+		request_count = 0;
+		has_flats = false;
+		ready_flat_generation = -1;
+		flat_generation = -1;
+	}
+	
+	~MapLoader () {
+		Stop();
+	}
+	
+	void Start () {
+		if(!worker.joinable()) {
+			stop_requested = false;
+			worker = std::thread( [this] () { WorkerLoop(); } );
+		}
+	}
+	
+	void Stop () {
+		if(worker.joinable()) {
+			{
+				std::lock_guard <std::mutex> lock(mutex);
+				stop_requested = true;
+			}
+			
+			wake.notify_one();
+			worker.join();
+		}
+	}
+	
+	// Open a stack of wads, bottom first, and show one of its maps.
+	void RequestWads (std::vector <std::string> paths, int map_index) {
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			has_request = true;
+			request_paths = std::move(paths);
+			request_map_index = map_index;
+			request_count++;
+		}
+		
+		wake.notify_one();
+	}
+	
+	// Show another map of the wad that is already open.
+	void RequestMap (int map_index) {
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			has_request = true;
+			request_map_index = map_index;
+			request_count++;
+		}
+		
+		wake.notify_one();
+	}
+	
+	// Take the finished package if there is one. Never blocks on loading.
+	bool TakePackage (MapPackage& package) {
+		std::lock_guard <std::mutex> lock(mutex);
+		
+		if(!has_package) {
+			return false;
+		}
+		
+		package = std::move(ready_package);
+		has_package = false;
+		return true;
+	}
+	
+	// Take the flats of a newly opened stack, expanded and with their mip levels. Take these
+	// before the package, maps built for them come with the same generation.
+	bool TakeFlats (FlatArray::Pixels& pixels, int& generation) {
+		std::lock_guard <std::mutex> lock(mutex);
+		
+		if(!has_flats) {
+			return false;
+		}
+		
+		pixels = std::move(ready_flats);
+		generation = ready_flat_generation;
+		has_flats = false;
+		return true;
+	}
+	
+	void WorkerLoop () {
+		std::vector <std::string> loaded_paths;
+		
+		while(true) {
+			std::vector <std::string> paths;
+			int map_index = 0;
+			int request_id = 0;
+			
+			{
+				std::unique_lock <std::mutex> lock(mutex);
+				wake.wait(lock, [this] () { return stop_requested || has_request; } );
+				
+				if(stop_requested) {
+					return;
+				}
+				
+				paths = request_paths;
+				map_index = request_map_index;
+				request_id = request_count;
+				has_request = false;
+			}
+			
+			// Mapping the wads and building their index happens here too, so dropping large
+			// files on the window costs the render thread nothing. Wads added on top of the open
+			// stack are pushed without opening the ones below again.
+			MapPackage package;
+			bool is_stack_extended =
+				loaded_paths.size() <= paths.size() &&
+				std::equal(loaded_paths.begin(), loaded_paths.end(), paths.begin());
+			
+			bool is_stack_changed = !is_stack_extended;
+			
+			if(!is_stack_extended) {
+				wads.Clear();
+				loaded_paths.clear();
+			}
+			
+			for(auto k = loaded_paths.size(); k < paths.size(); k++) {
+				if(!wads.Push(paths [k])) {
+					package.wad_path = paths [k];
+					break;
+				}
+				
+				loaded_paths.push_back(paths [k]);
+				is_stack_changed = true;
+			}
+			
+			// Every flat of the stack is expanded once per stack. The pixels go to the render
+			// thread even when the map request is dropped, the index stays here for the maps.
+			if(is_stack_changed) {
+				BuildFlats();
+				std::lock_guard <std::mutex> lock(mutex);
+				ready_flats = std::move(flats.pixels);
+				ready_flat_generation = flat_generation;
+				has_flats = true;
+			}
+			
+			// A wad that failed to open is tried again on the next request.
+			if(package.wad_path.empty()) {
+				BuildPackage(package, map_index);
+			}
+			
+			{
+				std::lock_guard <std::mutex> lock(mutex);
+				
+				// A newer request came in while working, its package replaces this one.
+				if(request_id == request_count) {
+					ready_package = std::move(package);
+					has_package = true;
+				}
+			}
+		}
+	}
+	
+	void BuildFlats () {
+		Profiler::Scope scope("MapLoader::BuildFlats");
+		palette = DoomPalette();
+		palette.Read(wads);
+		flats.Build(wads, palette);
+		flat_generation++;
+	}
+	
+	void BuildPackage (MapPackage& package, int map_index) {
+		Profiler::Scope scope("MapLoader::BuildPackage");
+		package.map_index = map_index;
+		package.is_wad_loaded = 0 < wads.WadCount();
+		
+		if(!package.is_wad_loaded) {
+			return;
+		}
+		
+		// The topmost wad with the map marker has all of the map lumps.
+		std::string map_name;
+		wad_funcs.Doom2MapLumpName(map_name, map_index);
+		auto map_ref = wads.FindMap(DoomWad::LumpKey(map_name));
+		
+		if(map_ref.wad_index < 0) {
+			package.is_map_loaded = false;
+			return;
+		}
+		
+		const auto& wad = wads.Wad(map_ref.wad_index);
+		int wad_map_index = map_ref.index;
+		package.wad_path = wad.path;
+		
+		// Maps seen before come straight from the cache, model and all, without decoding.
+		auto key = MapCache::MapKey(wad, wad_map_index);
+		
+		if(cache.Load(key, package)) {
+			package.map_name = wad.LumpName(wad.maps [wad_map_index].marker_lump);
+			package.is_map_loaded = true;
+		}
+		
+		else if(wad_funcs.BuildMapPackage(wad, wad_map_index, package)) {
+			bool is_map_decoded = udmf_map_format == wad.maps [wad_map_index].format;
+			wad_funcs.DecodeMapModel(wad, wad_map_index, package, is_map_decoded);
+			cache.Store(key, package);
+		}
+		
+		flats.SectorFloorLayers(package.map, package.sector_floor_layer);
+		package.flat_generation = flat_generation;
+	}
+	
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	
+	// Shared with the render thread, guarded by the mutex.
+	bool has_request;
+	bool has_package;
+	bool stop_requested;
+	std::vector <std::string> request_paths;
+	int request_map_index;
+	int request_count;
+	MapPackage ready_package;
+	bool has_flats;
+	FlatArray::Pixels ready_flats;
+	int ready_flat_generation;
+	
+	// Only touched by the worker thread.
+	WadStack wads;
+	WadFuncs wad_funcs;
+	MapCache cache;
+	DoomPalette palette;
+	FlatArray flats;
+	int flat_generation;
+};
+
+struct WadAppData {
+	
+	// Agnostic data.
+	int window_x_size;
+	int window_y_size;
+	int exit_pressed;
+	int timer;
+	
+	double cursor_x_pos;
+	double cursor_y_pos;
+	double cursor_dx;
+	double cursor_dy;
+	float map_x_pos;
+	float map_y_pos;
+	float zoom_f;
+	float zoom_target_f;
+	float map_rotation_rad_target;
+	float map_rotation_rad;
+	
+	// Picking. The cursor in map coordinates, the item under it and where a click started.
+	float cursor_map_x;
+	float cursor_map_y;
+	int hover_linedef;
+	int hover_vertex;
+	int hover_thing;
+	bool is_click_pending;
+	double click_x_pos;
+	double click_y_pos;
+	
+	// Wad data. The loader owns the open wads, the package holds the map on display.
+	MapLoader map_loader;
+	MapPackage map_package;
+	int vertex_count;
+	int linedef_count;
+	int thing_count;
+	int display_timer;
+	int wad_map_index;
+	
+	// The runs of map tiles on screen this frame.
+	MapTiles::DrawRanges visible_ranges;
+	
+	std::vector <std::string> open_wad_paths;
+	
+	// Open-gl rendering.
+	GlFuncs gl_funcs;
+	GlModelFuncs gl_model_funcs;
+	WadFuncs wad_funcs;
+	
+	// Map meshes come in two sets. A new map is uploaded into the set that is not on display
+	// and swapped in once complete, the other set keeps drawing until then. The line mesh holds
+	// vertices and tiled line indices. The thing mesh holds the arrow model and the per thing
+	// arrays of the map, one buffer each, read once per instance. The sector mesh holds the
+	// sector triangles with the light and floor height of their sector at every vertex, and the
+	// flat array layer of its floor.
+	GlMesh map_line_meshes [2];
+	GlMesh map_thing_meshes [2];
+	GlMesh map_sector_meshes [2];
+	int front_map_meshes;
+	int sector_index_count;
+	std::vector <float> sector_vertex_values;
+	std::vector <int> sector_vertex_layers;
+	
+	// Every flat of the open stack as one texture array, and the loader generation it came from.
+	// Layers past what open-gl takes are left out and their sectors drawn as if they had no flat.
+	GLuint flat_texture;
+	int flat_generation;
+	int flat_layer_count;
+	
+	// Sector fill, 0 for none, 1 by light level, 2 by floor height and 3 with the floor flats.
+	// Floor heights are colored over the range of the map.
+	int sector_fill_mode;
+	float min_floor_height;
+	float max_floor_height;
+	
+	// Screen space meshes, the same for every map.
+	GlMesh grid_mesh;
+	GlMesh bar_mesh;
+	
+	// CPU time spent issuing draw calls, averaged over a number of frames for the window title.
+	double draw_seconds;
+	int draw_frame_count;
+	
+	// Performance overlay. GPU time of every draw pass, and the graph lines rebuilt each frame.
+	GlPassTimers pass_timers;
+	GlMesh hud_mesh;
+	std::vector <float> hud_vertices;
+	std::vector <float> hud_times;
+	bool is_hud_visible;
+	
+	// Thing filter. Skill 0 shows the things of every skill.
+	int thing_skill;
+	bool is_multiplayer;
+	
+	int map_draw_program;
+	int thing_draw_program;
+	int sector_draw_program;
+	int bar_draw_program;
+	int grid_draw_program;
+	int hud_draw_program;
+	
+	// command line args
+	int cmd_arg_count;
+	char** cmd_args;
+	
+	// GLFW data.
+	GLFWwindow* window;
+};
+
+struct WadApp {
+	WadApp (WadAppData& app_data) : d(app_data) {}
+	
+	// Draw passes timed on the GPU, in the order of pass_names.
+	enum DrawPass {
+		grid_pass,
+		sector_pass,
+		line_pass,
+		thing_pass,
+		bar_pass,
+		hud_pass
+	};
+	
+	// Open DOOM wad files for display, as a stack with later wads over earlier ones. Loading
+	// happens in the background, the current map stays on display until the new one is ready.
+	void OpenWads (std::vector <std::string> paths, int map_index = 0) {
+		d.wad_map_index = map_index;
+		d.open_wad_paths = std::move(paths);
+		d.map_loader.RequestWads(d.open_wad_paths, d.wad_map_index);
+	}
+	
+	void OnFirstTick () {
+		
+		// User settings.
+		d.window_x_size = 1280;
+		d.window_y_size = 720;
+		d.zoom_f = 1.0;
+		d.zoom_target_f = d.zoom_f;
+		d.map_rotation_rad_target = 0;
+		d.map_rotation_rad = 0;
+		d.display_timer = -1;
+		d.front_map_meshes = 0;
+		d.hover_linedef = -1;
+		d.hover_vertex = -1;
+		d.hover_thing = -1;
+		d.is_click_pending = false;
+		
+		d.draw_seconds = 0;
+		d.draw_frame_count = 0;
+		d.thing_skill = 0;
+		d.is_multiplayer = true;
+		d.is_hud_visible = false;
+		d.sector_fill_mode = 3;
+		d.sector_index_count = 0;
+		d.flat_texture = 0;
+		d.flat_generation = -1;
+		d.flat_layer_count = 0;
+		d.min_floor_height = 0;
+		d.max_floor_height = 0;
+		
+		// Initialise GLFW for rendering and viewing.
+		glfwInit();
+		glfwDefaultWindowHints();
+		d.window = glfwCreateWindow(d.window_x_size, d.window_y_size, "Map Viewer", nullptr, nullptr);
+		glfwMakeContextCurrent(d.window);
+		
+		glfwSetWindowUserPointer(d.window, this);
+		
+		glfwSetScrollCallback(d.window, [] (GLFWwindow* window, double scroll_x, double scroll_y) {
+			auto* app = reinterpret_cast <WadApp*> (glfwGetWindowUserPointer(window));
+			app->d.zoom_target_f = std::clamp(app->d.zoom_target_f + scroll_y / 15, 0.25, 4.0);
+			
+		});
+		
+		glfwSetDropCallback(d.window, [] (GLFWwindow* window, int path_count, const char* paths []) {
+			auto* app = reinterpret_cast <WadApp*> (glfwGetWindowUserPointer(window));
+			app->OpenWads(std::vector <std::string> (paths, paths + path_count));
+		});
+		
+		// Number keys pick the skill to show things for, 0 shows all. M toggles multiplayer things.
+		// F switches the sector fill between none, light level, floor height and floor flats. F1
+		// toggles the performance overlay, F2 writes the recent samples out as a trace.
+		glfwSetKeyCallback(d.window, [] (GLFWwindow* window, int key, int scan_code, int action, int mods) {
+			auto* app = reinterpret_cast <WadApp*> (glfwGetWindowUserPointer(window));
+			
+			if(GLFW_PRESS != action) {
+				return;
+			}
+			
+			if(GLFW_KEY_F1 == key) {
+				app->d.is_hud_visible = !app->d.is_hud_visible;
+				return;
+			}
+			
+			if(GLFW_KEY_F2 == key) {
+				std::string trace_path = "profile_trace.json";
+				bool is_written = GlobalProfiler().WriteChromeTrace(trace_path);
+				std::cout << (is_written ? "Wrote " : "Could not write ") << trace_path << std::endl;
+				return;
+			}
+			
+			if(GLFW_KEY_F == key) {
+				static const char* fill_names [] = { "none", "light level", "floor height", "floor flats" };
+				app->d.sector_fill_mode = (app->d.sector_fill_mode + 1) % 4;
+				std::cout << "Sector fill: " << fill_names [app->d.sector_fill_mode] << std::endl;
+				return;
+			}
+			
+			if(GLFW_KEY_0 <= key && key <= GLFW_KEY_5) {
+				app->d.thing_skill = key - GLFW_KEY_0;
+			}
+			
+			else if(GLFW_KEY_M == key) {
+				app->d.is_multiplayer = !app->d.is_multiplayer;
+			}
+			
+			else {
+				return;
+			}
+			
+			std::cout << "Things for " << (0 == app->d.thing_skill ? std::string("all skills") : "skill " + std::to_string(app->d.thing_skill))
+				<< (app->d.is_multiplayer ? ", multiplayer" : ", single player") << std::endl;
+		});
+		
+		// Ensure the viewport resizes with the window.
+		glfwSetFramebufferSizeCallback(d.window, [] (GLFWwindow* window, int x_size, int y_size) {
+			glViewport(0, 0, x_size, y_size);
+		});
+		
+		glfwGetCursorPos(d.window, &d.cursor_x_pos, &d.cursor_y_pos);
+		d.cursor_dx = 0;
+		d.cursor_dy = 0;
+		
+		glfwGetWindowSize(d.window, &d.window_x_size, &d.window_y_size);
+		
+		// Rendering setup for open-gl.
+		gladLoadGL();
+		glDisable(GL_LINE_SMOOTH);
+		glPointSize(3);
+		glLineWidth(1);
+		
+		d.map_draw_program = d.gl_funcs.LoadProgram( {
+			{ "shader_map_vertex.txt", GL_VERTEX_SHADER },
+			{ "shader_map_fragment.txt", GL_FRAGMENT_SHADER }
+		});
+		
+		d.sector_draw_program = d.gl_funcs.LoadProgram( {
+			{ "shader_sector_vertex.txt", GL_VERTEX_SHADER },
+			{ "shader_sector_fragment.txt", GL_FRAGMENT_SHADER }
+		});
+		
+		d.thing_draw_program = d.gl_funcs.LoadProgram( {
+			{ "shader_thing_vertex.txt", GL_VERTEX_SHADER },
+			{ "shader_thing_fragment.txt", GL_FRAGMENT_SHADER }
+		});
+		
+		d.bar_draw_program = d.gl_funcs.LoadProgram( {
+			{ "shader_zoom_bar_vertex.txt", GL_VERTEX_SHADER },
+			{ "shader_zoom_bar_fragment.txt", GL_FRAGMENT_SHADER }
+		});
+		
+		d.grid_draw_program = d.gl_funcs.LoadProgram( {
+			{ "shader_map_grid_vertex.txt", GL_VERTEX_SHADER },
+			{ "shader_map_grid_fragment.txt", GL_FRAGMENT_SHADER }
+		});
+		
+		d.hud_draw_program = d.gl_funcs.LoadProgram( {
+			{ "shader_hud_vertex.txt", GL_VERTEX_SHADER },
+			{ "shader_hud_fragment.txt", GL_FRAGMENT_SHADER }
+		});
+		
+		d.pass_timers.Create( { "gpu grid", "gpu sectors", "gpu lines", "gpu things", "gpu zoom bar", "gpu hud" });
+		
+		// Vertex arrays and buffers live as long as the window. Only the buffer contents change
+		// from map to map, the attribute layout is recorded here once.
+		auto& gl = d.gl_funcs;
+		
+		std::vector <float> arrow;
+		d.gl_model_funcs.Make2dArrow(arrow);
+		d.gl_model_funcs.Rescale2dModel(arrow, 1, 0.5, 0);
+		
+		for(int k = 0; k < 2; k++) {
+			d.map_line_meshes [k].Create(gl, 2);
+			d.map_line_meshes [k].Attribute(gl, 0, 0, 2);
+			d.map_line_meshes [k].Elements(gl, 1);
+			
+			d.map_sector_meshes [k].Create(gl, 4);
+			d.map_sector_meshes [k].Attribute(gl, 0, 0, 2);
+			d.map_sector_meshes [k].Attribute(gl, 1, 1, 2);
+			d.map_sector_meshes [k].Elements(gl, 2);
+			d.map_sector_meshes [k].IntegerAttribute(gl, 3, 2, 1, GL_INT);
+			
+			auto& thing_mesh = d.map_thing_meshes [k];
+			thing_mesh.Create(gl, 6);
+			thing_mesh.Upload(0, sizeof(float) * arrow.size(), arrow.data());
+			thing_mesh.Attribute(gl, 0, 0, 2);
+			thing_mesh.Attribute(gl, 1, 1, 1, 0, 0, 1);
+			thing_mesh.Attribute(gl, 2, 2, 1, 0, 0, 1);
+			thing_mesh.Attribute(gl, 3, 3, 1, 0, 0, 1);
+			thing_mesh.IntegerAttribute(gl, 4, 4, 1, GL_UNSIGNED_SHORT, 0, 0, 1);
+			thing_mesh.IntegerAttribute(gl, 5, 5, 1, GL_UNSIGNED_SHORT, 0, 0, 1);
+		}
+		
+		std::vector <float> quad;
+		d.gl_model_funcs.Make2dQuadTris(quad);
+		d.bar_mesh.Create(gl, 1);
+		d.bar_mesh.Upload(0, sizeof(float) * quad.size(), quad.data());
+		d.bar_mesh.Attribute(gl, 0, 0, 2);
+		
+		// Full screen quad for the background grid, its positions double as uv.
+		std::vector <float> screen_quad;
+		d.gl_model_funcs.Make2dQuadTris(screen_quad);
+		d.gl_model_funcs.Rescale2dModel(screen_quad, 2, 0.5, 0.5);
+		d.grid_mesh.Create(gl, 1);
+		d.grid_mesh.Upload(0, sizeof(float) * screen_quad.size(), screen_quad.data());
+		d.grid_mesh.Attribute(gl, 0, 0, 2);
+		d.grid_mesh.Attribute(gl, 0, 1, 2);
+		
+		// The overlay lines change every frame, only the layout is set here.
+		d.hud_mesh.Create(gl, 1);
+		d.hud_mesh.Attribute(gl, 0, 0, 2);
+		gl.BindVertexArray(0);
+		
+		d.map_loader.Start();
+		
+		// Wads on the command line open as one stack, a number after them picks the map.
+		std::vector <std::string> paths;
+		int map_index = 0;
+		
+		for(int k = 1; k < d.cmd_arg_count; k++) {
+			std::string arg = d.cmd_args [k];
+			
+			if(!arg.empty() && std::all_of(arg.begin(), arg.end(), ::isdigit)) {
+				map_index = std::atoi(arg.c_str());
+			}
+			
+			else {
+				paths.push_back(arg);
+			}
+		}
+		
+		if(!paths.empty()) {
+			OpenWads(paths, map_index);
+		}
+	}
+	
+	// The flats of a new stack arrived from the loader. They replace the texture array, maps of
+	// the stack before draw untextured until their own package comes.
+	void OnFlatsLoaded (const FlatArray::Pixels& pixels, int generation) {
+		Profiler::Scope scope("OnFlatsLoaded");
+		
+		if(d.flat_texture) {
+			glDeleteTextures(1, &d.flat_texture);
+		}
+		
+		GLint max_layer_count = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layer_count);
+		d.flat_layer_count = std::min(pixels.layer_count, max_layer_count);
+		d.flat_texture = 0;
+		d.flat_generation = generation;
+		
+		if(0 < d.flat_layer_count) {
+			d.flat_texture = d.gl_funcs.LoadTextureArray(pixels.levels, flat_level_count, flat_width, flat_width, d.flat_layer_count);
+		}
+		
+		if(d.flat_layer_count < pixels.layer_count) {
+			std::cout << "Only " << d.flat_layer_count << " of " << pixels.layer_count << " flats fit in a texture array" << std::endl;
+		}
+	}
+	
+	// A map package arrived from the loader. Upload it into the back buffers and swap them in.
+	void OnFirstMapTick (MapPackage& package) {
+		Profiler::Scope scope("OnFirstMapTick");
+		
+		// A failed load leaves the map on display alone.
+		if(!package.is_map_loaded) {
+			if(!package.is_wad_loaded) {
+				std::cout << "Could not open wad: " << package.wad_path << std::endl;
+			}
+			
+			return;
+		}
+		
+		d.map_package = std::move(package);
+		d.display_timer = 0;
+		d.zoom_f = 1.0;
+		d.zoom_target_f = d.zoom_f;
+		d.hover_linedef = -1;
+		d.hover_vertex = -1;
+		d.hover_thing = -1;
+		
+		const auto& map = d.map_package;
+		int back_map_meshes = 1 - d.front_map_meshes;
+		auto& line_mesh = d.map_line_meshes [back_map_meshes];
+		auto& thing_mesh = d.map_thing_meshes [back_map_meshes];
+		auto& sector_mesh = d.map_sector_meshes [back_map_meshes];
+		
+		line_mesh.Upload(0, map.vertex_view.size_bytes(), map.vertex_view.data());
+		line_mesh.Upload(1, sizeof(int) * map.tiles.indices.size(), map.tiles.indices.data());
+		
+		// Sector values go to every vertex of the sector, vertices are not shared between sectors.
+		const auto& sectors = map.sector_mesh;
+		const auto& floor_heights = map.map.sector_floor_height;
+		const auto& lights = map.map.sector_light;
+		const auto& layers = map.sector_floor_layer;
+		d.sector_vertex_values.resize(2 * sectors.VertexCount());
+		d.sector_vertex_layers.resize(sectors.VertexCount());
+		
+		for(int v = 0; v < sectors.VertexCount(); v++) {
+			auto s = sectors.vertex_sectors [v];
+			d.sector_vertex_values [2 * v] = s < lights.size() ? lights [s] : 0;
+			d.sector_vertex_values [2 * v + 1] = s < floor_heights.size() ? floor_heights [s] : 0;
+			d.sector_vertex_layers [v] = s < layers.size() ? layers [s] : -1;
+		}
+		
+		auto floor_range = std::minmax_element(floor_heights.begin(), floor_heights.end());
+		d.min_floor_height = floor_heights.empty() ? 0 : *floor_range.first;
+		d.max_floor_height = floor_heights.empty() ? 0 : *floor_range.second;
+		
+		sector_mesh.Upload(0, sizeof(float) * sectors.vertices.size(), sectors.vertices.data());
+		sector_mesh.Upload(1, sizeof(float) * d.sector_vertex_values.size(), d.sector_vertex_values.data());
+		sector_mesh.Upload(2, sizeof(int) * sectors.indices.size(), sectors.indices.data());
+		sector_mesh.Upload(3, sizeof(int) * d.sector_vertex_layers.size(), d.sector_vertex_layers.data());
+		
+		// Thing instances come straight from the decoded map arrays.
+		const auto& things = map.map;
+		thing_mesh.Upload(1, sizeof(float) * things.thing_x.size(), things.thing_x.data());
+		thing_mesh.Upload(2, sizeof(float) * things.thing_y.size(), things.thing_y.data());
+		thing_mesh.Upload(3, sizeof(float) * things.thing_angle.size(), things.thing_angle.data());
+		thing_mesh.Upload(4, sizeof(std::uint16_t) * things.thing_type.size(), things.thing_type.data());
+		thing_mesh.Upload(5, sizeof(std::uint16_t) * things.thing_flags.size(), things.thing_flags.data());
+		
+		d.front_map_meshes = back_map_meshes;
+		d.vertex_count = map.index_view.size();
+		d.thing_count = things.ThingCount();
+		d.sector_index_count = sectors.indices.size();
+	}
+	
+	void OnLastTick () {
+		d.map_loader.Stop();
+		
+		for(int k = 0; k < 2; k++) {
+			d.map_line_meshes [k].Destroy(d.gl_funcs);
+			d.map_thing_meshes [k].Destroy(d.gl_funcs);
+			d.map_sector_meshes [k].Destroy(d.gl_funcs);
+		}
+		
+		if(d.flat_texture) {
+			glDeleteTextures(1, &d.flat_texture);
+		}
+		
+		d.grid_mesh.Destroy(d.gl_funcs);
+		d.bar_mesh.Destroy(d.gl_funcs);
+		d.hud_mesh.Destroy(d.gl_funcs);
+		d.pass_timers.Destroy();
+		glfwTerminate();
+	}
+	
+	void OnTick () {
+		Profiler::Scope scope("OnTick");
+		MapPackage package;
+		FlatArray::Pixels flat_pixels;
+		int flat_generation = 0;
+		
+		if(d.map_loader.TakeFlats(flat_pixels, flat_generation)) {
+			OnFlatsLoaded(flat_pixels, flat_generation);
+		}
+		
+		if(d.map_loader.TakePackage(package)) {
+			OnFirstMapTick(package);
+		}
+		
+		auto old_cursor_x_pos = d.cursor_x_pos;
+		auto old_cursor_y_pos = d.cursor_y_pos;
+		
+		glfwGetCursorPos(d.window, &d.cursor_x_pos, &d.cursor_y_pos);
+		
+		d.cursor_dx = d.cursor_x_pos - old_cursor_x_pos;
+		d.cursor_dy = d.cursor_y_pos - old_cursor_y_pos;
+		
+		float zoom_lerp_f = 0.25;
+		d.zoom_f = zoom_lerp_f * d.zoom_target_f + (1 - zoom_lerp_f) * d.zoom_f;
+		
+		float rot_lerp_f = 0.25;
+		d.map_rotation_rad = rot_lerp_f * d.map_rotation_rad_target + (1 - rot_lerp_f) * d.map_rotation_rad;
+		
+		auto map_scale = 1.0 / 2000 * d.zoom_f;
+		
+		// Handle mouse button inputs. Here is panning.
+		if(glfwGetMouseButton(d.window, 0)) {
+			d.map_x_pos -= d.cursor_dx * d.zoom_f;
+			d.map_y_pos += d.cursor_dy * d.zoom_f;
+		}
+		
+		// Mouse input for rotation.
+		if(glfwGetMouseButton(d.window, 1)) {
+			d.map_rotation_rad_target += d.cursor_dx * 0.005;
+		}
+		
+		// Shader inputs to scale the map lines and grid.
+		auto zoom_unit_f = (d.zoom_f - 0.25) / (4.0 - 0.25);
+		auto aspect_ratio_f = 1.0 * d.window_x_size / d.window_y_size;
+		
+		d.gl_funcs.UseProgram(d.map_draw_program);
+		glUniform2f(0, (float)d.map_x_pos, (float)d.map_y_pos);
+		// glUniform2f(0, 0, 0);
+		glUniform1f(1, map_scale);
+		glUniform1f(2, 0);
+		glUniform1f(3, aspect_ratio_f);
+		glUniform1f(4, d.map_rotation_rad);
+		glUniform4f(5, 1, 1, 1, 1);
+		
+		// Skill 1 and 2 share a flag, as do 4 and 5.
+		static constexpr unsigned skill_bits [] = { 0, 1, 1, 2, 4, 4 };
+		
+		// Thing arrows keep a few pixels of size when zoomed far out.
+		float pixel_map_size = 2.0 / d.window_y_size / map_scale;
+		
+		d.gl_funcs.UseProgram(d.sector_draw_program);
+		glUniform2f(0, (float)d.map_x_pos, (float)d.map_y_pos);
+		glUniform1f(1, map_scale);
+		glUniform1f(3, aspect_ratio_f);
+		glUniform1f(4, d.map_rotation_rad);
+		glUniform1i(5, d.sector_fill_mode);
+		glUniform2f(6, d.min_floor_height, std::max(d.max_floor_height, d.min_floor_height + 1));
+		glUniform1i(7, d.map_package.flat_generation == d.flat_generation ? d.flat_layer_count : 0);
+		
+		d.gl_funcs.UseProgram(d.thing_draw_program);
+		glUniform2f(0, (float)d.map_x_pos, (float)d.map_y_pos);
+		glUniform1f(1, map_scale);
+		glUniform1f(2, std::max(32.0f, 8 * pixel_map_size));
+		glUniform1f(3, aspect_ratio_f);
+		glUniform1f(4, d.map_rotation_rad);
+		glUniform4f(5, 1, 1, 1, 1);
+		glUniform1ui(6, skill_bits [d.thing_skill]);
+		glUniform1i(7, d.is_multiplayer);
+		glUniform1i(8, hexen_map_format != d.map_package.map.format);
+		
+		d.gl_funcs.UseProgram(d.bar_draw_program);
+		glUniform1f(0, zoom_unit_f);
+		glUniform4f(1, 1, 0, 0, 1);
+		
+		d.gl_funcs.UseProgram(d.grid_draw_program);
+		glUniform1f(2, map_scale);
+		glUniform1f(3, aspect_ratio_f);
+		glUniform2f(4, (float)d.map_x_pos, (float)d.map_y_pos);
+		glUniform1f(5, d.map_rotation_rad);
+		
+		auto normal_cursor_x = d.cursor_x_pos / d.window_x_size;
+		auto normal_cursor_y = d.cursor_y_pos / d.window_y_size;
+		
+		auto window_mid_x = d.window_x_size / 2;
+		auto window_mid_y = d.window_y_size / 2;
+		
+		auto cursor_map_x =  (d.cursor_x_pos - window_mid_x) / map_scale / d.window_x_size * 2;
+		auto cursor_map_y = -(d.cursor_y_pos - window_mid_y) / map_scale / d.window_y_size * 2;
+		
+		ScreenToMap(2 * normal_cursor_x - 1, 1 - 2 * normal_cursor_y, map_scale, aspect_ratio_f, d.cursor_map_x, d.cursor_map_y);
+		
+		// The box around the screen corners in map coordinates selects the tiles to draw.
+		float view_min_x = std::numeric_limits <float>::max();
+		float view_min_y = view_min_x;
+		float view_max_x = std::numeric_limits <float>::lowest();
+		float view_max_y = view_max_x;
+		
+		for(int corner = 0; corner < 4; corner++) {
+			float corner_x, corner_y;
+			ScreenToMap(corner % 2 ? 1 : -1, corner / 2 ? 1 : -1, map_scale, aspect_ratio_f, corner_x, corner_y);
+			view_min_x = std::min(view_min_x, corner_x);
+			view_min_y = std::min(view_min_y, corner_y);
+			view_max_x = std::max(view_max_x, corner_x);
+			view_max_y = std::max(view_max_y, corner_y);
+		}
+		
+		d.map_package.tiles.VisibleRanges(view_min_x, view_min_y, view_max_x, view_max_y, d.visible_ranges);
+		
+		// Pick within a few pixels of the cursor.
+		float pick_radius = 6 * pixel_map_size;
+		
+		if(0 <= d.display_timer) {
+			OnPick(pick_radius);
+		}
+		
+		// A click is a press and release without dragging the map in between.
+		bool is_left_down = glfwGetMouseButton(d.window, 0);
+		
+		if(is_left_down && !d.is_click_pending) {
+			d.is_click_pending = true;
+			d.click_x_pos = d.cursor_x_pos;
+			d.click_y_pos = d.cursor_y_pos;
+		}
+		
+		else if(!is_left_down && d.is_click_pending) {
+			d.is_click_pending = false;
+			
+			if(std::abs(d.cursor_x_pos - d.click_x_pos) + std::abs(d.cursor_y_pos - d.click_y_pos) < 4) {
+				OnInspect();
+			}
+		}
+		
+		if(0 <= d.display_timer) {
+			/* Vec2f p = Vec2f(cursor_map_x, cursor_map_y) + 3 * RadVec2 <float> (0.02 * d.timer);
+			glBindBuffer(GL_ARRAY_BUFFER, 1);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(p), (void*)&p); */
+		
+			d.display_timer++;
+		}
+	}
+	
+	// Undo the map vertex shader to find the map position at a point in normalised device
+	// coordinates. The shader rotation is its own inverse.
+	void ScreenToMap (float ndc_x, float ndc_y, float map_scale, float aspect_ratio_f, float& map_x, float& map_y) {
+		float forw_x = std::cos(d.map_rotation_rad);
+		float forw_y = std::sin(d.map_rotation_rad);
+		float view_x = ndc_x * aspect_ratio_f + d.map_x_pos * map_scale;
+		float view_y = ndc_y + d.map_y_pos * map_scale;
+		map_x = (forw_x * view_x + forw_y * view_y) / map_scale;
+		map_y = (forw_y * view_x - forw_x * view_y) / map_scale;
+	}
+	
+	// Find the item under the cursor. Vertices and things are small targets and win over lines.
+	void OnPick (float pick_radius) {
+		const auto& map = d.map_package.map;
+		const auto& grid = d.map_package.grid;
+		float vertex_distance = 0;
+		float thing_distance = 0;
+		
+		d.hover_vertex = grid.NearestVertex(map, d.cursor_map_x, d.cursor_map_y, pick_radius, &vertex_distance);
+		d.hover_thing = grid.NearestThing(map, d.cursor_map_x, d.cursor_map_y, pick_radius, &thing_distance);
+		d.hover_linedef = -1;
+		
+		if(0 <= d.hover_vertex && 0 <= d.hover_thing) {
+			if(vertex_distance <= thing_distance) {
+				d.hover_thing = -1;
+			}
+			
+			else {
+				d.hover_vertex = -1;
+			}
+		}
+		
+		if(d.hover_vertex < 0 && d.hover_thing < 0) {
+			d.hover_linedef = grid.NearestLinedef(map, d.cursor_map_x, d.cursor_map_y, pick_radius);
+		}
+	}
+	
+	// Print the details of the item under the cursor, or of the subsector when there is none.
+	void OnInspect () {
+		const auto& map = d.map_package.map;
+		
+		auto print_index = [] (std::uint32_t index) {
+			if(DoomMap::no_index == index) {
+				std::cout << "none";
+			}
+			
+			else {
+				std::cout << index;
+			}
+		};
+		
+		auto print_side = [&] (const char* label, std::uint32_t side) {
+			std::cout << ", " << label << " side ";
+			print_index(side);
+			
+			if(side < map.sidedef_sector.size()) {
+				std::cout << " (sector ";
+				print_index(map.sidedef_sector [side]);
+				std::cout << ")";
+			}
+		};
+		
+		if(0 <= d.hover_vertex) {
+			int v = d.hover_vertex;
+			std::cout << "Vertex " << v << ": " << map.vertex_x [v] << ", " << map.vertex_y [v] << std::endl;
+		}
+		
+		else if(0 <= d.hover_thing) {
+			int t = d.hover_thing;
+			std::cout << "Thing " << t << ": type " << map.thing_type [t]
+				<< " at " << map.thing_x [t] << ", " << map.thing_y [t]
+				<< ", angle " << std::lround(map.thing_angle [t] * SpaceConst::RadToDegFactor())
+				<< ", flags " << map.thing_flags [t] << std::endl;
+		}
+		
+		else if(0 <= d.hover_linedef) {
+			int l = d.hover_linedef;
+			std::cout << "Linedef " << l << ": vertices " << map.linedef_v1 [l] << " to " << map.linedef_v2 [l]
+				<< ", flags " << map.linedef_flags [l]
+				<< ", special " << map.linedef_special [l]
+				<< ", tag " << map.linedef_tag [l];
+			print_side("front", map.linedef_front [l]);
+			print_side("back", map.linedef_back [l]);
+			std::cout << std::endl;
+		}
+		
+		else {
+			const auto& bsp = d.map_package.bsp;
+			int s = bsp.SubsectorAt(d.cursor_map_x, d.cursor_map_y);
+			
+			if(0 <= s) {
+				std::cout << "Subsector " << s << ": " << bsp.subsector_seg_count [s] << " segs from " << bsp.subsector_first_seg [s] << ", sector ";
+				print_index(bsp.SubsectorSector(map, s));
+				std::cout << std::endl;
+			}
+		}
+	}
+	
+	void OnDraw () {
+		Profiler::Scope scope("OnDraw");
+		
+		if(0 <= d.display_timer) {
+			OnDrawMap();
+		}
+		
+		if(d.is_hud_visible) {
+			OnDrawHud();
+		}
+	}
+	
+	void OnDrawMap () {
+		auto& gl = d.gl_funcs;
+		
+		// Draw the background grid.
+		d.pass_timers.Begin(grid_pass);
+		gl.UseProgram(d.grid_draw_program);
+		gl.BindVertexArray(d.grid_mesh.vertex_array);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		d.pass_timers.End();
+		
+		// Fill the sectors, all in one call. Every floor flat is a layer of the one texture array.
+		if(0 != d.sector_fill_mode) {
+			d.pass_timers.Begin(sector_pass);
+			gl.UseProgram(d.sector_draw_program);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, d.flat_texture);
+			gl.BindVertexArray(d.map_sector_meshes [d.front_map_meshes].vertex_array);
+			glDrawElements(GL_TRIANGLES, d.sector_index_count, GL_UNSIGNED_INT, nullptr);
+			d.pass_timers.End();
+		}
+		
+		// Draw the map lines and vertices, only the tiles on screen in as few ranges as the tile
+		// order allows.
+		const auto& ranges = d.visible_ranges;
+		d.pass_timers.Begin(line_pass);
+		gl.UseProgram(d.map_draw_program);
+		gl.BindVertexArray(d.map_line_meshes [d.front_map_meshes].vertex_array);
+		glMultiDrawElements(GL_LINES, ranges.counts.data(), GL_UNSIGNED_INT, ranges.offsets.data(), ranges.counts.size());
+		glMultiDrawElements(GL_POINTS, ranges.counts.data(), GL_UNSIGNED_INT, ranges.offsets.data(), ranges.counts.size());
+		
+		// Draw the hovered line or vertex again on top, tinted.
+		glUniform4f(5, 1, 0.8, 0, 2);
+		
+		if(0 <= d.hover_linedef) {
+			int slot = d.map_package.tiles.linedef_slot [d.hover_linedef];
+			glDrawElements(GL_LINES, 2, GL_UNSIGNED_INT, (void*)(2 * sizeof(int) * slot));
+		}
+		
+		if(0 <= d.hover_vertex) {
+			glDrawArrays(GL_POINTS, d.hover_vertex, 1);
+		}
+		
+		glUniform4f(5, 1, 1, 1, 1);
+		d.pass_timers.End();
+		
+		// Draw every thing as an arrow in one instanced call, the arrow model is a line strip.
+		d.pass_timers.Begin(thing_pass);
+		gl.UseProgram(d.thing_draw_program);
+		gl.BindVertexArray(d.map_thing_meshes [d.front_map_meshes].vertex_array);
+		glDrawArraysInstanced(GL_LINE_STRIP, 0, 5, d.thing_count);
+		
+		if(0 <= d.hover_thing) {
+			glUniform4f(5, 2, 2, 2, 1);
+			glDrawArraysInstancedBaseInstance(GL_LINE_STRIP, 0, 5, 1, d.hover_thing);
+			glUniform4f(5, 1, 1, 1, 1);
+		}
+		
+		d.pass_timers.End();
+		
+		// Draw the zoom bar.
+		d.pass_timers.Begin(bar_pass);
+		gl.UseProgram(d.bar_draw_program);
+		gl.BindVertexArray(d.bar_mesh.vertex_array);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		d.pass_timers.End();
+	}
+	
+	// Frame time graphs in the top left corner. Whole frames in white, then CPU time of ticking in
+	// green and of drawing in yellow, GPU time of the lines in magenta and of the things in cyan.
+	// The box is 33 ms high, the line across it marks 16.7 ms.
+	void OnDrawHud () {
+		static constexpr int graph_frame_count = 240;
+		static constexpr float graph_ms = 100.0f / 3;
+		static constexpr float left = -0.98f;
+		static constexpr float right = -0.38f;
+		static constexpr float bottom = 0.55f;
+		static constexpr float top = 0.95f;
+		
+		struct Graph {
+			const char* name;
+			float red;
+			float green;
+			float blue;
+		};
+		
+		static constexpr Graph graphs [] = {
+			{ nullptr, 1, 1, 1 },
+			{ "OnTick", 0.3, 1, 0.3 },
+			{ "OnDraw", 1, 1, 0.2 },
+			{ "gpu lines", 1, 0.3, 1 },
+			{ "gpu things", 0.3, 1, 1 }
+		};
+		
+		auto& vertices = d.hud_vertices;
+		auto& times = d.hud_times;
+		auto& profiler = GlobalProfiler();
+		vertices.clear();
+		
+		auto add_vertex = [&] (float x, float y) {
+			vertices.push_back(x);
+			vertices.push_back(y);
+		};
+		
+		// Box and reference line, then one strip per graph with the newest frame on the right.
+		add_vertex(left, bottom);
+		add_vertex(right, bottom);
+		add_vertex(right, top);
+		add_vertex(left, top);
+		add_vertex(left, 0.5f * (bottom + top));
+		add_vertex(right, 0.5f * (bottom + top));
+		
+		static constexpr int graph_count = sizeof(graphs) / sizeof(graphs [0]);
+		int graph_vertex_counts [graph_count];
+		
+		for(int g = 0; g < graph_count; g++) {
+			const auto& graph = graphs [g];
+			
+			if(graph.name) {
+				profiler.RecentSampleTimes(graph.name, graph_frame_count, times);
+			}
+			
+			else {
+				profiler.RecentFrameTimes(graph_frame_count, times);
+			}
+			
+			int first_frame = graph_frame_count - times.size();
+			
+			for(std::size_t k = 0; k < times.size(); k++) {
+				float x = left + (right - left) * (first_frame + k) / (graph_frame_count - 1);
+				float y = bottom + (top - bottom) * std::min(1.0f, times [k] / graph_ms);
+				add_vertex(x, y);
+			}
+			
+			graph_vertex_counts [g] = times.size();
+		}
+		
+		auto& gl = d.gl_funcs;
+		d.pass_timers.Begin(hud_pass);
+		d.hud_mesh.Upload(0, sizeof(float) * vertices.size(), vertices.data(), GL_STREAM_DRAW);
+		gl.UseProgram(d.hud_draw_program);
+		gl.BindVertexArray(d.hud_mesh.vertex_array);
+		glUniform4f(0, 0.6, 0.6, 0.6, 1);
+		glDrawArrays(GL_LINE_LOOP, 0, 4);
+		glDrawArrays(GL_LINES, 4, 2);
+		
+		int first_vertex = 6;
+		
+		for(int g = 0; g < graph_count; g++) {
+			glUniform4f(0, graphs [g].red, graphs [g].green, graphs [g].blue, 1);
+			glDrawArrays(GL_LINE_STRIP, first_vertex, graph_vertex_counts [g]);
+			first_vertex += graph_vertex_counts [g];
+		}
+		
+		d.pass_timers.End();
+	}
+	
+	// Show the average CPU time of issuing the draw calls in the window title.
+	void OnDrawTime (double seconds) {
+		static constexpr int report_frame_count = 120;
+		d.draw_seconds += seconds;
+		d.draw_frame_count++;
+		
+		if(report_frame_count <= d.draw_frame_count) {
+			std::stringstream title;
+			title << "Map Viewer - draw " << std::fixed << std::setprecision(3) << 1e3 * d.draw_seconds / d.draw_frame_count << " ms";
+			glfwSetWindowTitle(d.window, title.str().c_str());
+			d.draw_seconds = 0;
+			d.draw_frame_count = 0;
+		}
+	}
+	
+	int MainLoop () {
+		d.timer = 0;
+		d.exit_pressed = 0;
+		
+		while(d.exit_pressed < 1) {
+			glfwPollEvents();
+			
+			if(glfwWindowShouldClose(d.window)) {
+				d.exit_pressed++;
+			}
+			
+			if(0 == d.timer) {
+				OnFirstTick();
+			}
+			
+			OnTick();
+			
+			glClearColor(0.343, 0.03030, 0.143, 1.0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			
+			auto draw_start = std::chrono::steady_clock::now();
+			OnDraw();
+			std::chrono::duration <double> draw_time = std::chrono::steady_clock::now() - draw_start;
+			OnDrawTime(draw_time.count());
+			
+			glfwSwapBuffers(d.window);
+			d.pass_timers.EndFrame();
+			GlobalProfiler().EndFrame();
+			d.timer++;
+		}
+		
+		OnLastTick();
+		
+		return 0;
+	}
+	
+	WadAppData& d;
+};
+
+#endif
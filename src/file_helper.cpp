@@ -1,6 +1,21 @@
 #include "file_helper.h"
+#include <atomic>
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <utility>
+#include <algorithm>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
 
 bool SlurpByteFile (std::vector <char>& m, std::string path) {
 	std::ifstream f(path, std::ios::binary);
@@ -26,4 +41,176 @@ void SlurpTextFile (const std::string& path, std::string& s) {
 		ss << f.rdbuf();
 		s = ss.str();
 	}
-}
\ No newline at end of file
+}
+
+std::string UniqueTempPath (const std::string& path) {
+	static std::atomic <unsigned> temp_count = 0;
+	
+	#ifdef _WIN32
+		unsigned long process_id = GetCurrentProcessId();
+	#else
+		unsigned long process_id = getpid();
+	#endif
+	
+	std::stringstream ss;
+	ss << path << '.' << process_id << '.' << std::hex << std::hash <std::thread::id> ()(std::this_thread::get_id())
+		<< '.' << temp_count.fetch_add(1) << ".tmp";
+	
+	return ss.str();
+}
+
+MappedFile::MappedFile () {
+	data			= nullptr;
+	size			= 0;
+	file_handle		= nullptr;
+	mapping_handle	= nullptr;
+}
+
+MappedFile::MappedFile (MappedFile&& m) : MappedFile() {
+	*this = std::move(m);
+}
+
+MappedFile::~MappedFile () {
+	Close();
+}
+
+MappedFile& MappedFile::operator= (MappedFile&& m) {
+	if(this != &m) {
+		Close();
+		std::swap(data, m.data);
+		std::swap(size, m.size);
+		std::swap(file_handle, m.file_handle);
+		std::swap(mapping_handle, m.mapping_handle);
+	}
+	
+	return *this;
+}
+
+bool MappedFile::IsOpen () const {
+	return nullptr != data;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open (const std::string& path) {
+	Close();
+	
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	
+	if(INVALID_HANDLE_VALUE == file) {
+		return false;
+	}
+	
+	LARGE_INTEGER file_size;
+	
+	// Empty files cannot be mapped, the caller falls back to reading them.
+	if(!GetFileSizeEx(file, &file_size) || 0 == file_size.QuadPart) {
+		CloseHandle(file);
+		return false;
+	}
+	
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	
+	if(!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+	
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	
+	if(!view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	
+	data			= static_cast <const char*> (view);
+	size			= static_cast <std::size_t> (file_size.QuadPart);
+	file_handle		= file;
+	mapping_handle	= mapping;
+	return true;
+}
+
+void MappedFile::Close () {
+	if(data) {
+		UnmapViewOfFile(data);
+		CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+	}
+	
+	data			= nullptr;
+	size			= 0;
+	file_handle		= nullptr;
+	mapping_handle	= nullptr;
+}
+
+// FILE_FLAG_RANDOM_ACCESS on open already disables read-ahead, and pages come in on first touch.
+void MappedFile::AdviseRandom () const {
+}
+
+void MappedFile::AdviseWillNeed (std::size_t offset, std::size_t count) const {
+}
+
+#else
+
+bool MappedFile::Open (const std::string& path) {
+	Close();
+	
+	int fd = open(path.c_str(), O_RDONLY);
+	
+	if(fd < 0) {
+		return false;
+	}
+	
+	struct stat file_stat;
+	
+	// Empty files cannot be mapped, the caller falls back to reading them.
+	if(0 != fstat(fd, &file_stat) || file_stat.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+	
+	void* view = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	
+	// The mapping keeps its own reference to the file.
+	close(fd);
+	
+	if(MAP_FAILED == view) {
+		return false;
+	}
+	
+	data = static_cast <const char*> (view);
+	size = static_cast <std::size_t> (file_stat.st_size);
+	return true;
+}
+
+void MappedFile::Close () {
+	if(data) {
+		munmap(const_cast <char*> (data), size);
+	}
+	
+	data			= nullptr;
+	size			= 0;
+	file_handle		= nullptr;
+	mapping_handle	= nullptr;
+}
+
+void MappedFile::AdviseRandom () const {
+	if(data) {
+		madvise(const_cast <char*> (data), size, MADV_RANDOM);
+	}
+}
+
+void MappedFile::AdviseWillNeed (std::size_t offset, std::size_t count) const {
+	if(!data || size <= offset) {
+		return;
+	}
+	
+	// madvise wants a page aligned start.
+	static const std::size_t page_size = sysconf(_SC_PAGESIZE);
+	std::size_t begin = offset - offset % page_size;
+	std::size_t end = std::min(size, offset + count);
+	madvise(const_cast <char*> (data + begin), end - begin, MADV_WILLNEED);
+}
+
+#endif
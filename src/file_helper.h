@@ -3,8 +3,41 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
 
 bool SlurpByteFile (std::vector <char>& m, std::string path);
 void SlurpTextFile (const std::string& path, std::string& s);
 
+// A name next to path to write a file under before renaming it over path. The process, thread and
+// a count go into it, so writers of the same path never share a temporary file.
+std::string UniqueTempPath (const std::string& path);
+
+// Read only memory mapping of a whole file. Nothing is read from disk until a page is touched,
+// so opening a large file costs the same as opening a small one.
+struct MappedFile {
+	MappedFile ();
+	MappedFile (MappedFile&& m);
+	MappedFile (const MappedFile&) = delete;
+	~MappedFile ();
+	
+	MappedFile& operator= (MappedFile&& m);
+	MappedFile& operator= (const MappedFile&) = delete;
+	
+	bool Open (const std::string& path);
+	void Close ();
+	bool IsOpen () const;
+	
+	// Paging hints. Random access stops the system from reading ahead through the whole file,
+	// will-need starts reading a range in the background before it is touched.
+	void AdviseRandom () const;
+	void AdviseWillNeed (std::size_t offset, std::size_t count) const;
+	
+	const char* data;
+	std::size_t size;
+	
+	// Native handles kept for unmapping.
+	void* file_handle;
+	void* mapping_handle;
+};
+
 #endif
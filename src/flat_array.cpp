@@ -0,0 +1,131 @@
+#include "flat_array.h"
+#include "work_pool.h"
+
+// Flat names in sectors are matched the way the original does, upper cased.
+static std::uint64_t UpperCaseKey (std::uint64_t key) {
+	for(int b = 0; b < 8; b++) {
+		auto c = key >> (8 * b) & 0xFF;
+		
+		if('a' <= c && c <= 'z') {
+			key -= static_cast <std::uint64_t> ('a' - 'A') << (8 * b);
+		}
+	}
+	
+	return key;
+}
+
+// Every texel is the rounded mean of the 2 by 2 texels above it. Two channels at a time go through
+// 16 bit lanes of a 32 bit word, four bytes sum to at most 1020 and do not spill over.
+static void HalveLevel (const std::uint32_t* above, int width, std::uint32_t* below) {
+	const std::uint32_t lane_mask = 0x00FF00FF;
+	const std::uint32_t round = 0x00020002;
+	
+	for(int y = 0; y < width; y++) {
+		const auto* row = above + 4 * width * y;
+		const auto* next_row = row + 2 * width;
+		auto* out = below + width * y;
+		
+		for(int x = 0; x < width; x++) {
+			std::uint32_t texels [4] = { row [2 * x], row [2 * x + 1], next_row [2 * x], next_row [2 * x + 1] };
+			std::uint32_t even = round;
+			std::uint32_t odd = round;
+			
+			for(auto t: texels) {
+				even += t & lane_mask;
+				odd += t >> 8 & lane_mask;
+			}
+			
+			out [x] = (even >> 2 & lane_mask) | (odd >> 2 & lane_mask) << 8;
+		}
+	}
+}
+
+FlatArray::FlatArray () {
+	Clear();
+}
+
+void FlatArray::Clear () {
+	layer_keys.clear();
+	layer_table.Reset(0);
+	pixels = Pixels();
+}
+
+void FlatArray::Build (const WadStack& wads, const DoomPalette& palette, int thread_count) {
+	static const std::uint64_t start_keys [] = { DoomWad::LumpKey("F_START"), DoomWad::LumpKey("FF_START") };
+	static const std::uint64_t end_keys [] = { DoomWad::LumpKey("F_END"), DoomWad::LumpKey("FF_END") };
+	Clear();
+	
+	// Inner markers such as F1_START are empty and fall out with the lumps too small to be flats.
+	std::vector <const std::uint8_t*> sources;
+	
+	for(const auto& wad: wads.wads) {
+		bool is_in_flats = false;
+		
+		for(int k = 0; k < wad.lump_count; k++) {
+			auto key = wad.lump_keys [k];
+			const auto& lump = wad.Lump(k);
+			
+			if(start_keys [0] == key || start_keys [1] == key) {
+				is_in_flats = true;
+			}
+			
+			else if(end_keys [0] == key || end_keys [1] == key) {
+				is_in_flats = false;
+			}
+			
+			else if(is_in_flats && flat_pixel_count <= lump.size && wad.IsLumpValid(lump)) {
+				const auto* flat = reinterpret_cast <const std::uint8_t*> (wad.LumpData(lump));
+				int layer = layer_table.Insert(UpperCaseKey(key), sources.size());
+				
+				if(layer == sources.size()) {
+					layer_keys.push_back(UpperCaseKey(key));
+					sources.push_back(flat);
+				}
+				
+				else {
+					sources [layer] = flat;
+				}
+			}
+		}
+	}
+	
+	pixels.layer_count = sources.size();
+	
+	for(int level = 0; level < flat_level_count; level++) {
+		int width = flat_width >> level;
+		pixels.levels [level].resize(static_cast <std::size_t> (pixels.layer_count) * width * width);
+	}
+	
+	// Colormap 0 is full brightness, sector light is applied when drawing.
+	std::uint32_t table [palette_color_count];
+	palette.LightTable(0, 0, table);
+	const auto& kernels = BestPaletteKernels();
+	WorkPool pool(thread_count);
+	
+	pool.Run(pixels.layer_count, [&] (int layer, int thread) {
+		kernels.expand(sources [layer], flat_pixel_count, table, pixels.levels [0].data() + static_cast <std::size_t> (flat_pixel_count) * layer);
+		
+		for(int level = 1; level < flat_level_count; level++) {
+			int width = flat_width >> level;
+			const auto* above = pixels.levels [level - 1].data() + static_cast <std::size_t> (4 * width * width) * layer;
+			auto* below = pixels.levels [level].data() + static_cast <std::size_t> (width * width) * layer;
+			HalveLevel(above, width, below);
+		}
+	});
+}
+
+int FlatArray::LayerCount () const {
+	return layer_keys.size();
+}
+
+int FlatArray::FindLayer (std::uint64_t key) const {
+	return layer_table.Find(UpperCaseKey(key));
+}
+
+void FlatArray::SectorFloorLayers (const DoomMap& map, std::vector <int>& layers) const {
+	layers.resize(map.sector_floor_flat.size());
+	
+	for(std::size_t s = 0; s < layers.size(); s++) {
+		layers [s] = FindLayer(map.sector_floor_flat [s]);
+	}
+}
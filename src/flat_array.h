@@ -0,0 +1,53 @@
+#ifndef FLAT_ARRAY_H
+#define FLAT_ARRAY_H
+
+#include <cstdint>
+#include <vector>
+#include "doom_map.h"
+#include "palette.h"
+#include "wad_file.h"
+#include "wad_stack.h"
+
+// Flats are 64 by 64 palette indices, the lumps between F_START and F_END, or FF_START and FF_END
+// in PWADs. Every flat of a stack is one layer of a single texture array, so the floors of a whole
+// map draw with one texture bound.
+constexpr int flat_width = 64;
+constexpr int flat_pixel_count = flat_width * flat_width;
+
+// Mip levels from 64 by 64 down to 1 by 1.
+constexpr int flat_level_count = 7;
+
+struct FlatArray {
+	FlatArray ();
+	
+	void Clear ();
+	
+	// Finds the flats of the stack and expands them through the palette at full brightness, each
+	// with its mip levels, in parallel. Zero threads means one per core. A flat name in a later
+	// wad replaces the same name below it and keeps its layer.
+	void Build (const WadStack& wads, const DoomPalette& palette, int thread_count = 0);
+	
+	int LayerCount () const;
+	
+	// Names are not case sensitive, as in the original. Returns -1 for flats not in the array.
+	int FindLayer (std::uint64_t key) const;
+	
+	// The layer of the floor of every sector.
+	void SectorFloorLayers (const DoomMap& map, std::vector <int>& layers) const;
+	
+	// Upper case flat names to layers.
+	std::vector <std::uint64_t> layer_keys;
+	LumpKeyTable layer_table;
+	
+	// The RGBA texels of every layer, level by level. A level holds all layers one after the other,
+	// the way open-gl takes a level of a texture array, and each level is half the width of the one
+	// before. Can be moved out for upload, the layer index stays usable without it.
+	struct Pixels {
+		int layer_count = 0;
+		std::vector <std::uint32_t> levels [flat_level_count];
+	};
+	
+	Pixels pixels;
+};
+
+#endif
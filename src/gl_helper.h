@@ -0,0 +1,469 @@
+#ifndef GL_HELPER_H
+#define GL_HELPER_H
+
+#include "file_helper.h"
+#include "palette.h"
+#include "profiler.h"
+#include "lodepng.h"
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <iostream>
+
+struct PngFile {
+	
+	PngFile (std::string path) {
+		data	= nullptr;
+		width	= 0;
+		height	= 0;
+		lodepng_decode24_file(&data, &width, &height, path.c_str());
+	}
+	
+	~PngFile () {
+		if(data) {
+			delete [] data;
+		}
+	}
+	
+	unsigned char* data;
+	unsigned width;
+	unsigned height;
+};
+
+// Contains a few open-gl context related infos for loading shaders, making programs and reading
+// error logs and the like.
+struct GlFuncs {
+	GlFuncs () {
+		bound_program = 0;
+		bound_vertex_array = 0;
+	}
+	
+	// Draw state cache. The program and vertex array in use are remembered, so switching to the
+	// one already bound costs nothing. All binding has to go through here for this to hold.
+	void UseProgram (GLuint program) {
+		if(program != bound_program) {
+			glUseProgram(program);
+			bound_program = program;
+		}
+	}
+	
+	void BindVertexArray (GLuint vertex_array) {
+		if(vertex_array != bound_vertex_array) {
+			glBindVertexArray(vertex_array);
+			bound_vertex_array = vertex_array;
+		}
+	}
+	
+	// Load multiple png's as an open-gl cubemap.
+	GLuint LoadCubeMap (std::vector <std::string>&& paths) {
+		GLuint texture = 0;
+		
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+		
+		int k = 0;
+		
+		for(const auto& s: paths) {
+			PngFile png(s);
+			
+			if(png.data) {
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + k, 0, GL_RGB, png.width, png.height, 0, GL_RGB, GL_UNSIGNED_BYTE, png.data);
+			}
+			
+			k++;
+		}
+		
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+	
+	// Load a png as an open-gl texture.
+	GLuint LoadTexture (std::string path) {
+		GLuint texture = 0;
+		
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		
+		PngFile png(path);
+		
+		if(png.data) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, png.width, png.height, 0, GL_RGB, GL_UNSIGNED_BYTE, png.data);
+		}
+		
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+	
+	// Load RGBA pixels as an open-gl texture. Wad graphics repeat across walls and floors and keep
+	// their hard pixel edges up close.
+	GLuint LoadTexture (const std::uint32_t* rgba, int width, int height) {
+		GLuint texture = 0;
+		
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		return texture;
+	}
+	
+	// Load 8 bit paletted pixels, such as a flat, expanded through a table of 256 colors from
+	// DoomPalette::LightTable.
+	GLuint LoadTexture (const std::uint8_t* pixels, int width, int height, const std::uint32_t* table) {
+		expand_buffer.resize(static_cast <std::size_t> (width) * height);
+		BestPaletteKernels().expand(pixels, expand_buffer.size(), table, expand_buffer.data());
+		return LoadTexture(expand_buffer.data(), width, height);
+	}
+	
+	// Load layers of RGBA pixels with all their mip levels as one texture array, so a draw call can
+	// pick between them without binding anything. Every level holds the layers one after the other
+	// and is half the size of the one before.
+	GLuint LoadTextureArray (const std::vector <std::uint32_t>* levels, int level_count, int width, int height, int layer_count) {
+		GLuint texture = 0;
+		
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, level_count, GL_RGBA8, width, height, layer_count);
+		
+		for(int level = 0; level < level_count; level++) {
+			int level_width = std::max(1, width >> level);
+			int level_height = std::max(1, height >> level);
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, level_width, level_height, layer_count, GL_RGBA, GL_UNSIGNED_BYTE, levels [level].data());
+		}
+		
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		return texture;
+	}
+	
+	// A complete process of loading shader source files, compiling them, attaching them to a newly
+	// generated program and linking it.
+	struct LoadProgramParam {
+		std::string shader_path;
+		GLint shader_enum;
+	};
+	
+	GLuint LoadProgram (std::vector <LoadProgramParam> shaders_to_load) {
+		std::vector <GLuint> shaders;
+		
+		for(const auto& s: shaders_to_load) {
+			auto shader = LoadShaderFile(s.shader_path, s.shader_enum);
+			
+			if(!is_shader_compile_good) {
+				std::cout << "Shader compile error (" << s.shader_path << "): " << shader_info_log << std::endl;
+			}
+			
+			else {
+				shaders.push_back(shader);
+			}
+		}
+		
+		return MakeProgram(shaders);
+	}
+	
+	GLuint LoadShaderFile (const std::string& path, GLint shader_mode) {
+		GLuint shader = glCreateShader(shader_mode);
+		std::string shader_source;
+		
+		SlurpTextFile(path, shader_source);
+		char const* temp_ptr = shader_source.c_str();
+		glShaderSource(shader, 1, &temp_ptr, nullptr);
+		glCompileShader(shader);
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &is_shader_compile_good);
+		glGetShaderInfoLog(shader, log_buffer_size, nullptr, shader_info_log);
+		
+		return shader;
+	}
+	
+	GLuint MakeProgram (std::vector <GLuint> shaders) {
+		GLuint program = glCreateProgram();
+		
+		for(auto shader: shaders) {
+			glAttachShader(program, shader);
+		}
+		
+		glLinkProgram(program);
+		return program;
+	}
+	
+	static constexpr std::size_t log_buffer_size = 0x400;
+	char shader_info_log [log_buffer_size];
+	char program_info_log [log_buffer_size];
+	int is_shader_compile_good;
+	int is_program_link_good;
+	
+	GLuint bound_program;
+	GLuint bound_vertex_array;
+	
+	// Paletted pixels expanded for upload, kept between loads.
+	std::vector <std::uint32_t> expand_buffer;
+};
+
+// A vertex array object and the buffers it reads from, with real handles from open-gl. The
+// attribute layout is recorded once when the mesh is set up, drawing only binds the vertex array.
+// Buffer contents can be replaced at any time without touching the layout. Needs a current
+// context for everything but the constructor, and binds through GlFuncs to keep its cache true.
+struct GlMesh {
+	GlMesh () {
+		vertex_array = 0;
+	}
+	
+	GlMesh (const GlMesh&) = delete;
+	GlMesh& operator= (const GlMesh&) = delete;
+	
+	void Create (GlFuncs& gl_funcs, int buffer_count) {
+		Destroy(gl_funcs);
+		glGenVertexArrays(1, &vertex_array);
+		buffers.resize(buffer_count);
+		glGenBuffers(buffer_count, buffers.data());
+	}
+	
+	void Destroy (GlFuncs& gl_funcs) {
+		
+		// Deleting the bound vertex array falls back to none.
+		if(vertex_array == gl_funcs.bound_vertex_array) {
+			gl_funcs.bound_vertex_array = 0;
+		}
+		
+		if(vertex_array) {
+			glDeleteVertexArrays(1, &vertex_array);
+			glDeleteBuffers(buffers.size(), buffers.data());
+		}
+		
+		vertex_array = 0;
+		buffers.clear();
+	}
+	
+	// Replace the contents of a buffer. Leaves the buffer bound to GL_ARRAY_BUFFER.
+	void Upload (int buffer, std::size_t byte_count, const void* data, GLenum usage = GL_STATIC_DRAW) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffers [buffer]);
+		glBufferData(GL_ARRAY_BUFFER, byte_count, data, usage);
+	}
+	
+	// Record a float attribute read from a buffer, and the buffer to take element indices from.
+	void Attribute (GlFuncs& gl_funcs, int buffer, GLuint location, GLint component_count, GLsizei stride = 0, std::size_t offset = 0, GLuint divisor = 0) {
+		gl_funcs.BindVertexArray(vertex_array);
+		glBindBuffer(GL_ARRAY_BUFFER, buffers [buffer]);
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, component_count, GL_FLOAT, GL_FALSE, stride, reinterpret_cast <const void*> (offset));
+		glVertexAttribDivisor(location, divisor);
+	}
+	
+	// Integer attribute, read by the shader as int or uint without conversion to float.
+	void IntegerAttribute (GlFuncs& gl_funcs, int buffer, GLuint location, GLint component_count, GLenum type, GLsizei stride = 0, std::size_t offset = 0, GLuint divisor = 0) {
+		gl_funcs.BindVertexArray(vertex_array);
+		glBindBuffer(GL_ARRAY_BUFFER, buffers [buffer]);
+		glEnableVertexAttribArray(location);
+		glVertexAttribIPointer(location, component_count, type, stride, reinterpret_cast <const void*> (offset));
+		glVertexAttribDivisor(location, divisor);
+	}
+	
+	void Elements (GlFuncs& gl_funcs, int buffer) {
+		gl_funcs.BindVertexArray(vertex_array);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers [buffer]);
+	}
+	
+	GLuint vertex_array;
+	std::vector <GLuint> buffers;
+};
+
+// GL_TIME_ELAPSED queries around named draw passes. Every pass has a few queries used in turn,
+// results are picked up frames later once open-gl says they are there, so reading them never
+// waits on the gpu. A pass whose query from frame_depth frames ago is still out goes untimed.
+struct GlPassTimers {
+	static constexpr int frame_depth = 4;
+	
+	GlPassTimers () {
+		active_query = -1;
+		frame = 0;
+	}
+	
+	GlPassTimers (const GlPassTimers&) = delete;
+	GlPassTimers& operator= (const GlPassTimers&) = delete;
+	
+	// Names must outlive the timers, they go into the profiler as they are.
+	void Create (std::vector <const char*> pass_names) {
+		Destroy();
+		names = std::move(pass_names);
+		queries.resize(names.size() * frame_depth);
+		glGenQueries(queries.size(), queries.data());
+		query_frames.assign(queries.size(), -1);
+		query_starts.assign(queries.size(), 0);
+		active_query = -1;
+	}
+	
+	void Destroy () {
+		if(!queries.empty()) {
+			glDeleteQueries(queries.size(), queries.data());
+		}
+		
+		queries.clear();
+		query_frames.clear();
+		query_starts.clear();
+	}
+	
+	// Passes can not nest, open-gl allows one GL_TIME_ELAPSED query at a time.
+	void Begin (int pass) {
+		int query = pass * frame_depth + frame % frame_depth;
+		
+		if(queries.empty() || 0 <= query_frames [query]) {
+			return;
+		}
+		
+		glBeginQuery(GL_TIME_ELAPSED, queries [query]);
+		query_frames [query] = GlobalProfiler().frame_count;
+		query_starts [query] = Profiler::Now();
+		active_query = query;
+	}
+	
+	void End () {
+		if(0 <= active_query) {
+			glEndQuery(GL_TIME_ELAPSED);
+			active_query = -1;
+		}
+	}
+	
+	// Hand finished results to the profiler and move on to the next set of queries.
+	void EndFrame () {
+		for(std::size_t query = 0; query < queries.size(); query++) {
+			if(query_frames [query] < 0) {
+				continue;
+			}
+			
+			GLint is_available = 0;
+			glGetQueryObjectiv(queries [query], GL_QUERY_RESULT_AVAILABLE, &is_available);
+			
+			if(!is_available) {
+				continue;
+			}
+			
+			GLuint64 duration_ns = 0;
+			glGetQueryObjectui64v(queries [query], GL_QUERY_RESULT, &duration_ns);
+			GlobalProfiler().Record(names [query / frame_depth], query_starts [query], duration_ns, Profiler::gpu_sample, query_frames [query]);
+			query_frames [query] = -1;
+		}
+		
+		frame++;
+	}
+	
+	std::vector <const char*> names;
+	std::vector <GLuint> queries;
+	std::vector <std::int64_t> query_frames;
+	std::vector <std::uint64_t> query_starts;
+	int active_query;
+	std::uint64_t frame;
+};
+
+struct GlModelFuncs {
+	void MakeCube (std::vector <GLfloat>& m) {
+		m = std::vector <GLfloat> {
+			0, 1, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0,
+			1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 1, 1,
+			1, 1, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1,
+			0, 1, 1, 0, 0, 1, 0, 0, 0, 0, 1, 0,
+			1, 1, 0, 1, 1, 1, 0, 1, 1, 0, 1, 0,
+			1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1,
+		};
+	}
+	
+	void MakePlane (std::vector <GLfloat>& m) {
+		m = std::vector <GLfloat> {
+			0, 0, 0,
+			1, 0, 0,
+			1, 1, 0,
+			0, 1, 0
+		};
+	}
+	
+	void Make2dQuadTris (std::vector <GLfloat>& m) {
+		m = std::vector <GLfloat> {
+			0, 0, 1, 0, 0, 1,
+			1, 0, 1, 1, 0, 1
+		};
+	}
+	
+	void Make2dArrow (std::vector <GLfloat>& m) {
+		m = std::vector <GLfloat> {
+			0, 0, 1, 0, 0.5, -0.5, 1, 0, 0.5, 0.5
+		};
+	}
+	
+	void MakeTriGrid (std::vector <GLfloat>& m, int x_size, int y_size) {
+		x_size = std::max(1, x_size);
+		y_size = std::max(1, y_size);
+		
+		auto fx = 1.0 / x_size;
+		auto fy = 1.0 / y_size;
+		float cur_x = 0;
+		
+		for(int x = 0; x < x_size; x++) {
+			float cur_y = 0;
+			
+			for(int y = 0; y < y_size; y++) {
+				m.push_back(cur_x);
+				m.push_back(cur_y);
+				m.push_back(0);
+				
+				m.push_back(cur_x + fx);
+				m.push_back(cur_y);
+				m.push_back(0);
+				
+				m.push_back(cur_x);
+				m.push_back(cur_y + fy);
+				m.push_back(0);
+				
+				m.push_back(cur_x + fx);
+				m.push_back(cur_y);
+				m.push_back(0);
+				
+				m.push_back(cur_x + fx);
+				m.push_back(cur_y + fy);
+				m.push_back(0);
+				
+				m.push_back(cur_x);
+				m.push_back(cur_y + fy);
+				m.push_back(0);
+				
+				cur_y += fy;
+			}
+			
+			cur_x += fx;
+		}
+	}
+	
+	void Rescale2dModel (std::vector <GLfloat>& m, GLfloat size = 1.0, GLfloat fx = 0.5, GLfloat fy = 0.5) {
+		for(int k = 0; k < m.size(); k += 2) {
+			m [0 + k] -= fx;
+			m [1 + k] -= fy;
+			
+			m [0 + k] *= size;
+			m [1 + k] *= size;
+		}
+	}
+	
+	void RescaleModel (std::vector <GLfloat>& m, GLfloat size = 1.0, GLfloat fx = 0.5, GLfloat fy = 0.5, GLfloat fz = 0.5) {
+		for(int k = 0; k < m.size(); k += 3) {
+			m [0 + k] -= fx;
+			m [1 + k] -= fy;
+			m [2 + k] -= fz;
+			
+			m [0 + k] *= size;
+			m [1 + k] *= size;
+			m [2 + k] *= size;
+		}
+	}
+};
+
+#endif
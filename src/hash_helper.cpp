@@ -0,0 +1,32 @@
+#include "hash_helper.h"
+#include <cstring>
+
+static std::uint64_t HashMix (std::uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+std::uint64_t HashBytes (const void* data, std::size_t size, std::uint64_t seed) {
+	static constexpr std::uint64_t prime = 0x9E3779B97F4A7C15ULL;
+	
+	auto* bytes = static_cast <const unsigned char*> (data);
+	std::uint64_t h = seed ^ (size * prime);
+	std::size_t word_count = size / 8;
+	
+	for(std::size_t k = 0; k < word_count; k++) {
+		std::uint64_t word;
+		std::memcpy(&word, bytes + 8 * k, 8);
+		h = (h ^ HashMix(word)) * prime;
+	}
+	
+	// Remaining bytes go in as one last zero padded word.
+	std::uint64_t tail = 0;
+	std::memcpy(&tail, bytes + 8 * word_count, size % 8);
+	h = (h ^ HashMix(tail)) * prime;
+	
+	return HashMix(h);
+}
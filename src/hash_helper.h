@@ -0,0 +1,12 @@
+#ifndef HASH_HELPER_H
+#define HASH_HELPER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Fast 64 bit content hash for telling lumps and maps apart. Works on eight bytes at a time and
+// mixes well, but is not meant to resist deliberate collisions. Chain calls through the seed to
+// hash several ranges as one.
+std::uint64_t HashBytes (const void* data, std::size_t size, std::uint64_t seed = 0);
+
+#endif
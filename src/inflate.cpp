@@ -0,0 +1,551 @@
+#include "inflate.h"
+#include <algorithm>
+#include <cstring>
+
+// Bits come from the least significant end, refilled up to eight bytes at a time. Past the end of
+// the input zeros are fed in, which only is an error once those bits are actually used.
+struct InflateBits {
+	InflateBits (const char* data, std::size_t size) {
+		this->data = reinterpret_cast <const std::uint8_t*> (data);
+		this->size = size;
+		pos = 0;
+		bits = 0;
+		bit_count = 0;
+	}
+	
+	// At least 56 bits are buffered afterwards.
+	void Refill () {
+		if(pos + 8 <= size) {
+			std::uint64_t word;
+			std::memcpy(&word, data + pos, sizeof(word));
+			bits |= word << bit_count;
+			pos += (63 - bit_count) >> 3;
+			bit_count |= 56;
+			return;
+		}
+		
+		while(bit_count <= 56) {
+			std::uint64_t byte = pos < size ? data [pos] : 0;
+			bits |= byte << bit_count;
+			bit_count += 8;
+			pos++;
+		}
+	}
+	
+	std::uint32_t Read (int count) {
+		std::uint32_t value = bits & ((std::uint64_t(1) << count) - 1);
+		Skip(count);
+		return value;
+	}
+	
+	void Skip (int count) {
+		bits >>= count;
+		bit_count -= count;
+	}
+	
+	// Drop the rest of the current byte and hand the buffered whole bytes back to the input.
+	void AlignToByte () {
+		Skip(bit_count & 7);
+		pos -= bit_count >> 3;
+		bits = 0;
+		bit_count = 0;
+	}
+	
+	// Bytes of the input used so far, counting a partly used byte.
+	std::size_t UsedBytes () const {
+		return pos - (bit_count >> 3);
+	}
+	
+	bool IsOverrun () const {
+		return size < pos && bit_count < 8 * (pos - size);
+	}
+	
+	const std::uint8_t* data;
+	std::size_t size;
+	std::size_t pos;
+	std::uint64_t bits;
+	int bit_count;
+};
+
+// Canonical Huffman code. Codes up to fast_bits long decode with one table lookup, the rare longer
+// ones are walked bit by bit through the code counts.
+struct InflateHuffman {
+	static constexpr int fast_bits = 10;
+	
+	// False for an over-subscribed code. Incomplete codes are allowed, their missing codes fail
+	// to decode.
+	bool Build (const std::uint8_t* lengths, int count) {
+		std::fill(counts, counts + 16, 0);
+		
+		for(int k = 0; k < count; k++) {
+			counts [lengths [k]]++;
+		}
+		
+		counts [0] = 0;
+		int left = 1;
+		
+		for(int length = 1; length < 16; length++) {
+			left = 2 * left - counts [length];
+			
+			if(left < 0) {
+				return false;
+			}
+		}
+		
+		std::uint16_t offsets [16];
+		offsets [1] = 0;
+		
+		for(int length = 1; length < 15; length++) {
+			offsets [length + 1] = offsets [length] + counts [length];
+		}
+		
+		for(int k = 0; k < count; k++) {
+			if(0 != lengths [k]) {
+				symbols [offsets [lengths [k]]++] = k;
+			}
+		}
+		
+		// Codes are sent from their first bit on, so the table is indexed by reversed codes.
+		std::fill(fast, fast + (1 << fast_bits), 0);
+		int code = 0;
+		int index = 0;
+		
+		for(int length = 1; length <= fast_bits; length++) {
+			for(int k = 0; k < counts [length]; k++) {
+				int reversed = 0;
+				
+				for(int b = 0; b < length; b++) {
+					reversed |= ((code >> b) & 1) << (length - 1 - b);
+				}
+				
+				for(int r = reversed; r < (1 << fast_bits); r += 1 << length) {
+					fast [r] = symbols [index] << 4 | length;
+				}
+				
+				index++;
+				code++;
+			}
+			
+			code <<= 1;
+		}
+		
+		return true;
+	}
+	
+	// Needs 15 bits buffered. Returns -1 for a code that is not in the table.
+	int Decode (InflateBits& in) const {
+		auto entry = fast [in.bits & ((1 << fast_bits) - 1)];
+		
+		if(0 != entry) {
+			in.Skip(entry & 15);
+			return entry >> 4;
+		}
+		
+		std::uint64_t bits = in.bits;
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		
+		for(int length = 1; length < 16; length++) {
+			code |= bits & 1;
+			bits >>= 1;
+			
+			if(code - first < counts [length]) {
+				in.Skip(length);
+				return symbols [index + code - first];
+			}
+			
+			index += counts [length];
+			first = (first + counts [length]) << 1;
+			code <<= 1;
+		}
+		
+		return -1;
+	}
+	
+	// Symbol and code length, zero where the code is longer than fast_bits.
+	std::uint16_t fast [1 << fast_bits];
+	std::uint16_t counts [16];
+	std::uint16_t symbols [288];
+};
+
+static const std::uint16_t length_base [29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const std::uint8_t length_extra [29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const std::uint16_t distance_base [30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const std::uint8_t distance_extra [30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Decodes one deflate stream to the end of out. The output vector doubles as the window, back
+// references may reach anywhere into what this stream decoded.
+struct Inflater {
+	Inflater (const char* data, std::size_t size, std::vector <char>& out) : in(data, size), out(out) {
+		out_start = out.size();
+		out_size = out.size();
+	}
+	
+	bool Run (std::size_t expected_size) {
+		out.resize(out_size + expected_size);
+		bool is_final = false;
+		bool is_valid = true;
+		
+		while(is_valid && !is_final) {
+			in.Refill();
+			is_final = 0 != in.Read(1);
+			int type = in.Read(2);
+			
+			if(0 == type) {
+				is_valid = Stored();
+			}
+			
+			else if(1 == type) {
+				is_valid = Fixed();
+			}
+			
+			else if(2 == type) {
+				is_valid = Dynamic();
+			}
+			
+			else {
+				is_valid = false;
+			}
+		}
+		
+		out.resize(out_size);
+		return is_valid && !in.IsOverrun();
+	}
+	
+	void Reserve (std::size_t count) {
+		if(out.size() < out_size + count) {
+			out.resize(std::max(2 * out.size(), out_size + count));
+		}
+	}
+	
+	bool Stored () {
+		in.AlignToByte();
+		
+		if(in.size < in.pos + 4) {
+			return false;
+		}
+		
+		auto read_16 = [&] (std::size_t at) {
+			return in.data [at] | in.data [at + 1] << 8;
+		};
+		
+		int length = read_16(in.pos);
+		
+		if(length != (~read_16(in.pos + 2) & 0xFFFF) || in.size < in.pos + 4 + length) {
+			return false;
+		}
+		
+		if(0 < length) {
+			Reserve(length);
+			std::memcpy(out.data() + out_size, in.data + in.pos + 4, length);
+			out_size += length;
+		}
+		
+		in.pos += 4 + length;
+		return true;
+	}
+	
+	bool Fixed () {
+		struct FixedTables {
+			FixedTables () {
+				std::uint8_t lengths [288];
+				std::fill(lengths, lengths + 144, 8);
+				std::fill(lengths + 144, lengths + 256, 9);
+				std::fill(lengths + 256, lengths + 280, 7);
+				std::fill(lengths + 280, lengths + 288, 8);
+				literals.Build(lengths, 288);
+				
+				std::fill(lengths, lengths + 30, 5);
+				distances.Build(lengths, 30);
+			}
+			
+			InflateHuffman literals;
+			InflateHuffman distances;
+		};
+		
+		static const FixedTables tables;
+		return Codes(tables.literals, tables.distances);
+	}
+	
+	bool Dynamic () {
+		static const std::uint8_t length_order [19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		
+		in.Refill();
+		int literal_count = 257 + in.Read(5);
+		int distance_count = 1 + in.Read(5);
+		int length_count = 4 + in.Read(4);
+		
+		if(286 < literal_count || 30 < distance_count) {
+			return false;
+		}
+		
+		// The code lengths of both tables are themselves Huffman coded, with runs.
+		std::uint8_t lengths [286 + 30] = {};
+		in.Refill();
+		
+		for(int k = 0; k < length_count; k++) {
+			lengths [length_order [k]] = in.Read(3);
+		}
+		
+		if(!length_table.Build(lengths, 19)) {
+			return false;
+		}
+		
+		int total = literal_count + distance_count;
+		std::fill(lengths, lengths + 19, 0);
+		
+		for(int k = 0; k < total; ) {
+			in.Refill();
+			int symbol = length_table.Decode(in);
+			
+			if(symbol < 0) {
+				return false;
+			}
+			
+			else if(symbol < 16) {
+				lengths [k++] = symbol;
+				continue;
+			}
+			
+			int value = 0;
+			int repeat = 0;
+			
+			if(16 == symbol) {
+				if(0 == k) {
+					return false;
+				}
+				
+				value = lengths [k - 1];
+				repeat = 3 + in.Read(2);
+			}
+			
+			else if(17 == symbol) {
+				repeat = 3 + in.Read(3);
+			}
+			
+			else {
+				repeat = 11 + in.Read(7);
+			}
+			
+			if(total < k + repeat) {
+				return false;
+			}
+			
+			std::fill(lengths + k, lengths + k + repeat, value);
+			k += repeat;
+		}
+		
+		if(0 == lengths [256] || in.IsOverrun()) {
+			return false;
+		}
+		
+		if(!literal_table.Build(lengths, literal_count) || !distance_table.Build(lengths + literal_count, distance_count)) {
+			return false;
+		}
+		
+		return Codes(literal_table, distance_table);
+	}
+	
+	// Literals and back references up to the end of block code. One refill covers the longest
+	// length and distance pair.
+	bool Codes (const InflateHuffman& literals, const InflateHuffman& distances) {
+		for(;;) {
+			in.Refill();
+			
+			if(in.IsOverrun()) {
+				return false;
+			}
+			
+			int symbol = literals.Decode(in);
+			
+			if(0 <= symbol && symbol < 256) {
+				Reserve(1);
+				out [out_size++] = symbol;
+				continue;
+			}
+			
+			else if(256 == symbol) {
+				return true;
+			}
+			
+			symbol -= 257;
+			
+			if(symbol < 0 || 29 <= symbol) {
+				return false;
+			}
+			
+			int length = length_base [symbol] + in.Read(length_extra [symbol]);
+			int code = distances.Decode(in);
+			
+			if(code < 0 || 30 <= code) {
+				return false;
+			}
+			
+			std::size_t distance = distance_base [code] + in.Read(distance_extra [code]);
+			
+			if(out_size - out_start < distance) {
+				return false;
+			}
+			
+			Reserve(length);
+			char* to = out.data() + out_size;
+			const char* from = to - distance;
+			
+			// Overlapping copies repeat the last distance bytes and have to go in order.
+			if(length <= distance) {
+				std::memcpy(to, from, length);
+			}
+			
+			else {
+				for(int k = 0; k < length; k++) {
+					to [k] = from [k];
+				}
+			}
+			
+			out_size += length;
+		}
+	}
+	
+	InflateBits in;
+	std::vector <char>& out;
+	std::size_t out_start;
+	std::size_t out_size;
+	
+	InflateHuffman length_table;
+	InflateHuffman literal_table;
+	InflateHuffman distance_table;
+};
+
+bool InflateRaw (const char* data, std::size_t size, std::vector <char>& out, std::size_t expected_size) {
+	Inflater inflater(data, size, out);
+	return inflater.Run(expected_size);
+}
+
+bool InflateZlib (const char* data, std::size_t size, std::vector <char>& out, std::size_t expected_size) {
+	if(size < 6) {
+		return false;
+	}
+	
+	// Deflate with a window of up to 32 kB and no preset dictionary.
+	int method = static_cast <std::uint8_t> (data [0]);
+	int flags = static_cast <std::uint8_t> (data [1]);
+	
+	if(8 != (method & 15) || 7 < (method >> 4) || 0 != (method << 8 | flags) % 31 || 0 != (flags & 0x20)) {
+		return false;
+	}
+	
+	std::size_t out_start = out.size();
+	Inflater inflater(data + 2, size - 2, out);
+	
+	if(!inflater.Run(expected_size)) {
+		return false;
+	}
+	
+	// The checksum follows big endian on the next whole byte.
+	inflater.in.AlignToByte();
+	std::size_t at = 2 + inflater.in.UsedBytes();
+	
+	if(size < at + 4) {
+		return false;
+	}
+	
+	std::uint32_t stored = 0;
+	
+	for(int k = 0; k < 4; k++) {
+		stored = stored << 8 | static_cast <std::uint8_t> (data [at + k]);
+	}
+	
+	return stored == Adler32(out.data() + out_start, out.size() - out_start);
+}
+
+std::uint32_t Adler32 (const void* data, std::size_t size, std::uint32_t adler) {
+	static constexpr std::uint32_t modulo = 65521;
+	
+	// The sums stay within 32 bits for this many bytes between reductions.
+	static constexpr std::size_t run_size = 5552;
+	
+	const auto* bytes = static_cast <const std::uint8_t*> (data);
+	std::uint32_t a = adler & 0xFFFF;
+	std::uint32_t b = adler >> 16;
+	
+	while(0 < size) {
+		std::size_t count = std::min(size, run_size);
+		size -= count;
+		
+		for(std::size_t k = 0; k < count; k++) {
+			a += bytes [k];
+			b += a;
+		}
+		
+		bytes += count;
+		a %= modulo;
+		b %= modulo;
+	}
+	
+	return b << 16 | a;
+}
+
+// Eight tables, so eight bytes are folded in per step with independent lookups. Table t holds
+// the checksum of a byte followed by t zero bytes.
+struct Crc32Tables {
+	Crc32Tables () {
+		for(std::uint32_t b = 0; b < 256; b++) {
+			std::uint32_t crc = b;
+			
+			for(int bit = 0; bit < 8; bit++) {
+				crc = crc >> 1 ^ (crc & 1 ? 0xEDB88320 : 0);
+			}
+			
+			tables [0] [b] = crc;
+		}
+		
+		for(int t = 1; t < 8; t++) {
+			for(int b = 0; b < 256; b++) {
+				tables [t] [b] = tables [t - 1] [b] >> 8 ^ tables [0] [tables [t - 1] [b] & 0xFF];
+			}
+		}
+	}
+	
+	std::uint32_t tables [8] [256];
+};
+
+std::uint32_t Crc32 (const void* data, std::size_t size, std::uint32_t crc) {
+	static const Crc32Tables crc_tables;
+	const auto& t = crc_tables.tables;
+	const auto* bytes = static_cast <const std::uint8_t*> (data);
+	crc = ~crc;
+	
+	for(; 8 <= size; size -= 8, bytes += 8) {
+		std::uint32_t lo;
+		std::uint32_t hi;
+		std::memcpy(&lo, bytes, 4);
+		std::memcpy(&hi, bytes + 4, 4);
+		lo ^= crc;
+		
+		crc =
+			t [7] [lo & 0xFF] ^ t [6] [lo >> 8 & 0xFF] ^ t [5] [lo >> 16 & 0xFF] ^ t [4] [lo >> 24] ^
+			t [3] [hi & 0xFF] ^ t [2] [hi >> 8 & 0xFF] ^ t [1] [hi >> 16 & 0xFF] ^ t [0] [hi >> 24];
+	}
+	
+	for(; 0 < size; size--, bytes++) {
+		crc = crc >> 8 ^ t [0] [(crc ^ *bytes) & 0xFF];
+	}
+	
+	return ~crc;
+}
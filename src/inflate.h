@@ -0,0 +1,21 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decompression of deflate streams, raw as in zip archives or wrapped in a zlib header and
+// checksum as in compressed nodes, without depending on zlib. Output is appended to out and
+// expected_size, when known, saves growing it. Returns false for a corrupt or cut off stream,
+// out then holds whatever was decoded before the error.
+bool InflateRaw (const char* data, std::size_t size, std::vector <char>& out, std::size_t expected_size = 0);
+bool InflateZlib (const char* data, std::size_t size, std::vector <char>& out, std::size_t expected_size = 0);
+
+// Checksum of the zlib format.
+std::uint32_t Adler32 (const void* data, std::size_t size, std::uint32_t adler = 1);
+
+// Checksum of the zip format. Continue a checksum by passing the previous result.
+std::uint32_t Crc32 (const void* data, std::size_t size, std::uint32_t crc = 0);
+
+#endif
@@ -0,0 +1,285 @@
+#include "lump_kernels.h"
+#include "space.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define LUMP_KERNELS_X86
+	#include <immintrin.h>
+	
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define LUMP_KERNELS_AVX2
+	#else
+		#define LUMP_KERNELS_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+// Vertices are the same in every binary format, things and linedefs come in the layouts of
+// map_records.h and every kernel for them is a template on the layout. Fields are read with
+// memcpy, lumps are not always aligned inside a wad.
+static constexpr int vertexes_record_size = 4;
+
+static const float byte_angle_to_rad = SpaceConst::Pi() / 128;
+
+static short LoadShort (const char* p) {
+	short v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static unsigned short LoadUnsignedShort (const char* p) {
+	unsigned short v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// Scalar kernels, the same loops WadFuncs always had. The SIMD kernels use them for the records
+// left over at the end.
+static void ScalarVertexesToFloat (const char* lump, int count, float* xy) {
+	for(int k = 0; k < count; k++) {
+		xy [0 + 2 * k] = LoadShort(lump + 0);
+		xy [1 + 2 * k] = LoadShort(lump + 2);
+		lump += vertexes_record_size;
+	}
+}
+
+template <typename Record>
+static void ScalarThingsToFloat (const char* lump, int count, float* xya) {
+	for(int k = 0; k < count; k++) {
+		xya [0 + 3 * k] = LoadShort(lump + Record::x);
+		xya [1 + 3 * k] = LoadShort(lump + Record::y);
+		xya [2 + 3 * k] = LoadUnsignedShort(lump + Record::angle) * byte_angle_to_rad;
+		lump += Record::size;
+	}
+}
+
+template <typename Record>
+static void ScalarLinedefsToIndices (const char* lump, int count, int* indices) {
+	for(int k = 0; k < count; k++) {
+		indices [0 + 2 * k] = LoadUnsignedShort(lump + Record::v1);
+		indices [1 + 2 * k] = LoadUnsignedShort(lump + Record::v2);
+		lump += Record::size;
+	}
+}
+
+#ifdef LUMP_KERNELS_X86
+
+static int LoadInt (const char* p) {
+	int v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// The SIMD kernels load x and y of a thing as one 32 bit word and the angle as another, and the
+// two vertex indices of a linedef as one word. Those words have to lie inside the record.
+template <typename Record>
+static constexpr bool IsThingLayoutPacked () {
+	return Record::y == Record::x + 2 && Record::x + 4 <= Record::size && Record::angle + 4 <= Record::size;
+}
+
+template <typename Record>
+static constexpr bool IsLinedefLayoutPacked () {
+	return Record::v2 == Record::v1 + 2 && Record::v1 + 4 <= Record::size;
+}
+
+// Write four x, y, angle triplets. The transposed rows are stored overlapping, which writes one
+// float past the last triplet, so callers must leave room for it.
+static void StoreTriplets (float* out, __m128 x, __m128 y, __m128 a) {
+	__m128 w = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(x, y, a, w);
+	_mm_storeu_ps(out + 0, x);
+	_mm_storeu_ps(out + 3, y);
+	_mm_storeu_ps(out + 6, a);
+	_mm_storeu_ps(out + 9, w);
+}
+
+// SSE2. Vertices are a plain stream of shorts, widened eight at a time.
+static void Sse2VertexesToFloat (const char* lump, int count, float* xy) {
+	int short_count = 2 * count;
+	int k = 0;
+	
+	for(; k + 8 <= short_count; k += 8) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast <const __m128i*> (lump + 2 * k));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		_mm_storeu_ps(xy + k + 0, _mm_cvtepi32_ps(lo));
+		_mm_storeu_ps(xy + k + 4, _mm_cvtepi32_ps(hi));
+	}
+	
+	ScalarVertexesToFloat(lump + 2 * k, (short_count - k) / 2, xy + k);
+}
+
+// SSE2 has no gather, the position and angle words of four records are loaded one by one and
+// all the widening and the angle conversion happen four at a time.
+template <typename Record>
+static void Sse2ThingsToFloat (const char* lump, int count, float* xya) {
+	static_assert(IsThingLayoutPacked <Record> ());
+	constexpr int s = Record::size;
+	const __m128 angle_f = _mm_set1_ps(byte_angle_to_rad);
+	const __m128i low_mask = _mm_set1_epi32(0xFFFF);
+	int k = 0;
+	
+	for(; k + 4 < count; k += 4) {
+		const char* p = lump + s * k + Record::x;
+		const char* q = lump + s * k + Record::angle;
+		__m128i xy = _mm_setr_epi32(LoadInt(p), LoadInt(p + s), LoadInt(p + 2 * s), LoadInt(p + 3 * s));
+		__m128i at = _mm_setr_epi32(LoadInt(q), LoadInt(q + s), LoadInt(q + 2 * s), LoadInt(q + 3 * s));
+		
+		__m128 x = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(xy, 16), 16));
+		__m128 y = _mm_cvtepi32_ps(_mm_srai_epi32(xy, 16));
+		__m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(at, low_mask)), angle_f);
+		StoreTriplets(xya + 3 * k, x, y, a);
+	}
+	
+	ScalarThingsToFloat <Record> (lump + s * k, count - k, xya + 3 * k);
+}
+
+// The two vertex indices of a linedef are one 32 bit word. Zero extending the shorts of four of
+// those words gives the index pairs in order.
+template <typename Record>
+static void Sse2LinedefsToIndices (const char* lump, int count, int* indices) {
+	static_assert(IsLinedefLayoutPacked <Record> ());
+	constexpr int s = Record::size;
+	const __m128i zero = _mm_setzero_si128();
+	int k = 0;
+	
+	for(; k + 4 <= count; k += 4) {
+		const char* p = lump + s * k + Record::v1;
+		__m128i v = _mm_setr_epi32(LoadInt(p), LoadInt(p + s), LoadInt(p + 2 * s), LoadInt(p + 3 * s));
+		_mm_storeu_si128(reinterpret_cast <__m128i*> (indices + 2 * k + 0), _mm_unpacklo_epi16(v, zero));
+		_mm_storeu_si128(reinterpret_cast <__m128i*> (indices + 2 * k + 4), _mm_unpackhi_epi16(v, zero));
+	}
+	
+	ScalarLinedefsToIndices <Record> (lump + s * k, count - k, indices + 2 * k);
+}
+
+// AVX2 kernels. Records of things and linedefs are fetched with gathers, eight at a time.
+LUMP_KERNELS_AVX2 static void Avx2VertexesToFloat (const char* lump, int count, float* xy) {
+	int short_count = 2 * count;
+	int k = 0;
+	
+	for(; k + 16 <= short_count; k += 16) {
+		__m128i lo = _mm_loadu_si128(reinterpret_cast <const __m128i*> (lump + 2 * k + 0));
+		__m128i hi = _mm_loadu_si128(reinterpret_cast <const __m128i*> (lump + 2 * k + 16));
+		_mm256_storeu_ps(xy + k + 0, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(lo)));
+		_mm256_storeu_ps(xy + k + 8, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(hi)));
+	}
+	
+	ScalarVertexesToFloat(lump + 2 * k, (short_count - k) / 2, xy + k);
+}
+
+template <typename Record>
+LUMP_KERNELS_AVX2 static void Avx2ThingsToFloat (const char* lump, int count, float* xya) {
+	static_assert(IsThingLayoutPacked <Record> ());
+	constexpr int s = Record::size;
+	const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+	const __m256 angle_f = _mm256_set1_ps(byte_angle_to_rad);
+	const __m256i low_mask = _mm256_set1_epi32(0xFFFF);
+	int k = 0;
+	
+	for(; k + 8 < count; k += 8) {
+		const char* p = lump + s * k;
+		__m256i xy = _mm256_i32gather_epi32(reinterpret_cast <const int*> (p + Record::x), offsets, 1);
+		__m256i at = _mm256_i32gather_epi32(reinterpret_cast <const int*> (p + Record::angle), offsets, 1);
+		
+		__m256 x = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(xy, 16), 16));
+		__m256 y = _mm256_cvtepi32_ps(_mm256_srai_epi32(xy, 16));
+		__m256 a = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(at, low_mask)), angle_f);
+		
+		StoreTriplets(xya + 3 * k + 0, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(a));
+		StoreTriplets(xya + 3 * k + 12, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(a, 1));
+	}
+	
+	ScalarThingsToFloat <Record> (lump + s * k, count - k, xya + 3 * k);
+}
+
+template <typename Record>
+LUMP_KERNELS_AVX2 static void Avx2LinedefsToIndices (const char* lump, int count, int* indices) {
+	static_assert(IsLinedefLayoutPacked <Record> ());
+	constexpr int s = Record::size;
+	const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+	int k = 0;
+	
+	for(; k + 8 <= count; k += 8) {
+		const char* p = lump + s * k + Record::v1;
+		__m256i v = _mm256_i32gather_epi32(reinterpret_cast <const int*> (p), offsets, 1);
+		_mm256_storeu_si256(reinterpret_cast <__m256i*> (indices + 2 * k + 0), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+		_mm256_storeu_si256(reinterpret_cast <__m256i*> (indices + 2 * k + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+	}
+	
+	ScalarLinedefsToIndices <Record> (lump + s * k, count - k, indices + 2 * k);
+}
+
+#endif
+
+bool CpuHasAvx2 () {
+	#if defined(LUMP_KERNELS_X86) && defined(_MSC_VER)
+		int info [4];
+		__cpuid(info, 0);
+		
+		if(info [0] < 7) {
+			return false;
+		}
+		
+		// AVX2 needs the instructions and the operating system saving the ymm registers.
+		__cpuid(info, 1);
+		bool has_os_ymm = (info [2] & (1 << 27)) && (info [2] & (1 << 28)) && 6 == (_xgetbv(0) & 6);
+		__cpuidex(info, 7, 0);
+		return has_os_ymm && (info [1] & (1 << 5));
+	#elif defined(LUMP_KERNELS_X86)
+		return __builtin_cpu_supports("avx2");
+	#else
+		return false;
+	#endif
+}
+
+const LumpKernels* ScalarLumpKernels () {
+	static const LumpKernels kernels = {
+		ScalarVertexesToFloat,
+		{ ScalarThingsToFloat <DoomThingRecord>, ScalarThingsToFloat <HexenThingRecord> },
+		{ ScalarLinedefsToIndices <DoomLinedefRecord>, ScalarLinedefsToIndices <HexenLinedefRecord> },
+		"scalar"
+	};
+	
+	return &kernels;
+}
+
+const LumpKernels* Sse2LumpKernels () {
+	#ifdef LUMP_KERNELS_X86
+		static const LumpKernels kernels = {
+			Sse2VertexesToFloat,
+			{ Sse2ThingsToFloat <DoomThingRecord>, Sse2ThingsToFloat <HexenThingRecord> },
+			{ Sse2LinedefsToIndices <DoomLinedefRecord>, Sse2LinedefsToIndices <HexenLinedefRecord> },
+			"sse2"
+		};
+		
+		return &kernels;
+	#else
+		return nullptr;
+	#endif
+}
+
+const LumpKernels* Avx2LumpKernels () {
+	#ifdef LUMP_KERNELS_X86
+		static const LumpKernels kernels = {
+			Avx2VertexesToFloat,
+			{ Avx2ThingsToFloat <DoomThingRecord>, Avx2ThingsToFloat <HexenThingRecord> },
+			{ Avx2LinedefsToIndices <DoomLinedefRecord>, Avx2LinedefsToIndices <HexenLinedefRecord> },
+			"avx2"
+		};
+		
+		static const bool is_supported = CpuHasAvx2();
+		return is_supported ? &kernels : nullptr;
+	#else
+		return nullptr;
+	#endif
+}
+
+const LumpKernels& BestLumpKernels () {
+	static const LumpKernels* best =
+		Avx2LumpKernels() ? Avx2LumpKernels() :
+		Sse2LumpKernels() ? Sse2LumpKernels() :
+		ScalarLumpKernels();
+	
+	return *best;
+}
@@ -0,0 +1,35 @@
+#ifndef LUMP_KERNELS_H
+#define LUMP_KERNELS_H
+
+#include "map_records.h"
+
+// Whole lump conversions from DOOM map records into the arrays the renderer draws from. There is
+// a scalar version of each and SSE2 and AVX2 versions on x86, picked at run time for the CPU the
+// program runs on. Counts are in records and the lumps need no particular alignment. Things and
+// linedefs have one kernel per binary map format, indexed by MapFormat.
+struct LumpKernels {
+	
+	// VERTEXES records into x, y float pairs.
+	void (*vertexes_to_float) (const char* lump, int count, float* xy);
+	
+	// THINGS records into x, y, angle in radians float triplets.
+	void (*things_to_float [binary_map_format_count]) (const char* lump, int count, float* xya);
+	
+	// LINEDEFS records into pairs of vertex indices.
+	void (*linedefs_to_indices [binary_map_format_count]) (const char* lump, int count, int* indices);
+	
+	const char* name;
+};
+
+// The kernels for an instruction set, or null when the CPU does not have it.
+const LumpKernels* ScalarLumpKernels ();
+const LumpKernels* Sse2LumpKernels ();
+const LumpKernels* Avx2LumpKernels ();
+
+// The fastest kernels the CPU supports.
+const LumpKernels& BestLumpKernels ();
+
+// Whether the CPU has AVX2 and the operating system saves its registers, always false off x86.
+bool CpuHasAvx2 ();
+
+#endif
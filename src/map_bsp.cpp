@@ -0,0 +1,388 @@
+#include "map_bsp.h"
+#include "inflate.h"
+#include <cstring>
+
+// Records in order with every read checked against the end of the data. Reading past the end
+// returns zero and marks the data invalid.
+struct BspReader {
+	BspReader (const char* data, std::size_t size) {
+		this->data = data;
+		this->size = size;
+		pos = 0;
+		is_valid = true;
+	}
+	
+	template <typename T>
+	T Read () {
+		T value = 0;
+		
+		if(size - pos < sizeof(T)) {
+			is_valid = false;
+			pos = size;
+			return value;
+		}
+		
+		std::memcpy(&value, data + pos, sizeof(T));
+		pos += sizeof(T);
+		return value;
+	}
+	
+	// Whether count records of record_size bytes are left. Counts come from the data, so they
+	// are checked before anything is sized by them.
+	bool HasRecords (std::uint32_t count, std::size_t record_size) {
+		if((size - pos) / record_size < count) {
+			is_valid = false;
+		}
+		
+		return is_valid;
+	}
+	
+	const char* data;
+	std::size_t size;
+	std::size_t pos;
+	bool is_valid;
+};
+
+// DeePBSP and extended nodes share one 32 byte record with 32 bit children. Boxes are stored
+// as top, bottom, left, right.
+static void ReadNodes32 (BspReader& reader, std::uint32_t count, std::vector <MapBsp::Node>& nodes) {
+	nodes.resize(count);
+	
+	for(auto& node : nodes) {
+		node.x = reader.Read <std::int16_t> ();
+		node.y = reader.Read <std::int16_t> ();
+		node.dx = reader.Read <std::int16_t> ();
+		node.dy = reader.Read <std::int16_t> ();
+		
+		for(int c = 0; c < 2; c++) {
+			float top = reader.Read <std::int16_t> ();
+			float bottom = reader.Read <std::int16_t> ();
+			float left = reader.Read <std::int16_t> ();
+			float right = reader.Read <std::int16_t> ();
+			node.boxes [c][0] = left;
+			node.boxes [c][1] = bottom;
+			node.boxes [c][2] = right;
+			node.boxes [c][3] = top;
+		}
+		
+		node.children [0] = reader.Read <std::uint32_t> ();
+		node.children [1] = reader.Read <std::uint32_t> ();
+	}
+}
+
+static bool IsBoxOverlapping (const float* a, const float* b) {
+	return a [0] <= b [2] && b [0] <= a [2] && a [1] <= b [3] && b [1] <= a [3];
+}
+
+// Nodes lumps of the other formats start with a signature.
+static MapBsp::Format NodesFormat (const char* data, int size) {
+	if(8 <= size && 0 == std::memcmp(data, "xNd4\0\0\0\0", 8)) {
+		return MapBsp::deep_nodes;
+	}
+	
+	else if(4 <= size && 0 == std::memcmp(data, "XNOD", 4)) {
+		return MapBsp::extended_nodes;
+	}
+	
+	else if(4 <= size && 0 == std::memcmp(data, "ZNOD", 4)) {
+		return MapBsp::compressed_nodes;
+	}
+	
+	return MapBsp::vanilla_nodes;
+}
+
+bool MapBsp::IsVanillaNodesLump (const char* data, int size) {
+	return vanilla_nodes == NodesFormat(data, size);
+}
+
+MapBsp::MapBsp () {
+	format = no_nodes;
+}
+
+void MapBsp::Clear () {
+	*this = MapBsp();
+}
+
+bool MapBsp::Decode (const DoomWad& wad, int map_index, const DoomMap& map) {
+	static const std::uint64_t nodes_key = DoomWad::LumpKey("NODES");
+	static const std::uint64_t ssectors_key = DoomWad::LumpKey("SSECTORS");
+	static const std::uint64_t segs_key = DoomWad::LumpKey("SEGS");
+	static const std::uint64_t znodes_key = DoomWad::LumpKey("ZNODES");
+	
+	Clear();
+	
+	if(map_index < 0 || wad.maps.size() <= map_index) {
+		return false;
+	}
+	
+	auto find_lump = [&] (std::uint64_t key) {
+		int lump_index = wad.FindMapLump(map_index, key);
+		
+		if(lump_index < 0 || !wad.IsLumpValid(wad.Lump(lump_index))) {
+			return BspReader(nullptr, 0);
+		}
+		
+		const auto& lump = wad.Lump(lump_index);
+		return BspReader(wad.LumpData(lump), lump.size);
+	};
+	
+	// UDMF maps keep extended nodes in ZNODES.
+	auto nodes_lump = find_lump(nodes_key);
+	
+	if(!nodes_lump.data) {
+		nodes_lump = find_lump(znodes_key);
+	}
+	auto lump_format = NodesFormat(nodes_lump.data, nodes_lump.size);
+	bool is_valid = true;
+	
+	vertex_x = map.vertex_x;
+	vertex_y = map.vertex_y;
+	
+	if(vanilla_nodes == lump_format) {
+		nodes.resize(map.NodeCount());
+		
+		for(int n = 0; n < map.NodeCount(); n++) {
+			auto& node = nodes [n];
+			node.x = map.node_x [n];
+			node.y = map.node_y [n];
+			node.dx = map.node_dx [n];
+			node.dy = map.node_dy [n];
+			
+			for(int c = 0; c < 2; c++) {
+				const float* box = map.node_boxes.data() + 8 * n + 4 * c;
+				node.boxes [c][0] = box [2];
+				node.boxes [c][1] = box [1];
+				node.boxes [c][2] = box [3];
+				node.boxes [c][3] = box [0];
+			}
+			
+			node.children [0] = map.node_right [n];
+			node.children [1] = map.node_left [n];
+		}
+		
+		subsector_first_seg = map.subsector_first_seg;
+		subsector_seg_count = map.subsector_seg_count;
+		seg_v1 = map.seg_v1;
+		seg_v2 = map.seg_v2;
+		seg_linedef = map.seg_linedef;
+		seg_side = map.seg_side;
+	}
+	
+	// DeePBSP widens every index to 32 bits and keeps the three lumps.
+	else if(deep_nodes == lump_format) {
+		nodes_lump.pos = 8;
+		ReadNodes32(nodes_lump, (nodes_lump.size - 8) / 32, nodes);
+		
+		auto subsectors_lump = find_lump(ssectors_key);
+		int subsector_count = subsectors_lump.size / 6;
+		subsector_seg_count.resize(subsector_count);
+		subsector_first_seg.resize(subsector_count);
+		
+		for(int s = 0; s < subsector_count; s++) {
+			subsector_seg_count [s] = subsectors_lump.Read <std::uint16_t> ();
+			subsector_first_seg [s] = subsectors_lump.Read <std::uint32_t> ();
+		}
+		
+		auto segs_lump = find_lump(segs_key);
+		int seg_count = segs_lump.size / 16;
+		seg_v1.resize(seg_count);
+		seg_v2.resize(seg_count);
+		seg_linedef.resize(seg_count);
+		seg_side.resize(seg_count);
+		
+		for(int s = 0; s < seg_count; s++) {
+			seg_v1 [s] = segs_lump.Read <std::uint32_t> ();
+			seg_v2 [s] = segs_lump.Read <std::uint32_t> ();
+			segs_lump.Read <std::uint16_t> ();
+			auto linedef = segs_lump.Read <std::uint16_t> ();
+			seg_linedef [s] = 0xFFFF == linedef ? DoomMap::no_index : linedef;
+			seg_side [s] = 0 != segs_lump.Read <std::uint16_t> ();
+			segs_lump.Read <std::uint16_t> ();
+		}
+	}
+	
+	// ZDoom extended nodes hold everything in the nodes lump, including the vertices the node
+	// builder added. Compressed nodes are the same after the signature, zlib compressed.
+	else {
+		std::vector <char> inflated;
+		BspReader reader(nodes_lump.data + 4, nodes_lump.size - 4);
+		
+		if(compressed_nodes == lump_format) {
+			is_valid = InflateZlib(reader.data, reader.size, inflated);
+			reader = BspReader(inflated.data(), inflated.size());
+		}
+		
+		auto original_count = reader.Read <std::uint32_t> ();
+		auto added_count = reader.Read <std::uint32_t> ();
+		
+		if(map.vertex_x.size() < original_count || !reader.HasRecords(added_count, 8)) {
+			is_valid = false;
+			added_count = 0;
+		}
+		
+		// Added vertices are 16.16 fixed point.
+		else {
+			vertex_x.resize(original_count + added_count);
+			vertex_y.resize(original_count + added_count);
+			
+			for(std::uint32_t v = original_count; v < original_count + added_count; v++) {
+				vertex_x [v] = reader.Read <std::int32_t> () / 65536.0f;
+				vertex_y [v] = reader.Read <std::int32_t> () / 65536.0f;
+			}
+		}
+		
+		// Subsectors only store their seg count, their segs follow each other.
+		auto subsector_count = reader.Read <std::uint32_t> ();
+		
+		if(reader.HasRecords(subsector_count, 4)) {
+			subsector_seg_count.resize(subsector_count);
+			subsector_first_seg.resize(subsector_count);
+			std::uint32_t first_seg = 0;
+			
+			for(std::uint32_t s = 0; s < subsector_count; s++) {
+				subsector_first_seg [s] = first_seg;
+				subsector_seg_count [s] = reader.Read <std::uint32_t> ();
+				first_seg += subsector_seg_count [s];
+			}
+		}
+		
+		auto seg_count = reader.Read <std::uint32_t> ();
+		
+		if(reader.HasRecords(seg_count, 11)) {
+			seg_v1.resize(seg_count);
+			seg_v2.resize(seg_count);
+			seg_linedef.resize(seg_count);
+			seg_side.resize(seg_count);
+			
+			for(std::uint32_t s = 0; s < seg_count; s++) {
+				seg_v1 [s] = reader.Read <std::uint32_t> ();
+				seg_v2 [s] = reader.Read <std::uint32_t> ();
+				auto linedef = reader.Read <std::uint16_t> ();
+				seg_linedef [s] = 0xFFFF == linedef ? DoomMap::no_index : linedef;
+				seg_side [s] = reader.Read <std::uint8_t> ();
+			}
+		}
+		
+		auto node_count = reader.Read <std::uint32_t> ();
+		
+		if(reader.HasRecords(node_count, 32)) {
+			ReadNodes32(reader, node_count, nodes);
+		}
+		
+		is_valid = is_valid && reader.is_valid;
+	}
+	
+	format = lump_format;
+	
+	// Broken references become missing ones, so queries only check for no_index.
+	for(int n = 0; n < NodeCount(); n++) {
+		for(auto& child : nodes [n].children) {
+			bool is_subsector = 0 != (child & DoomMap::subsector_child);
+			std::uint32_t index = child & ~DoomMap::subsector_child;
+			
+			if(is_subsector ? SubsectorCount() <= index : n <= index) {
+				child = DoomMap::no_index;
+			}
+		}
+	}
+	
+	for(int s = 0; s < SubsectorCount(); s++) {
+		if(SegCount() < subsector_first_seg [s] || SegCount() - subsector_first_seg [s] < subsector_seg_count [s]) {
+			subsector_first_seg [s] = 0;
+			subsector_seg_count [s] = 0;
+		}
+	}
+	
+	if(!is_valid || 0 == SubsectorCount()) {
+		Clear();
+		return false;
+	}
+	
+	return true;
+}
+
+int MapBsp::NodeCount () const {
+	return nodes.size();
+}
+
+int MapBsp::SubsectorCount () const {
+	return subsector_first_seg.size();
+}
+
+int MapBsp::SegCount () const {
+	return seg_v1.size();
+}
+
+std::uint32_t MapBsp::Root () const {
+	if(!nodes.empty()) {
+		return nodes.size() - 1;
+	}
+	
+	return 0 < SubsectorCount() ? DoomMap::subsector_child : DoomMap::no_index;
+}
+
+// The same test as the DOOM renderer, points on the line are on the left.
+int MapBsp::PointSide (int node, float x, float y) const {
+	const auto& n = nodes [node];
+	return (y - n.y) * n.dx < n.dy * (x - n.x) ? 0 : 1;
+}
+
+int MapBsp::SubsectorAt (float x, float y) const {
+	auto child = Root();
+	
+	while(0 == (child & DoomMap::subsector_child)) {
+		child = nodes [child].children [PointSide(child, x, y)];
+	}
+	
+	return DoomMap::no_index == child ? -1 : child & ~DoomMap::subsector_child;
+}
+
+void MapBsp::FrontToBack (float x, float y, std::vector <int>& order) const {
+	FrontToBackInBox(x, y, nullptr, order);
+}
+
+// Depth first with the far child pushed first, so the whole near side comes out before it.
+void MapBsp::FrontToBackInBox (float x, float y, const float* box, std::vector <int>& order) const {
+	order.clear();
+	std::vector <std::uint32_t> stack;
+	stack.push_back(Root());
+	
+	while(!stack.empty()) {
+		auto child = stack.back();
+		stack.pop_back();
+		
+		if(DoomMap::no_index == child) {
+			continue;
+		}
+		
+		else if(0 != (child & DoomMap::subsector_child)) {
+			order.push_back(child & ~DoomMap::subsector_child);
+			continue;
+		}
+		
+		const auto& node = nodes [child];
+		int side = PointSide(child, x, y);
+		
+		for(int c : { 1 - side, side }) {
+			if(!box || IsBoxOverlapping(node.boxes [c], box)) {
+				stack.push_back(node.children [c]);
+			}
+		}
+	}
+}
+
+std::uint32_t MapBsp::SubsectorSector (const DoomMap& map, int subsector) const {
+	if(subsector < 0 || SubsectorCount() <= subsector || 0 == subsector_seg_count [subsector]) {
+		return DoomMap::no_index;
+	}
+	
+	auto seg = subsector_first_seg [subsector];
+	auto linedef = seg_linedef [seg];
+	
+	if(map.LinedefCount() <= linedef) {
+		return DoomMap::no_index;
+	}
+	
+	auto side = 0 != seg_side [seg] ? map.linedef_back [linedef] : map.linedef_front [linedef];
+	return side < map.sidedef_sector.size() ? map.sidedef_sector [side] : DoomMap::no_index;
+}
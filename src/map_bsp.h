@@ -0,0 +1,83 @@
+#ifndef MAP_BSP_H
+#define MAP_BSP_H
+
+#include <cstdint>
+#include <vector>
+#include "wad_file.h"
+#include "doom_map.h"
+
+// The BSP tree a node builder stored with a map, as a spatial index that comes for free. Vanilla
+// nodes, DeePBSP nodes and ZDoom extended nodes, plain (XNOD) or compressed (ZNOD), all decode
+// into the same arrays. A node is one record holding everything a traversal reads, so walking
+// the tree touches one cache line per node. Queries are read only and safe from several threads.
+struct MapBsp {
+	enum Format {
+		no_nodes,
+		vanilla_nodes,
+		deep_nodes,
+		extended_nodes,
+		compressed_nodes
+	};
+	
+	// Partition line from x, y along dx, dy. Child 0 is on the right (front) side of the line,
+	// child 1 on the left (back) side, and boxes holds min x, min y, max x, max y of each. Child
+	// indices with DoomMap::subsector_child set are subsectors, no_index marks a broken child.
+	struct Node {
+		float x;
+		float y;
+		float dx;
+		float dy;
+		float boxes [2][4];
+		std::uint32_t children [2];
+	};
+	
+	MapBsp ();
+	
+	void Clear ();
+	
+	// Vanilla nodes come from the arrays the map decoded, the other formats from the lumps.
+	// Returns false when the map has no nodes or they do not decode. Child nodes always come
+	// before their parent, children that do not are dropped so a broken tree has no cycles.
+	bool Decode (const DoomWad& wad, int map_index, const DoomMap& map);
+	
+	// Whether a NODES lump holds vanilla records rather than one of the signed formats.
+	static bool IsVanillaNodesLump (const char* data, int size);
+	
+	int NodeCount () const;
+	int SubsectorCount () const;
+	int SegCount () const;
+	
+	// The root as a child index, a lone subsector for maps without nodes.
+	std::uint32_t Root () const;
+	
+	// 0 when the point is on the right (front) side of the node's partition line, 1 when left.
+	int PointSide (int node, float x, float y) const;
+	
+	// The subsector containing a point, or -1.
+	int SubsectorAt (float x, float y) const;
+	
+	// Subsectors ordered front to back as seen from a point. The box variant only visits
+	// subtrees whose bounding box overlaps min x, min y, max x, max y.
+	void FrontToBack (float x, float y, std::vector <int>& order) const;
+	void FrontToBackInBox (float x, float y, const float* box, std::vector <int>& order) const;
+	
+	// Sector of a subsector through the side of its first seg, or no_index.
+	std::uint32_t SubsectorSector (const DoomMap& map, int subsector) const;
+	
+	Format format;
+	std::vector <Node> nodes;
+	
+	std::vector <std::uint32_t> subsector_first_seg;
+	std::vector <std::uint32_t> subsector_seg_count;
+	
+	std::vector <std::uint32_t> seg_v1;
+	std::vector <std::uint32_t> seg_v2;
+	std::vector <std::uint32_t> seg_linedef;
+	std::vector <std::uint8_t> seg_side;
+	
+	// The map vertices followed by the ones the node builder added, segs index into these.
+	std::vector <float> vertex_x;
+	std::vector <float> vertex_y;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#include "map_cache.h"
+#include "hash_helper.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+// An entry is this header followed by the byte size of every array, then the arrays, each
+// starting on a 16 byte boundary of the file. The vertex, index and thing arrays come first, then
+// the map model in the order of VisitModelArrays.
+struct MapCacheHeader {
+	char magic [4];
+	std::uint32_t version;
+	std::uint64_t key;
+	std::uint64_t array_count;
+	std::uint64_t file_size;
+	
+	// The parts of the map model that are not arrays.
+	std::uint64_t map_name_key;
+	std::int32_t map_format;
+	std::int32_t bsp_format;
+	float grid_origin_x;
+	float grid_origin_y;
+	float grid_cell_size;
+	std::int32_t grid_column_count;
+	std::int32_t grid_row_count;
+	std::int32_t open_side_count;
+};
+
+static constexpr char map_cache_magic [4] = { 'W', 'M', 'P', 'C' };
+static constexpr std::uint32_t map_cache_version = 5;
+static constexpr std::size_t map_cache_alignment = 16;
+static constexpr std::size_t map_cache_view_count = 3;
+static constexpr const char* map_cache_extension = ".mapc";
+
+static std::size_t AlignCacheOffset (std::size_t offset) {
+	return (offset + map_cache_alignment - 1) / map_cache_alignment * map_cache_alignment;
+}
+
+// Every array DecodeMapModel fills, in entry order. All of them hold plain values, so they go
+// to the entry and back as bytes.
+template <typename Package, typename Visit>
+static void VisitModelArrays (Package& package, Visit visit) {
+	auto& map = package.map;
+	visit(map.vertex_x);
+	visit(map.vertex_y);
+	visit(map.linedef_v1);
+	visit(map.linedef_v2);
+	visit(map.linedef_flags);
+	visit(map.linedef_special);
+	visit(map.linedef_tag);
+	visit(map.linedef_front);
+	visit(map.linedef_back);
+	visit(map.linedef_args);
+	visit(map.sidedef_x_offset);
+	visit(map.sidedef_y_offset);
+	visit(map.sidedef_upper);
+	visit(map.sidedef_lower);
+	visit(map.sidedef_middle);
+	visit(map.sidedef_sector);
+	visit(map.sector_floor_height);
+	visit(map.sector_ceiling_height);
+	visit(map.sector_floor_flat);
+	visit(map.sector_ceiling_flat);
+	visit(map.sector_light);
+	visit(map.sector_special);
+	visit(map.sector_tag);
+	visit(map.thing_x);
+	visit(map.thing_y);
+	visit(map.thing_angle);
+	visit(map.thing_type);
+	visit(map.thing_flags);
+	visit(map.thing_z);
+	visit(map.thing_tid);
+	visit(map.thing_special);
+	visit(map.thing_args);
+	visit(map.seg_v1);
+	visit(map.seg_v2);
+	visit(map.seg_angle);
+	visit(map.seg_linedef);
+	visit(map.seg_side);
+	visit(map.seg_offset);
+	visit(map.subsector_seg_count);
+	visit(map.subsector_first_seg);
+	visit(map.node_x);
+	visit(map.node_y);
+	visit(map.node_dx);
+	visit(map.node_dy);
+	visit(map.node_boxes);
+	visit(map.node_right);
+	visit(map.node_left);
+	visit(map.reject);
+	visit(map.blockmap);
+	
+	auto& bsp = package.bsp;
+	visit(bsp.nodes);
+	visit(bsp.subsector_first_seg);
+	visit(bsp.subsector_seg_count);
+	visit(bsp.seg_v1);
+	visit(bsp.seg_v2);
+	visit(bsp.seg_linedef);
+	visit(bsp.seg_side);
+	visit(bsp.vertex_x);
+	visit(bsp.vertex_y);
+	
+	auto& grid = package.grid;
+	visit(grid.linedef_cells.cell_first);
+	visit(grid.linedef_cells.items);
+	visit(grid.vertex_cells.cell_first);
+	visit(grid.vertex_cells.items);
+	visit(grid.thing_cells.cell_first);
+	visit(grid.thing_cells.items);
+	
+	visit(package.tiles.tiles);
+	visit(package.tiles.indices);
+	visit(package.tiles.linedef_slot);
+	
+	auto& sectors = package.sector_mesh;
+	visit(sectors.vertices);
+	visit(sectors.vertex_sectors);
+	visit(sectors.indices);
+	visit(sectors.sector_first_index);
+	visit(sectors.sector_index_count);
+}
+
+// The byte size of every array of a package, in entry order.
+static std::vector <std::uint64_t> PackageArrayBytes (const MapPackage& package) {
+	std::vector <std::uint64_t> bytes = { package.vertex_view.size_bytes(), package.index_view.size_bytes(), package.thing_view.size_bytes() };
+	
+	VisitModelArrays(package, [&] (const auto& array) {
+		bytes.push_back(sizeof(array [0]) * array.size());
+	});
+	
+	return bytes;
+}
+
+// Offsets of the arrays in an entry, and the size of the whole entry.
+struct MapCacheLayout {
+	MapCacheLayout (const std::vector <std::uint64_t>& array_bytes) {
+		std::size_t offset = AlignCacheOffset(sizeof(MapCacheHeader) + sizeof(std::uint64_t) * array_bytes.size());
+		file_size = offset;
+		
+		for(auto bytes: array_bytes) {
+			offsets.push_back(offset);
+			file_size = offset + bytes;
+			offset = AlignCacheOffset(file_size);
+		}
+	}
+	
+	std::vector <std::size_t> offsets;
+	std::size_t file_size;
+};
+
+MapCache::MapCache () {
+	directory = "map_cache";
+	max_bytes = 256 << 20;
+	is_enabled = true;
+}
+
+std::uint64_t MapCache::MapKey (const DoomWad& wad, int map_index) {
+	const auto& map = wad.maps [map_index];
+	std::uint64_t key = HashBytes(&map_cache_version, sizeof(map_cache_version));
+	
+	for(int k = map.marker_lump; k < map.end_lump; k++) {
+		const auto& lump = wad.Lump(k);
+		std::uint64_t entry [2] = { wad.lump_keys [k], static_cast <std::uint64_t> (lump.size) };
+		key = HashBytes(entry, sizeof(entry), key);
+		
+		if(wad.IsLumpValid(lump)) {
+			key = HashBytes(wad.LumpData(lump), lump.size, key);
+		}
+	}
+	
+	return key;
+}
+
+std::string MapCache::EntryPath (std::uint64_t key) const {
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << key << map_cache_extension;
+	return (std::filesystem::path(directory) / ss.str()).string();
+}
+
+bool MapCache::Load (std::uint64_t key, MapPackage& package) {
+	if(!is_enabled) {
+		return false;
+	}
+	
+	auto path = EntryPath(key);
+	MappedFile entry;
+	
+	if(!entry.Open(path) || entry.size < sizeof(MapCacheHeader)) {
+		return false;
+	}
+	
+	MapCacheHeader header;
+	std::memcpy(&header, entry.data, sizeof(header));
+	
+	// The array count only changes with the format, a version that matches has the same arrays.
+	auto array_bytes = PackageArrayBytes(package);
+	std::size_t table_end = sizeof(MapCacheHeader) + sizeof(std::uint64_t) * array_bytes.size();
+	
+	if(
+	!std::equal(map_cache_magic, map_cache_magic + 4, header.magic) ||
+	map_cache_version != header.version ||
+	key != header.key ||
+	array_bytes.size() != header.array_count ||
+	entry.size < table_end) {
+		return false;
+	}
+	
+	std::memcpy(array_bytes.data(), entry.data + sizeof(MapCacheHeader), sizeof(std::uint64_t) * array_bytes.size());
+	
+	// Arrays larger than the entry would overflow the layout.
+	for(auto bytes: array_bytes) {
+		if(entry.size < bytes) {
+			return false;
+		}
+	}
+	
+	MapCacheLayout layout(array_bytes);
+	
+	if(layout.file_size != header.file_size || layout.file_size != entry.size) {
+		return false;
+	}
+	
+	// Every array has to hold whole elements before any of them is read.
+	std::size_t a = map_cache_view_count;
+	bool is_whole = 0 == array_bytes [0] % sizeof(float) && 0 == array_bytes [1] % sizeof(int) && 0 == array_bytes [2] % sizeof(float);
+	
+	VisitModelArrays(package, [&] (auto& array) {
+		is_whole = is_whole && 0 == array_bytes [a++] % sizeof(array [0]);
+	});
+	
+	if(!is_whole) {
+		return false;
+	}
+	
+	// Touching the entry makes it the most recently used one.
+	std::error_code error;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+	
+	package.vertices.clear();
+	package.indices.clear();
+	package.things.clear();
+	
+	// The arrays to draw stay in the mapping, the model is copied out into its own arrays.
+	package.vertex_view = { reinterpret_cast <const float*> (entry.data + layout.offsets [0]), array_bytes [0] / sizeof(float) };
+	package.index_view = { reinterpret_cast <const int*> (entry.data + layout.offsets [1]), array_bytes [1] / sizeof(int) };
+	package.thing_view = { reinterpret_cast <const float*> (entry.data + layout.offsets [2]), array_bytes [2] / sizeof(float) };
+	a = map_cache_view_count;
+	
+	VisitModelArrays(package, [&] (auto& array) {
+		array.resize(array_bytes [a] / sizeof(array [0]));
+		std::copy_n(entry.data + layout.offsets [a], array_bytes [a], reinterpret_cast <char*> (array.data()));
+		a++;
+	});
+	
+	package.map.name_key = header.map_name_key;
+	package.map.format = static_cast <MapFormat> (header.map_format);
+	package.bsp.format = static_cast <MapBsp::Format> (header.bsp_format);
+	package.grid.origin_x = header.grid_origin_x;
+	package.grid.origin_y = header.grid_origin_y;
+	package.grid.cell_size = header.grid_cell_size;
+	package.grid.column_count = header.grid_column_count;
+	package.grid.row_count = header.grid_row_count;
+	package.sector_mesh.open_side_count = header.open_side_count;
+	package.cache_entry = std::move(entry);
+	return true;
+}
+
+bool MapCache::Store (std::uint64_t key, const MapPackage& package) {
+	if(!is_enabled) {
+		return false;
+	}
+	
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	
+	auto array_bytes = PackageArrayBytes(package);
+	MapCacheLayout layout(array_bytes);
+	MapCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::copy(map_cache_magic, map_cache_magic + 4, header.magic);
+	header.version = map_cache_version;
+	header.key = key;
+	header.array_count = array_bytes.size();
+	header.file_size = layout.file_size;
+	header.map_name_key = package.map.name_key;
+	header.map_format = package.map.format;
+	header.bsp_format = package.bsp.format;
+	header.grid_origin_x = package.grid.origin_x;
+	header.grid_origin_y = package.grid.origin_y;
+	header.grid_cell_size = package.grid.cell_size;
+	header.grid_column_count = package.grid.column_count;
+	header.grid_row_count = package.grid.row_count;
+	header.open_side_count = package.sector_mesh.open_side_count;
+	
+	std::vector <char> file(layout.file_size, 0);
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::memcpy(file.data() + sizeof(header), array_bytes.data(), sizeof(std::uint64_t) * array_bytes.size());
+	std::copy(package.vertex_view.begin(), package.vertex_view.end(), reinterpret_cast <float*> (file.data() + layout.offsets [0]));
+	std::copy(package.index_view.begin(), package.index_view.end(), reinterpret_cast <int*> (file.data() + layout.offsets [1]));
+	std::copy(package.thing_view.begin(), package.thing_view.end(), reinterpret_cast <float*> (file.data() + layout.offsets [2]));
+	std::size_t a = map_cache_view_count;
+	
+	VisitModelArrays(package, [&] (const auto& array) {
+		std::copy_n(reinterpret_cast <const char*> (array.data()), array_bytes [a], file.data() + layout.offsets [a]);
+		a++;
+	});
+	
+	// Write to the side and rename, so nobody ever maps a half written entry.
+	auto path = EntryPath(key);
+	auto temp_path = UniqueTempPath(path);
+	
+	{
+		std::ofstream f(temp_path, std::ios::binary);
+		f.write(file.data(), file.size());
+		
+		if(!f.good()) {
+			std::filesystem::remove(temp_path, error);
+			return false;
+		}
+	}
+	
+	std::filesystem::rename(temp_path, path, error);
+	
+	if(error) {
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+	
+	Evict();
+	return true;
+}
+
+void MapCache::Evict () {
+	namespace fs = std::filesystem;
+	
+	struct CacheEntry {
+		fs::path path;
+		fs::file_time_type last_use;
+		std::uintmax_t size;
+	};
+	
+	std::vector <CacheEntry> entries;
+	std::uintmax_t total_size = 0;
+	std::error_code error;
+	
+	for(fs::directory_iterator it(directory, error), end; it != end; it.increment(error)) {
+		if(map_cache_extension != it->path().extension()) {
+			continue;
+		}
+		
+		CacheEntry entry = { it->path(), it->last_write_time(error), it->file_size(error) };
+		
+		if(!error) {
+			entries.push_back(entry);
+			total_size += entry.size;
+		}
+	}
+	
+	// Oldest first.
+	std::sort(entries.begin(), entries.end(), [] (const CacheEntry& a, const CacheEntry& b) {
+		return a.last_use < b.last_use;
+	});
+	
+	for(const auto& entry: entries) {
+		if(total_size <= max_bytes) {
+			break;
+		}
+		
+		if(fs::remove(entry.path, error)) {
+			total_size -= entry.size;
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef MAP_CACHE_H
+#define MAP_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include "wad_file.h"
+#include "wad_funcs.h"
+
+// Decoded map geometry kept on disk between runs. Entries are named by a hash of the map's
+// directory entries and lump bytes, so a map that changes in its wad gets a new key and the old
+// entry is never served again, it just ages out. Entries hold the arrays to draw exactly as they
+// are uploaded and the whole map model DecodeMapModel builds, the records, BSP tree, picking grid,
+// line tiles and sector triangles. A hit maps the entry and decodes nothing.
+struct MapCache {
+	MapCache ();
+	
+	static std::uint64_t MapKey (const DoomWad& wad, int map_index);
+	
+	// Fill the package views and model from a cached entry. The views point into the mapped entry,
+	// the model is copied out. Entries from another version of the format, or cut short, count as
+	// misses.
+	bool Load (std::uint64_t key, MapPackage& package);
+	bool Store (std::uint64_t key, const MapPackage& package);
+	
+	// Delete the least recently used entries until the cache fits into max_bytes.
+	void Evict ();
+	
+	std::string EntryPath (std::uint64_t key) const;
+	
+	std::string directory;
+	std::uint64_t max_bytes;
+	bool is_enabled;
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "map_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Bucket items into cells in two passes, counting then filling, so every cell ends up as one
+// contiguous run. for_each_cell (item, func) calls func with every cell the item touches.
+template <typename ForEachCell>
+static void FillCells (MapGrid::Cells& cells, int cell_count, int item_count, ForEachCell for_each_cell) {
+	cells.cell_first.assign(cell_count + 1, 0);
+	
+	for(int k = 0; k < item_count; k++) {
+		for_each_cell(k, [&] (int cell) { cells.cell_first [cell + 1]++; });
+	}
+	
+	for(int c = 0; c < cell_count; c++) {
+		cells.cell_first [c + 1] += cells.cell_first [c];
+	}
+	
+	std::vector <std::uint32_t> cell_fill(cells.cell_first.begin(), cells.cell_first.end() - 1);
+	cells.items.resize(cells.cell_first [cell_count]);
+	
+	for(int k = 0; k < item_count; k++) {
+		for_each_cell(k, [&] (int cell) { cells.items [cell_fill [cell]++] = k; });
+	}
+}
+
+static float PointDistanceSquared (float ax, float ay, float bx, float by) {
+	float dx = ax - bx;
+	float dy = ay - by;
+	return dx * dx + dy * dy;
+}
+
+// Visit the cells around a point in rings of growing size until no unvisited cell can hold
+// anything nearer than the best item found so far.
+template <typename DistanceSquared>
+static int NearestInCells (const MapGrid& grid, const MapGrid::Cells& cells, float x, float y, float max_distance, float* distance, DistanceSquared distance_squared) {
+	int best = -1;
+	float best_distance_squared = max_distance * max_distance;
+	
+	if(0 == grid.column_count || 0 == grid.row_count) {
+		return -1;
+	}
+	
+	int cx = std::clamp(static_cast <int> (std::floor((x - grid.origin_x) / grid.cell_size)), 0, grid.column_count - 1);
+	int cy = std::clamp(static_cast <int> (std::floor((y - grid.origin_y) / grid.cell_size)), 0, grid.row_count - 1);
+	
+	auto visit_cell = [&] (int i, int j) {
+		int cell = i + j * grid.column_count;
+		
+		for(auto k = cells.cell_first [cell]; k < cells.cell_first [cell + 1]; k++) {
+			int item = cells.items [k];
+			float d = distance_squared(item);
+			
+			if(d <= best_distance_squared && (d < best_distance_squared || best < 0 || item < best)) {
+				best = item;
+				best_distance_squared = d;
+			}
+		}
+	};
+	
+	for(int r = 0; ; r++) {
+		int j0 = std::max(0, cy - r);
+		int j1 = std::min(grid.row_count - 1, cy + r);
+		
+		for(int j = j0; j <= j1; j++) {
+			bool is_full_row = std::abs(j - cy) == r;
+			
+			for(int i = std::max(0, cx - r); i <= std::min(grid.column_count - 1, cx + r); i++) {
+				if(is_full_row || std::abs(i - cx) == r) {
+					visit_cell(i, j);
+				}
+				
+				// Inside rows only have their two end cells on the ring.
+				else if(i < cx + r) {
+					i = cx + r - 1;
+				}
+			}
+		}
+		
+		// Distance to the nearest side of the visited block that still has cells beyond it.
+		float bound = std::numeric_limits <float>::max();
+		
+		if(0 < cx - r) {
+			bound = std::min(bound, x - (grid.origin_x + (cx - r) * grid.cell_size));
+		}
+		
+		if(cx + r + 1 < grid.column_count) {
+			bound = std::min(bound, grid.origin_x + (cx + r + 1) * grid.cell_size - x);
+		}
+		
+		if(0 < cy - r) {
+			bound = std::min(bound, y - (grid.origin_y + (cy - r) * grid.cell_size));
+		}
+		
+		if(cy + r + 1 < grid.row_count) {
+			bound = std::min(bound, grid.origin_y + (cy + r + 1) * grid.cell_size - y);
+		}
+		
+		bound = std::max(0.0f, bound);
+		
+		if(std::numeric_limits <float>::max() == bound || max_distance < bound || best_distance_squared <= bound * bound) {
+			break;
+		}
+	}
+	
+	if(0 <= best && distance) {
+		*distance = std::sqrt(best_distance_squared);
+	}
+	
+	return best;
+}
+
+// Every item of the cells around a point within radius, sorted and without repeats.
+template <typename DistanceSquared>
+static void ItemsInRadius (const MapGrid& grid, const MapGrid::Cells& cells, float x, float y, float radius, std::vector <int>& found, DistanceSquared distance_squared) {
+	found.clear();
+	int x0, y0, x1, y1;
+	grid.CellRange(x - radius, y - radius, x + radius, y + radius, x0, y0, x1, y1);
+	
+	for(int j = y0; j <= y1; j++) {
+		for(int i = x0; i <= x1; i++) {
+			int cell = i + j * grid.column_count;
+			
+			for(auto k = cells.cell_first [cell]; k < cells.cell_first [cell + 1]; k++) {
+				if(distance_squared(cells.items [k]) <= radius * radius) {
+					found.push_back(cells.items [k]);
+				}
+			}
+		}
+	}
+	
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+}
+
+MapGrid::MapGrid () {
+	Clear();
+}
+
+void MapGrid::Clear () {
+	origin_x = 0;
+	origin_y = 0;
+	cell_size = 128;
+	column_count = 0;
+	row_count = 0;
+	linedef_cells = Cells();
+	vertex_cells = Cells();
+	thing_cells = Cells();
+}
+
+void MapGrid::Build (const DoomMap& map, float cell_size) {
+	Clear();
+	this->cell_size = cell_size;
+	
+	int vertex_count = map.VertexCount();
+	int thing_count = map.ThingCount();
+	
+	if(0 == vertex_count + thing_count) {
+		return;
+	}
+	
+	float min_x = std::numeric_limits <float>::max();
+	float min_y = min_x;
+	float max_x = std::numeric_limits <float>::lowest();
+	float max_y = max_x;
+	
+	for(int v = 0; v < vertex_count; v++) {
+		min_x = std::min(min_x, map.vertex_x [v]);
+		min_y = std::min(min_y, map.vertex_y [v]);
+		max_x = std::max(max_x, map.vertex_x [v]);
+		max_y = std::max(max_y, map.vertex_y [v]);
+	}
+	
+	for(int t = 0; t < thing_count; t++) {
+		min_x = std::min(min_x, map.thing_x [t]);
+		min_y = std::min(min_y, map.thing_y [t]);
+		max_x = std::max(max_x, map.thing_x [t]);
+		max_y = std::max(max_y, map.thing_y [t]);
+	}
+	
+	// Keep the cell count in check for maps with far flung vertices.
+	static constexpr float max_cell_count = 1 << 22;
+	
+	while(max_cell_count < ((max_x - min_x) / this->cell_size + 1) * ((max_y - min_y) / this->cell_size + 1)) {
+		this->cell_size *= 2;
+	}
+	
+	origin_x = min_x;
+	origin_y = min_y;
+	column_count = static_cast <int> ((max_x - min_x) / this->cell_size) + 1;
+	row_count = static_cast <int> ((max_y - min_y) / this->cell_size) + 1;
+	int cell_count = column_count * row_count;
+	
+	auto cell_of = [&] (float x, float y) {
+		int x0, y0, x1, y1;
+		CellRange(x, y, x, y, x0, y0, x1, y1);
+		return x0 + y0 * column_count;
+	};
+	
+	FillCells(vertex_cells, cell_count, vertex_count, [&] (int v, auto add) {
+		add(cell_of(map.vertex_x [v], map.vertex_y [v]));
+	});
+	
+	FillCells(thing_cells, cell_count, thing_count, [&] (int t, auto add) {
+		add(cell_of(map.thing_x [t], map.thing_y [t]));
+	});
+	
+	// A line goes into every cell of its bounding box it actually crosses. Lines with a missing
+	// vertex are left out.
+	FillCells(linedef_cells, cell_count, map.LinedefCount(), [&] (int l, auto add) {
+		auto v1 = map.linedef_v1 [l];
+		auto v2 = map.linedef_v2 [l];
+		
+		if(vertex_count <= v1 || vertex_count <= v2) {
+			return;
+		}
+		
+		float ax = map.vertex_x [v1];
+		float ay = map.vertex_y [v1];
+		float dx = map.vertex_x [v2] - ax;
+		float dy = map.vertex_y [v2] - ay;
+		
+		int x0, y0, x1, y1;
+		CellRange(std::min(ax, ax + dx), std::min(ay, ay + dy), std::max(ax, ax + dx), std::max(ay, ay + dy), x0, y0, x1, y1);
+		
+		for(int j = y0; j <= y1; j++) {
+			for(int i = x0; i <= x1; i++) {
+				
+				// The line misses the cell when all four corners lie strictly on one side of it.
+				float cell_x = origin_x + i * this->cell_size - ax;
+				float cell_y = origin_y + j * this->cell_size - ay;
+				float s = this->cell_size;
+				float c0 = dx * cell_y - dy * cell_x;
+				float c1 = dx * cell_y - dy * (cell_x + s);
+				float c2 = dx * (cell_y + s) - dy * cell_x;
+				float c3 = dx * (cell_y + s) - dy * (cell_x + s);
+				
+				bool is_missed =
+					(0 < c0 && 0 < c1 && 0 < c2 && 0 < c3) ||
+					(c0 < 0 && c1 < 0 && c2 < 0 && c3 < 0);
+				
+				if(!is_missed) {
+					add(i + j * column_count);
+				}
+			}
+		}
+	});
+}
+
+void MapGrid::CellRange (float min_x, float min_y, float max_x, float max_y, int& x0, int& y0, int& x1, int& y1) const {
+	auto cell = [&] (float p, float origin, int count) {
+		return std::clamp(static_cast <int> (std::floor((p - origin) / cell_size)), 0, std::max(0, count - 1));
+	};
+	
+	x0 = cell(min_x, origin_x, column_count);
+	y0 = cell(min_y, origin_y, row_count);
+	x1 = cell(max_x, origin_x, column_count);
+	y1 = cell(max_y, origin_y, row_count);
+	
+	// An empty grid has no cells to visit.
+	if(0 == column_count || 0 == row_count) {
+		x1 = x0 - 1;
+		y1 = y0 - 1;
+	}
+}
+
+float MapGrid::LinedefDistanceSquared (const DoomMap& map, int linedef, float x, float y) {
+	float ax = map.vertex_x [map.linedef_v1 [linedef]];
+	float ay = map.vertex_y [map.linedef_v1 [linedef]];
+	float bx = map.vertex_x [map.linedef_v2 [linedef]];
+	float by = map.vertex_y [map.linedef_v2 [linedef]];
+	
+	float dx = bx - ax;
+	float dy = by - ay;
+	float length_squared = dx * dx + dy * dy;
+	float t = 0 < length_squared ? std::clamp(((x - ax) * dx + (y - ay) * dy) / length_squared, 0.0f, 1.0f) : 0;
+	return PointDistanceSquared(x, y, ax + t * dx, ay + t * dy);
+}
+
+int MapGrid::NearestLinedef (const DoomMap& map, float x, float y, float max_distance, float* distance) const {
+	return NearestInCells(*this, linedef_cells, x, y, max_distance, distance, [&] (int l) {
+		return LinedefDistanceSquared(map, l, x, y);
+	});
+}
+
+int MapGrid::NearestVertex (const DoomMap& map, float x, float y, float max_distance, float* distance) const {
+	return NearestInCells(*this, vertex_cells, x, y, max_distance, distance, [&] (int v) {
+		return PointDistanceSquared(x, y, map.vertex_x [v], map.vertex_y [v]);
+	});
+}
+
+int MapGrid::NearestThing (const DoomMap& map, float x, float y, float max_distance, float* distance) const {
+	return NearestInCells(*this, thing_cells, x, y, max_distance, distance, [&] (int t) {
+		return PointDistanceSquared(x, y, map.thing_x [t], map.thing_y [t]);
+	});
+}
+
+void MapGrid::LinedefsInRadius (const DoomMap& map, float x, float y, float radius, std::vector <int>& found) const {
+	ItemsInRadius(*this, linedef_cells, x, y, radius, found, [&] (int l) {
+		return LinedefDistanceSquared(map, l, x, y);
+	});
+}
+
+void MapGrid::VerticesInRadius (const DoomMap& map, float x, float y, float radius, std::vector <int>& found) const {
+	ItemsInRadius(*this, vertex_cells, x, y, radius, found, [&] (int v) {
+		return PointDistanceSquared(x, y, map.vertex_x [v], map.vertex_y [v]);
+	});
+}
+
+void MapGrid::ThingsInRadius (const DoomMap& map, float x, float y, float radius, std::vector <int>& found) const {
+	ItemsInRadius(*this, thing_cells, x, y, radius, found, [&] (int t) {
+		return PointDistanceSquared(x, y, map.thing_x [t], map.thing_y [t]);
+	});
+}
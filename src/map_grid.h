@@ -0,0 +1,57 @@
+#ifndef MAP_GRID_H
+#define MAP_GRID_H
+
+#include <cstdint>
+#include <vector>
+#include "doom_map.h"
+
+// Uniform grid over the linedefs, vertices and things of a map, for picking and hit tests. Every
+// cell lists the items touching it, so a query only looks at the few cells around a point instead
+// of the whole map. The grid only holds indices, queries take the map it was built from. Built
+// once per map, queries are read only and safe from several threads.
+struct MapGrid {
+	
+	// Items of one kind bucketed by cell. The items of cell c are
+	// items [cell_first [c] .. cell_first [c + 1]).
+	struct Cells {
+		std::vector <std::uint32_t> cell_first;
+		std::vector <std::uint32_t> items;
+	};
+	
+	MapGrid ();
+	
+	void Clear ();
+	
+	// The default cell size is the one of the BLOCKMAP lump. The blockmap itself is not used, its
+	// 16 bit offsets overflow on the large maps where a grid matters most.
+	void Build (const DoomMap& map, float cell_size = 128);
+	
+	// Nearest item within max_distance of a point, or -1. The distance to it goes to distance
+	// when that is not null.
+	int NearestLinedef (const DoomMap& map, float x, float y, float max_distance, float* distance = nullptr) const;
+	int NearestVertex (const DoomMap& map, float x, float y, float max_distance, float* distance = nullptr) const;
+	int NearestThing (const DoomMap& map, float x, float y, float max_distance, float* distance = nullptr) const;
+	
+	// All items within radius of a point, in ascending index order.
+	void LinedefsInRadius (const DoomMap& map, float x, float y, float radius, std::vector <int>& found) const;
+	void VerticesInRadius (const DoomMap& map, float x, float y, float radius, std::vector <int>& found) const;
+	void ThingsInRadius (const DoomMap& map, float x, float y, float radius, std::vector <int>& found) const;
+	
+	// Squared distance from a point to a linedef.
+	static float LinedefDistanceSquared (const DoomMap& map, int linedef, float x, float y);
+	
+	// Cell range covering a box, clamped to the grid.
+	void CellRange (float min_x, float min_y, float max_x, float max_y, int& x0, int& y0, int& x1, int& y1) const;
+	
+	float origin_x;
+	float origin_y;
+	float cell_size;
+	int column_count;
+	int row_count;
+	
+	Cells linedef_cells;
+	Cells vertex_cells;
+	Cells thing_cells;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "map_raster.h"
+#include "lodepng.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+MapRaster::MapRaster () {
+	x_size = 0;
+	y_size = 0;
+	border = 8;
+	background_color	= Rgba(87, 8, 36);
+	line_color			= Rgba(255, 255, 255);
+	thing_color			= Rgba(255, 200, 0);
+}
+
+std::uint32_t MapRaster::Rgba (int r, int g, int b, int a) {
+	unsigned char bytes [4] = {
+		static_cast <unsigned char> (r),
+		static_cast <unsigned char> (g),
+		static_cast <unsigned char> (b),
+		static_cast <unsigned char> (a)
+	};
+	
+	std::uint32_t color;
+	std::memcpy(&color, bytes, sizeof(color));
+	return color;
+}
+
+void MapRaster::Resize (int new_x_size, int new_y_size) {
+	x_size = std::max(1, new_x_size);
+	y_size = std::max(1, new_y_size);
+	pixels.resize(x_size * y_size);
+}
+
+void MapRaster::Clear (std::uint32_t color) {
+	std::fill(pixels.begin(), pixels.end(), color);
+}
+
+// Bresenham, with every pixel checked against the image so lines may leave it.
+void MapRaster::DrawLine (int x0, int y0, int x1, int y1, std::uint32_t color) {
+	int dx = std::abs(x1 - x0);
+	int dy = -std::abs(y1 - y0);
+	int step_x = x0 < x1 ? 1 : -1;
+	int step_y = y0 < y1 ? 1 : -1;
+	int error = dx + dy;
+	
+	while(true) {
+		if(0 <= x0 && x0 < x_size && 0 <= y0 && y0 < y_size) {
+			pixels [x0 + y0 * x_size] = color;
+		}
+		
+		if(x0 == x1 && y0 == y1) {
+			break;
+		}
+		
+		int error_2 = error + error;
+		
+		if(dy <= error_2) {
+			error += dy;
+			x0 += step_x;
+		}
+		
+		if(error_2 <= dx) {
+			error += dx;
+			y0 += step_y;
+		}
+	}
+}
+
+void MapRaster::DrawDot (int x, int y, int radius, std::uint32_t color) {
+	int x_begin	= std::max(0, x - radius);
+	int x_end	= std::min(x_size, x + radius + 1);
+	int y_begin	= std::max(0, y - radius);
+	int y_end	= std::min(y_size, y + radius + 1);
+	
+	for(int py = y_begin; py < y_end; py++) {
+		for(int px = x_begin; px < x_end; px++) {
+			pixels [px + py * x_size] = color;
+		}
+	}
+}
+
+void MapRaster::DrawMap (const MapPackage& map) {
+	Clear(background_color);
+	
+	int vertex_count = map.vertex_view.size() / 2;
+	
+	if(0 == vertex_count) {
+		return;
+	}
+	
+	// Bounds of the map vertices.
+	float min_x = map.vertex_view [0];
+	float max_x = min_x;
+	float min_y = map.vertex_view [1];
+	float max_y = min_y;
+	
+	for(int k = 0; k < vertex_count; k++) {
+		min_x = std::min(min_x, map.vertex_view [0 + 2 * k]);
+		max_x = std::max(max_x, map.vertex_view [0 + 2 * k]);
+		min_y = std::min(min_y, map.vertex_view [1 + 2 * k]);
+		max_y = std::max(max_y, map.vertex_view [1 + 2 * k]);
+	}
+	
+	// Uniform scale into the image without the border, map y goes up and image y goes down.
+	float inner_x_size = std::max(1, x_size - 2 * border);
+	float inner_y_size = std::max(1, y_size - 2 * border);
+	float scale = std::min(inner_x_size / std::max(1.0f, max_x - min_x), inner_y_size / std::max(1.0f, max_y - min_y));
+	float offset_x = 0.5f * (x_size - scale * (max_x - min_x)) - scale * min_x;
+	float offset_y = 0.5f * (y_size + scale * (max_y - min_y)) + scale * min_y;
+	
+	auto to_x = [&] (float x) { return static_cast <int> (std::lround(offset_x + scale * x)); };
+	auto to_y = [&] (float y) { return static_cast <int> (std::lround(offset_y - scale * y)); };
+	
+	for(std::size_t k = 0; k + 1 < map.index_view.size(); k += 2) {
+		int a = map.index_view [0 + k];
+		int b = map.index_view [1 + k];
+		
+		if(vertex_count <= a || vertex_count <= b) {
+			continue;
+		}
+		
+		DrawLine(
+			to_x(map.vertex_view [0 + 2 * a]), to_y(map.vertex_view [1 + 2 * a]),
+			to_x(map.vertex_view [0 + 2 * b]), to_y(map.vertex_view [1 + 2 * b]),
+			line_color);
+	}
+	
+	// Things are x, y and angle triplets.
+	for(std::size_t k = 0; k + 2 < map.thing_view.size(); k += 3) {
+		DrawDot(to_x(map.thing_view [0 + k]), to_y(map.thing_view [1 + k]), 1, thing_color);
+	}
+}
+
+bool MapRaster::SavePng (const std::string& path) const {
+	auto* rgba = reinterpret_cast <const unsigned char*> (pixels.data());
+	return 0 == lodepng::encode(path, rgba, x_size, y_size);
+}
@@ -0,0 +1,36 @@
+#ifndef MAP_RASTER_H
+#define MAP_RASTER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "wad_funcs.h"
+
+// Draws map overviews into an RGBA image on the CPU, for thumbnails where there is no window or
+// open-gl context. Pixels are stored as R, G, B, A bytes in memory order.
+struct MapRaster {
+	MapRaster ();
+	
+	void Resize (int new_x_size, int new_y_size);
+	void Clear (std::uint32_t color);
+	void DrawLine (int x0, int y0, int x1, int y1, std::uint32_t color);
+	void DrawDot (int x, int y, int radius, std::uint32_t color);
+	
+	// Fit the whole map into the image and draw its lines and things on the background color.
+	void DrawMap (const MapPackage& map);
+	bool SavePng (const std::string& path) const;
+	
+	static std::uint32_t Rgba (int r, int g, int b, int a = 255);
+	
+	int x_size;
+	int y_size;
+	int border;
+	std::vector <std::uint32_t> pixels;
+	
+	// Colors match the map view.
+	std::uint32_t background_color;
+	std::uint32_t line_color;
+	std::uint32_t thing_color;
+};
+
+#endif
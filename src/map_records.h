@@ -0,0 +1,86 @@
+#ifndef MAP_RECORDS_H
+#define MAP_RECORDS_H
+
+// Formats a map can be stored in. Hexen maps are binary maps with a BEHAVIOR lump, their linedef
+// and thing records are longer and carry action specials with arguments. UDMF maps are text.
+enum MapFormat {
+	doom_map_format,
+	hexen_map_format,
+	udmf_map_format
+};
+
+// Binary formats come first, per format kernel tables are this long.
+constexpr int binary_map_format_count = 2;
+
+// Byte offsets of the fields of binary map records. Decoders are templates on these, so every
+// format compiles to its own loop with constant offsets and strides. A field a format does not
+// have is at no_field. Specials are 16 bit in Doom records and a byte in Hexen ones.
+constexpr int no_field = -1;
+
+struct DoomThingRecord {
+	static constexpr int size = 10;
+	static constexpr int tid = no_field;
+	static constexpr int x = 0;
+	static constexpr int y = 2;
+	static constexpr int z = no_field;
+	static constexpr int angle = 4;
+	static constexpr int type = 6;
+	static constexpr int flags = 8;
+	static constexpr int special = no_field;
+	static constexpr int special_size = 0;
+	static constexpr int args = no_field;
+};
+
+struct HexenThingRecord {
+	static constexpr int size = 20;
+	static constexpr int tid = 0;
+	static constexpr int x = 2;
+	static constexpr int y = 4;
+	static constexpr int z = 6;
+	static constexpr int angle = 8;
+	static constexpr int type = 10;
+	static constexpr int flags = 12;
+	static constexpr int special = 14;
+	static constexpr int special_size = 1;
+	static constexpr int args = 15;
+};
+
+// Hexen lines have no tag, specials that need one take it from their arguments.
+struct DoomLinedefRecord {
+	static constexpr int size = 14;
+	static constexpr int v1 = 0;
+	static constexpr int v2 = 2;
+	static constexpr int flags = 4;
+	static constexpr int special = 6;
+	static constexpr int special_size = 2;
+	static constexpr int tag = 8;
+	static constexpr int args = no_field;
+	static constexpr int front = 10;
+	static constexpr int back = 12;
+};
+
+struct HexenLinedefRecord {
+	static constexpr int size = 16;
+	static constexpr int v1 = 0;
+	static constexpr int v2 = 2;
+	static constexpr int flags = 4;
+	static constexpr int special = 6;
+	static constexpr int special_size = 1;
+	static constexpr int tag = no_field;
+	static constexpr int args = 7;
+	static constexpr int front = 12;
+	static constexpr int back = 14;
+};
+
+// Action arguments per record in Hexen and UDMF maps.
+constexpr int special_arg_count = 5;
+
+constexpr int ThingRecordSize (MapFormat format) {
+	return hexen_map_format == format ? HexenThingRecord::size : DoomThingRecord::size;
+}
+
+constexpr int LinedefRecordSize (MapFormat format) {
+	return hexen_map_format == format ? HexenLinedefRecord::size : DoomLinedefRecord::size;
+}
+
+#endif
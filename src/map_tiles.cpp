@@ -0,0 +1,152 @@
+#include "map_tiles.h"
+#include <algorithm>
+#include <limits>
+
+MapTiles::MapTiles () {
+	Clear();
+}
+
+void MapTiles::Clear () {
+	tiles.clear();
+	indices.clear();
+	linedef_slot.clear();
+}
+
+void MapTiles::Build (std::span <const float> vertices, std::span <const int> line_indices, float tile_size, int max_tiles_per_side) {
+	Clear();
+	
+	int vertex_count = vertices.size() / 2;
+	int line_count = line_indices.size() / 2;
+	
+	if(0 == line_count) {
+		return;
+	}
+	
+	float min_x = std::numeric_limits <float>::max();
+	float min_y = min_x;
+	float max_x = std::numeric_limits <float>::lowest();
+	float max_y = max_x;
+	
+	for(int v = 0; v < vertex_count; v++) {
+		min_x = std::min(min_x, vertices [2 * v]);
+		min_y = std::min(min_y, vertices [2 * v + 1]);
+		max_x = std::max(max_x, vertices [2 * v]);
+		max_y = std::max(max_y, vertices [2 * v + 1]);
+	}
+	
+	if(0 == vertex_count) {
+		min_x = min_y = max_x = max_y = 0;
+	}
+	
+	while(max_tiles_per_side < (max_x - min_x) / tile_size || max_tiles_per_side < (max_y - min_y) / tile_size) {
+		tile_size *= 2;
+	}
+	
+	int column_count = static_cast <int> ((max_x - min_x) / tile_size) + 1;
+	int row_count = static_cast <int> ((max_y - min_y) / tile_size) + 1;
+	
+	auto is_valid = [&] (int v) {
+		return 0 <= v && v < vertex_count;
+	};
+	
+	// A line belongs to the tile of its middle. Lines with a missing vertex go to the first tile
+	// and leave its box alone.
+	std::vector <int> line_tiles(line_count, 0);
+	
+	for(int l = 0; l < line_count; l++) {
+		int a = line_indices [2 * l];
+		int b = line_indices [2 * l + 1];
+		
+		if(is_valid(a) && is_valid(b)) {
+			float mid_x = 0.5f * (vertices [2 * a] + vertices [2 * b]);
+			float mid_y = 0.5f * (vertices [2 * a + 1] + vertices [2 * b + 1]);
+			int column = std::clamp(static_cast <int> ((mid_x - min_x) / tile_size), 0, column_count - 1);
+			int row = std::clamp(static_cast <int> ((mid_y - min_y) / tile_size), 0, row_count - 1);
+			line_tiles [l] = column + row * column_count;
+		}
+	}
+	
+	// Counting sort of the lines by tile, which keeps the lines of a tile in map order.
+	tiles.resize(column_count * row_count);
+	
+	for(auto& tile: tiles) {
+		tile.first_index = 0;
+		tile.index_count = 0;
+		tile.min_x = std::numeric_limits <float>::max();
+		tile.min_y = tile.min_x;
+		tile.max_x = std::numeric_limits <float>::lowest();
+		tile.max_y = tile.max_x;
+	}
+	
+	for(int l = 0; l < line_count; l++) {
+		tiles [line_tiles [l]].index_count += 2;
+	}
+	
+	for(std::size_t t = 1; t < tiles.size(); t++) {
+		tiles [t].first_index = tiles [t - 1].first_index + tiles [t - 1].index_count;
+	}
+	
+	std::vector <int> tile_fill(tiles.size());
+	
+	for(std::size_t t = 0; t < tiles.size(); t++) {
+		tile_fill [t] = tiles [t].first_index;
+	}
+	
+	indices.resize(2 * line_count);
+	linedef_slot.resize(line_count);
+	
+	for(int l = 0; l < line_count; l++) {
+		auto& tile = tiles [line_tiles [l]];
+		int slot = tile_fill [line_tiles [l]];
+		tile_fill [line_tiles [l]] += 2;
+		
+		int a = line_indices [2 * l];
+		int b = line_indices [2 * l + 1];
+		indices [slot] = a;
+		indices [slot + 1] = b;
+		linedef_slot [l] = slot / 2;
+		
+		if(is_valid(a) && is_valid(b)) {
+			tile.min_x = std::min({ tile.min_x, vertices [2 * a], vertices [2 * b] });
+			tile.min_y = std::min({ tile.min_y, vertices [2 * a + 1], vertices [2 * b + 1] });
+			tile.max_x = std::max({ tile.max_x, vertices [2 * a], vertices [2 * b] });
+			tile.max_y = std::max({ tile.max_y, vertices [2 * a + 1], vertices [2 * b + 1] });
+		}
+	}
+}
+
+void MapTiles::VisibleRanges (float min_x, float min_y, float max_x, float max_y, DrawRanges& ranges) const {
+	ranges.counts.clear();
+	ranges.offsets.clear();
+	
+	// Start of the range being extended, in indices.
+	int range_first = 0;
+	int range_end = -1;
+	
+	auto close_range = [&] () {
+		if(range_first < range_end) {
+			ranges.counts.push_back(range_end - range_first);
+			ranges.offsets.push_back(reinterpret_cast <const void*> (sizeof(int) * range_first));
+		}
+	};
+	
+	for(const auto& tile: tiles) {
+		bool is_visible =
+			0 < tile.index_count &&
+			tile.min_x <= max_x && min_x <= tile.max_x &&
+			tile.min_y <= max_y && min_y <= tile.max_y;
+		
+		if(!is_visible) {
+			continue;
+		}
+		
+		if(tile.first_index != range_end) {
+			close_range();
+			range_first = tile.first_index;
+		}
+		
+		range_end = tile.first_index + tile.index_count;
+	}
+	
+	close_range();
+}
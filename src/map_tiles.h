@@ -0,0 +1,45 @@
+#ifndef MAP_TILES_H
+#define MAP_TILES_H
+
+#include <span>
+#include <vector>
+
+// Map lines sorted into square tiles, so drawing can skip the tiles outside of the view. The
+// line index pairs are reordered tile by tile, every tile owns one range of the reordered index
+// array and has a bounding box covering its lines whole. Tiles are in row order, so visible
+// tiles next to each other in a row merge into one range.
+struct MapTiles {
+	struct Tile {
+		int first_index;
+		int index_count;
+		float min_x;
+		float min_y;
+		float max_x;
+		float max_y;
+	};
+	
+	// One draw range per run of visible tiles, in the form glMultiDrawElements takes them.
+	struct DrawRanges {
+		std::vector <int> counts;
+		std::vector <const void*> offsets;
+	};
+	
+	MapTiles ();
+	
+	void Clear ();
+	
+	// Tile lines given as x, y vertex pairs and line vertex index pairs. Tiles start out at
+	// tile_size map units, they grow on maps too spread out for max_tiles_per_side.
+	void Build (std::span <const float> vertices, std::span <const int> line_indices, float tile_size = 1024, int max_tiles_per_side = 64);
+	
+	// The ranges of the tiles overlapping a box in map coordinates.
+	void VisibleRanges (float min_x, float min_y, float max_x, float max_y, DrawRanges& ranges) const;
+	
+	std::vector <Tile> tiles;
+	
+	// Line index pairs in tile order, and where every line of the input ended up.
+	std::vector <int> indices;
+	std::vector <int> linedef_slot;
+};
+
+#endif
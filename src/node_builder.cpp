@@ -0,0 +1,637 @@
+#include "node_builder.h"
+#include "space.h"
+#include "work_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+// A seg with the whole line of its side of the linedef, in the direction of the seg. Partitions
+// run along that line, so segs that were split still partition along their original line and
+// vanilla nodes get whole unit partition lines.
+struct BuildSeg {
+	double x1;
+	double y1;
+	double x2;
+	double y2;
+	double line_x;
+	double line_y;
+	double line_dx;
+	double line_dy;
+	std::uint32_t v1;
+	std::uint32_t v2;
+	std::uint32_t linedef;
+	std::uint8_t side;
+};
+
+// Points nearer than this to a partition line are on it.
+static constexpr double on_line_distance = 1.0 / 128;
+
+// Sets larger than this score their candidate partitions on the pool.
+static constexpr int parallel_choice_seg_count = 4096;
+
+static constexpr long long no_partition = std::numeric_limits <long long>::max();
+
+enum SegSide {
+	front_seg,
+	back_seg,
+	split_seg
+};
+
+// Side of a seg against the line of a partition seg. Segs on the line are in front when they face
+// the same way as the partition. The signed distances, scaled by the line length, go to d1 and d2.
+static SegSide ClassifySeg (const BuildSeg& partition, double epsilon, const BuildSeg& seg, double& d1, double& d2) {
+	d1 = partition.line_dy * (seg.x1 - partition.line_x) - partition.line_dx * (seg.y1 - partition.line_y);
+	d2 = partition.line_dy * (seg.x2 - partition.line_x) - partition.line_dx * (seg.y2 - partition.line_y);
+	
+	if(-epsilon <= d1 && -epsilon <= d2) {
+		if(d1 <= epsilon && d2 <= epsilon) {
+			return 0 < partition.line_dx * (seg.x2 - seg.x1) + partition.line_dy * (seg.y2 - seg.y1) ? front_seg : back_seg;
+		}
+		
+		return front_seg;
+	}
+	
+	else if(d1 <= epsilon && d2 <= epsilon) {
+		return back_seg;
+	}
+	
+	return split_seg;
+}
+
+static double LineEpsilon (const BuildSeg& partition) {
+	return on_line_distance * std::sqrt(partition.line_dx * partition.line_dx + partition.line_dy * partition.line_dy);
+}
+
+// Vertices a build adds, numbered from base on. The two sides of a line are split at the same
+// point and share the vertex.
+struct BuildVertices {
+	struct PointHash {
+		std::size_t operator() (const std::pair <long long, long long>& point) const {
+			return point.first * 0x9E3779B97F4A7C15ULL ^ point.second;
+		}
+	};
+	
+	std::uint32_t Add (double vertex_x, double vertex_y) {
+		auto point = std::make_pair(std::llround(vertex_x * 4096), std::llround(vertex_y * 4096));
+		auto found = index.find(point);
+		
+		if(index.end() != found) {
+			return found->second;
+		}
+		
+		std::uint32_t v = base + x.size();
+		x.push_back(vertex_x);
+		y.push_back(vertex_y);
+		index.emplace(point, v);
+		return v;
+	}
+	
+	std::uint32_t base;
+	std::vector <double> x;
+	std::vector <double> y;
+	std::unordered_map <std::pair <long long, long long>, std::uint32_t, PointHash> index;
+};
+
+// A tree, or a subtree built as one job, in the layout of the result.
+struct BuildTree {
+	BuildVertices vertices;
+	std::vector <MapBsp::Node> nodes;
+	std::vector <std::uint32_t> subsector_first_seg;
+	std::vector <std::uint32_t> subsector_seg_count;
+	std::vector <std::uint32_t> seg_v1;
+	std::vector <std::uint32_t> seg_v2;
+	std::vector <std::uint32_t> seg_linedef;
+	std::vector <std::uint8_t> seg_side;
+};
+
+// The seg whose line partitions a set best, or -1 when no seg line divides it, which makes the
+// set convex. Only evenly spread candidates are scored at first, every seg only when none of
+// them divides. Scoring stops as soon as the splits alone cost more than the best so far, which
+// never drops the best candidate, so the choice is the same on any number of threads.
+static int ChoosePartition (const std::vector <BuildSeg>& segs, const NodeBuilder& builder, WorkPool* pool) {
+	int seg_count = segs.size();
+	std::vector <int> candidates;
+	
+	auto score = [&] (int candidate, long long limit) {
+		const auto& partition = segs [candidate];
+		double epsilon = LineEpsilon(partition);
+		long long front_count = 0;
+		long long back_count = 0;
+		long long split_cost = 0;
+		double d1, d2;
+		
+		for(const auto& seg : segs) {
+			auto side = ClassifySeg(partition, epsilon, seg, d1, d2);
+			
+			if(front_seg == side) {
+				front_count++;
+			}
+			
+			else if(back_seg == side) {
+				back_count++;
+			}
+			
+			else {
+				front_count++;
+				back_count++;
+				split_cost += builder.split_cost;
+				
+				if(limit < split_cost) {
+					return no_partition;
+				}
+			}
+		}
+		
+		if(0 == front_count || 0 == back_count) {
+			return no_partition;
+		}
+		
+		return split_cost + std::abs(front_count - back_count);
+	};
+	
+	auto choose = [&] (int candidate_count) {
+		candidates.clear();
+		
+		for(int k = 0; k < candidate_count; k++) {
+			int candidate = static_cast <long long> (k) * seg_count / candidate_count;
+			
+			// Neighbour segs often come from the same side of the same line.
+			if(!candidates.empty() && segs [candidates.back()].linedef == segs [candidate].linedef && segs [candidates.back()].side == segs [candidate].side) {
+				continue;
+			}
+			
+			candidates.push_back(candidate);
+		}
+		
+		std::pair <long long, int> best(no_partition, -1);
+		
+		auto keep_better = [] (std::pair <long long, int>& best, std::pair <long long, int> scored) {
+			if(scored.first < best.first || (scored.first == best.first && no_partition != scored.first && scored.second < best.second)) {
+				best = scored;
+			}
+		};
+		
+		if(pool && parallel_choice_seg_count <= seg_count) {
+			std::vector <std::pair <long long, int>> thread_best(pool->thread_count, best);
+			
+			pool->Run(candidates.size(), [&] (int job, int thread) {
+				auto& b = thread_best [thread];
+				keep_better(b, { score(candidates [job], b.first), candidates [job] });
+			});
+			
+			for(const auto& b : thread_best) {
+				keep_better(best, b);
+			}
+		}
+		
+		else {
+			for(int candidate : candidates) {
+				keep_better(best, { score(candidate, best.first), candidate });
+			}
+		}
+		
+		return best.second;
+	};
+	
+	int best = choose(std::min(seg_count, builder.candidate_count));
+	
+	if(best < 0 && builder.candidate_count < seg_count) {
+		best = choose(seg_count);
+	}
+	
+	return best;
+}
+
+static void SegBox (const std::vector <BuildSeg>& segs, float* box) {
+	double min_x = std::numeric_limits <double>::max();
+	double min_y = min_x;
+	double max_x = -min_x;
+	double max_y = -min_x;
+	
+	for(const auto& seg : segs) {
+		min_x = std::min({ min_x, seg.x1, seg.x2 });
+		min_y = std::min({ min_y, seg.y1, seg.y2 });
+		max_x = std::max({ max_x, seg.x1, seg.x2 });
+		max_y = std::max({ max_y, seg.y1, seg.y2 });
+	}
+	
+	box [0] = min_x;
+	box [1] = min_y;
+	box [2] = max_x;
+	box [3] = max_y;
+}
+
+// Split a set along the line of a partition seg into the node for it, with the boxes of both
+// halves. Segs crossing the line are cut at a new vertex.
+static MapBsp::Node SplitSegs (const std::vector <BuildSeg>& segs, const BuildSeg& partition, BuildVertices& vertices, std::vector <BuildSeg>& front, std::vector <BuildSeg>& back) {
+	double epsilon = LineEpsilon(partition);
+	double d1, d2;
+	
+	for(const auto& seg : segs) {
+		auto side = ClassifySeg(partition, epsilon, seg, d1, d2);
+		
+		if(front_seg == side) {
+			front.push_back(seg);
+		}
+		
+		else if(back_seg == side) {
+			back.push_back(seg);
+		}
+		
+		else {
+			double t = d1 / (d1 - d2);
+			auto v = vertices.Add(seg.x1 + t * (seg.x2 - seg.x1), seg.y1 + t * (seg.y2 - seg.y1));
+			
+			BuildSeg first = seg;
+			first.x2 = vertices.x [v - vertices.base];
+			first.y2 = vertices.y [v - vertices.base];
+			first.v2 = v;
+			
+			BuildSeg second = seg;
+			second.x1 = first.x2;
+			second.y1 = first.y2;
+			second.v1 = v;
+			
+			(0 < d1 ? front : back).push_back(first);
+			(0 < d1 ? back : front).push_back(second);
+		}
+	}
+	
+	MapBsp::Node node;
+	node.x = partition.line_x;
+	node.y = partition.line_y;
+	node.dx = partition.line_dx;
+	node.dy = partition.line_dy;
+	SegBox(front, node.boxes [0]);
+	SegBox(back, node.boxes [1]);
+	node.children [0] = DoomMap::no_index;
+	node.children [1] = DoomMap::no_index;
+	return node;
+}
+
+// Build a subtree on this thread, returns its child index. The set is used up.
+static std::uint32_t BuildSubtree (std::vector <BuildSeg>& segs, BuildTree& tree, const NodeBuilder& builder) {
+	int partition = ChoosePartition(segs, builder, nullptr);
+	
+	if(partition < 0) {
+		tree.subsector_first_seg.push_back(tree.seg_v1.size());
+		tree.subsector_seg_count.push_back(segs.size());
+		
+		for(const auto& seg : segs) {
+			tree.seg_v1.push_back(seg.v1);
+			tree.seg_v2.push_back(seg.v2);
+			tree.seg_linedef.push_back(seg.linedef);
+			tree.seg_side.push_back(seg.side);
+		}
+		
+		return DoomMap::subsector_child | (tree.subsector_first_seg.size() - 1);
+	}
+	
+	std::vector <BuildSeg> front, back;
+	auto node = SplitSegs(segs, segs [partition], tree.vertices, front, back);
+	std::vector <BuildSeg>().swap(segs);
+	
+	node.children [0] = BuildSubtree(front, tree, builder);
+	node.children [1] = BuildSubtree(back, tree, builder);
+	tree.nodes.push_back(node);
+	return tree.nodes.size() - 1;
+}
+
+// The top of the tree, above the subtrees built as jobs. Children of at least zero are top
+// nodes, the others subtree -1 - child.
+struct TopNode {
+	MapBsp::Node node;
+	int children [2];
+};
+
+struct TopBuild {
+	int Partition (std::vector <BuildSeg>& segs) {
+		int partition = job_seg_count < segs.size() ? ChoosePartition(segs, builder, &pool) : -1;
+		
+		if(partition < 0) {
+			subtree_segs.push_back(std::move(segs));
+			return -static_cast <int> (subtree_segs.size());
+		}
+		
+		std::vector <BuildSeg> front, back;
+		TopNode top;
+		top.node = SplitSegs(segs, segs [partition], vertices, front, back);
+		std::vector <BuildSeg>().swap(segs);
+		
+		top.children [0] = Partition(front);
+		top.children [1] = Partition(back);
+		top_nodes.push_back(top);
+		return top_nodes.size() - 1;
+	}
+	
+	TopBuild (const NodeBuilder& builder, WorkPool& pool) : builder(builder), pool(pool) {
+		job_seg_count = 0;
+	}
+	
+	const NodeBuilder& builder;
+	WorkPool& pool;
+	int job_seg_count;
+	BuildVertices vertices;
+	std::vector <TopNode> top_nodes;
+	std::vector <std::vector <BuildSeg>> subtree_segs;
+};
+
+NodeBuilder::NodeBuilder () {
+	split_cost = 8;
+	candidate_count = 32;
+	map_vertex_count = 0;
+}
+
+void NodeBuilder::Clear () {
+	*this = NodeBuilder();
+}
+
+bool NodeBuilder::Build (const DoomMap& map, int thread_count) {
+	int keep_split_cost = split_cost;
+	int keep_candidate_count = candidate_count;
+	Clear();
+	split_cost = keep_split_cost;
+	candidate_count = std::max(1, keep_candidate_count);
+	
+	// Every side of a line with length is a seg, running from v1 to v2 on the front side.
+	std::vector <BuildSeg> segs;
+	segs.reserve(2 * map.LinedefCount());
+	
+	for(int l = 0; l < map.LinedefCount(); l++) {
+		auto v1 = map.linedef_v1 [l];
+		auto v2 = map.linedef_v2 [l];
+		
+		if(map.VertexCount() <= v1 || map.VertexCount() <= v2) {
+			continue;
+		}
+		
+		double x1 = map.vertex_x [v1];
+		double y1 = map.vertex_y [v1];
+		double x2 = map.vertex_x [v2];
+		double y2 = map.vertex_y [v2];
+		
+		if(x1 == x2 && y1 == y2) {
+			continue;
+		}
+		
+		for(int side = 0; side < 2; side++) {
+			auto sidedef = 0 == side ? map.linedef_front [l] : map.linedef_back [l];
+			
+			if(map.SidedefCount() <= sidedef) {
+				continue;
+			}
+			
+			BuildSeg seg;
+			seg.x1 = 0 == side ? x1 : x2;
+			seg.y1 = 0 == side ? y1 : y2;
+			seg.x2 = 0 == side ? x2 : x1;
+			seg.y2 = 0 == side ? y2 : y1;
+			seg.line_x = seg.x1;
+			seg.line_y = seg.y1;
+			seg.line_dx = seg.x2 - seg.x1;
+			seg.line_dy = seg.y2 - seg.y1;
+			seg.v1 = 0 == side ? v1 : v2;
+			seg.v2 = 0 == side ? v2 : v1;
+			seg.linedef = l;
+			seg.side = side;
+			segs.push_back(seg);
+		}
+	}
+	
+	if(segs.empty()) {
+		return false;
+	}
+	
+	// Subtrees become jobs below a size that depends on the map alone.
+	WorkPool pool(thread_count);
+	TopBuild top(*this, pool);
+	top.job_seg_count = std::max <int> (1024, segs.size() / 64);
+	top.vertices.base = map.VertexCount();
+	int root = top.Partition(segs);
+	
+	map_vertex_count = map.VertexCount();
+	vertex_x.assign(map.vertex_x.begin(), map.vertex_x.end());
+	vertex_y.assign(map.vertex_y.begin(), map.vertex_y.end());
+	vertex_x.insert(vertex_x.end(), top.vertices.x.begin(), top.vertices.x.end());
+	vertex_y.insert(vertex_y.end(), top.vertices.y.begin(), top.vertices.y.end());
+	
+	int subtree_count = top.subtree_segs.size();
+	std::uint32_t subtree_vertex_base = vertex_x.size();
+	std::vector <BuildTree> subtrees(subtree_count);
+	std::vector <std::uint32_t> subtree_roots(subtree_count);
+	
+	pool.Run(subtree_count, [&] (int job, int thread) {
+		subtrees [job].vertices.base = subtree_vertex_base;
+		subtree_roots [job] = BuildSubtree(top.subtree_segs [job], subtrees [job], *this);
+	});
+	
+	// Put the subtrees together in tree order, renumbering everything they hold.
+	auto append_subtree = [&] (int job) {
+		auto& tree = subtrees [job];
+		std::uint32_t node_offset = nodes.size();
+		std::uint32_t subsector_offset = subsector_first_seg.size();
+		std::uint32_t seg_offset = seg_v1.size();
+		std::uint32_t vertex_offset = vertex_x.size() - subtree_vertex_base;
+		
+		auto child_index = [&] (std::uint32_t child) {
+			if(0 != (child & DoomMap::subsector_child)) {
+				return DoomMap::subsector_child | ((child & ~DoomMap::subsector_child) + subsector_offset);
+			}
+			
+			return child + node_offset;
+		};
+		
+		auto vertex_index = [&] (std::uint32_t v) {
+			return v < subtree_vertex_base ? v : v + vertex_offset;
+		};
+		
+		for(auto node : tree.nodes) {
+			node.children [0] = child_index(node.children [0]);
+			node.children [1] = child_index(node.children [1]);
+			nodes.push_back(node);
+		}
+		
+		for(std::size_t s = 0; s < tree.subsector_first_seg.size(); s++) {
+			subsector_first_seg.push_back(tree.subsector_first_seg [s] + seg_offset);
+			subsector_seg_count.push_back(tree.subsector_seg_count [s]);
+		}
+		
+		for(std::size_t s = 0; s < tree.seg_v1.size(); s++) {
+			seg_v1.push_back(vertex_index(tree.seg_v1 [s]));
+			seg_v2.push_back(vertex_index(tree.seg_v2 [s]));
+		}
+		
+		seg_linedef.insert(seg_linedef.end(), tree.seg_linedef.begin(), tree.seg_linedef.end());
+		seg_side.insert(seg_side.end(), tree.seg_side.begin(), tree.seg_side.end());
+		vertex_x.insert(vertex_x.end(), tree.vertices.x.begin(), tree.vertices.x.end());
+		vertex_y.insert(vertex_y.end(), tree.vertices.y.begin(), tree.vertices.y.end());
+		
+		auto root = child_index(subtree_roots [job]);
+		tree = BuildTree();
+		return root;
+	};
+	
+	auto append = [&] (auto& self, int child) -> std::uint32_t {
+		if(child < 0) {
+			return append_subtree(-1 - child);
+		}
+		
+		auto node = top.top_nodes [child].node;
+		node.children [0] = self(self, top.top_nodes [child].children [0]);
+		node.children [1] = self(self, top.top_nodes [child].children [1]);
+		nodes.push_back(node);
+		return nodes.size() - 1;
+	};
+	
+	append(append, root);
+	return true;
+}
+
+void NodeBuilder::ToBsp (MapBsp& bsp) const {
+	bsp.Clear();
+	bsp.format = IsVanillaCompatible() ? MapBsp::vanilla_nodes : MapBsp::extended_nodes;
+	bsp.nodes = nodes;
+	bsp.subsector_first_seg = subsector_first_seg;
+	bsp.subsector_seg_count = subsector_seg_count;
+	bsp.seg_v1 = seg_v1;
+	bsp.seg_v2 = seg_v2;
+	bsp.seg_linedef = seg_linedef;
+	bsp.seg_side = seg_side;
+	bsp.vertex_x.assign(vertex_x.begin(), vertex_x.end());
+	bsp.vertex_y.assign(vertex_y.begin(), vertex_y.end());
+}
+
+bool NodeBuilder::IsVanillaCompatible () const {
+	return vertex_x.size() < 0xFFFF && seg_v1.size() <= 0xFFFF && subsector_first_seg.size() <= 0x7FFF && nodes.size() <= 0x7FFF;
+}
+
+static void Put8 (std::vector <char>& out, int value) {
+	out.push_back(static_cast <char> (value));
+}
+
+static void Put16 (std::vector <char>& out, int value) {
+	out.push_back(static_cast <char> (value));
+	out.push_back(static_cast <char> (value >> 8));
+}
+
+static void Put32 (std::vector <char>& out, std::uint32_t value) {
+	for(int k = 0; k < 4; k++) {
+		out.push_back(static_cast <char> (value >> (8 * k)));
+	}
+}
+
+// Boxes as top, bottom, left, right, grown to whole units.
+static void PutNodeBoxes (std::vector <char>& out, const MapBsp::Node& node) {
+	for(int c = 0; c < 2; c++) {
+		Put16(out, std::ceil(node.boxes [c][3]));
+		Put16(out, std::floor(node.boxes [c][1]));
+		Put16(out, std::floor(node.boxes [c][0]));
+		Put16(out, std::ceil(node.boxes [c][2]));
+	}
+}
+
+void NodeBuilder::WriteLumps (const DoomMap& map, std::vector <char>& vertexes, std::vector <char>& segs, std::vector <char>& ssectors, std::vector <char>& nodes_lump) const {
+	vertexes.clear();
+	segs.clear();
+	ssectors.clear();
+	nodes_lump.clear();
+	
+	if(IsVanillaCompatible()) {
+		for(std::size_t v = 0; v < vertex_x.size(); v++) {
+			Put16(vertexes, std::lround(vertex_x [v]));
+			Put16(vertexes, std::lround(vertex_y [v]));
+		}
+		
+		// Angles are binary, offsets run from the start of the linedef on the seg's side.
+		for(int s = 0; s < SegCount(); s++) {
+			auto v1 = seg_v1 [s];
+			auto v2 = seg_v2 [s];
+			auto linedef = seg_linedef [s];
+			auto line_start = 0 == seg_side [s] ? map.linedef_v1 [linedef] : map.linedef_v2 [linedef];
+			double angle = std::atan2(vertex_y [v2] - vertex_y [v1], vertex_x [v2] - vertex_x [v1]);
+			double offset = std::hypot(vertex_x [v1] - vertex_x [line_start], vertex_y [v1] - vertex_y [line_start]);
+			
+			Put16(segs, v1);
+			Put16(segs, v2);
+			Put16(segs, std::lround(angle * 65536 / (2 * SpaceConst::Pi())));
+			Put16(segs, linedef);
+			Put16(segs, seg_side [s]);
+			Put16(segs, std::lround(offset));
+		}
+		
+		for(int s = 0; s < SubsectorCount(); s++) {
+			Put16(ssectors, subsector_seg_count [s]);
+			Put16(ssectors, subsector_first_seg [s]);
+		}
+		
+		for(const auto& node : nodes) {
+			Put16(nodes_lump, node.x);
+			Put16(nodes_lump, node.y);
+			Put16(nodes_lump, node.dx);
+			Put16(nodes_lump, node.dy);
+			PutNodeBoxes(nodes_lump, node);
+			
+			for(auto child : node.children) {
+				Put16(nodes_lump, 0 != (child & DoomMap::subsector_child) ? 0x8000 | (child & 0x7FFF) : child);
+			}
+		}
+		
+		return;
+	}
+	
+	for(int v = 0; v < map_vertex_count; v++) {
+		Put16(vertexes, map.vertex_x [v]);
+		Put16(vertexes, map.vertex_y [v]);
+	}
+	
+	// Added vertices are 16.16 fixed point, subsectors only store their seg count.
+	nodes_lump.insert(nodes_lump.end(), { 'X', 'N', 'O', 'D' });
+	Put32(nodes_lump, map_vertex_count);
+	Put32(nodes_lump, vertex_x.size() - map_vertex_count);
+	
+	for(std::size_t v = map_vertex_count; v < vertex_x.size(); v++) {
+		Put32(nodes_lump, std::llround(vertex_x [v] * 65536));
+		Put32(nodes_lump, std::llround(vertex_y [v] * 65536));
+	}
+	
+	Put32(nodes_lump, SubsectorCount());
+	
+	for(auto count : subsector_seg_count) {
+		Put32(nodes_lump, count);
+	}
+	
+	Put32(nodes_lump, SegCount());
+	
+	for(int s = 0; s < SegCount(); s++) {
+		Put32(nodes_lump, seg_v1 [s]);
+		Put32(nodes_lump, seg_v2 [s]);
+		Put16(nodes_lump, seg_linedef [s]);
+		Put8(nodes_lump, seg_side [s]);
+	}
+	
+	Put32(nodes_lump, NodeCount());
+	
+	for(const auto& node : nodes) {
+		Put16(nodes_lump, node.x);
+		Put16(nodes_lump, node.y);
+		Put16(nodes_lump, node.dx);
+		Put16(nodes_lump, node.dy);
+		PutNodeBoxes(nodes_lump, node);
+		Put32(nodes_lump, node.children [0]);
+		Put32(nodes_lump, node.children [1]);
+	}
+}
+
+int NodeBuilder::NodeCount () const {
+	return nodes.size();
+}
+
+int NodeBuilder::SubsectorCount () const {
+	return subsector_first_seg.size();
+}
+
+int NodeBuilder::SegCount () const {
+	return seg_v1.size();
+}
@@ -0,0 +1,61 @@
+#ifndef NODE_BUILDER_H
+#define NODE_BUILDER_H
+
+#include <cstdint>
+#include <vector>
+#include "doom_map.h"
+#include "map_bsp.h"
+
+// Builds the BSP tree of a map from its vertices, lines and sides, for maps that come without
+// nodes or with broken ones. Every side of a line starts as a seg. The seg line that splits the
+// fewest segs and leaves the two halves most even partitions the set, and both halves recurse
+// until no seg line divides what is left, which then is a convex subsector.
+//
+// The top of the tree is partitioned on one thread with the candidate lines scored on all cores.
+// Below a size that only depends on the map, the subtrees are independent jobs for the work
+// pool. They are put back together in tree order, so the result is the same for any thread
+// count, and children always come before their parent.
+struct NodeBuilder {
+	NodeBuilder ();
+	
+	void Clear ();
+	
+	// Zero threads means one per core. Returns false when the map has no lines to build from.
+	bool Build (const DoomMap& map, int thread_count = 0);
+	
+	// The built tree for queries.
+	void ToBsp (MapBsp& bsp) const;
+	
+	// Whether the tree fits the 16 bit fields of vanilla nodes.
+	bool IsVanillaCompatible () const;
+	
+	// The tree as map lumps. Vanilla nodes when they fit, with the vertices the build added
+	// appended to VERTEXES, rounded to whole units. Otherwise ZDoom extended nodes in NODES, which
+	// hold the added vertices themselves, and VERTEXES as it was with SEGS and SSECTORS empty.
+	void WriteLumps (const DoomMap& map, std::vector <char>& vertexes, std::vector <char>& segs, std::vector <char>& ssectors, std::vector <char>& nodes_lump) const;
+	
+	int NodeCount () const;
+	int SubsectorCount () const;
+	int SegCount () const;
+	
+	// Partition choice. A split seg costs split_cost segs of imbalance between the two halves.
+	// Sets larger than candidate_count only try that many seg lines, spread evenly over the set.
+	int split_cost;
+	int candidate_count;
+	
+	// Map vertices first, then the split points the build added.
+	int map_vertex_count;
+	std::vector <double> vertex_x;
+	std::vector <double> vertex_y;
+	
+	std::vector <MapBsp::Node> nodes;
+	std::vector <std::uint32_t> subsector_first_seg;
+	std::vector <std::uint32_t> subsector_seg_count;
+	
+	std::vector <std::uint32_t> seg_v1;
+	std::vector <std::uint32_t> seg_v2;
+	std::vector <std::uint32_t> seg_linedef;
+	std::vector <std::uint8_t> seg_side;
+};
+
+#endif
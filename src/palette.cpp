@@ -0,0 +1,169 @@
+#include "palette.h"
+#include "lump_kernels.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define PALETTE_X86
+	#include <immintrin.h>
+	
+	#ifdef _MSC_VER
+		#define PALETTE_AVX2
+	#else
+		#define PALETTE_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+// Two maps past the light levels, invulnerability and black.
+static constexpr int colormap_count = colormap_light_levels + 2;
+
+static std::uint32_t PackRgba (std::uint8_t r, std::uint8_t g, std::uint8_t b) {
+	return r | g << 8 | b << 16 | 0xFF000000u;
+}
+
+DoomPalette::DoomPalette () {
+	palettes.resize(palette_color_count);
+	colormaps.resize(colormap_count * palette_color_count);
+	
+	for(int c = 0; c < palette_color_count; c++) {
+		palettes [c] = PackRgba(c, c, c);
+		
+		for(int level = 0; level < colormap_light_levels; level++) {
+			colormaps [level * palette_color_count + c] = c * (colormap_light_levels - level) / colormap_light_levels;
+		}
+		
+		colormaps [colormap_light_levels * palette_color_count + c] = palette_color_count - 1 - c;
+		colormaps [(colormap_light_levels + 1) * palette_color_count + c] = 0;
+	}
+}
+
+bool DoomPalette::ReadPlaypal (const char* lump, std::size_t size) {
+	std::size_t palette_count = size / playpal_palette_size;
+	
+	if(0 == palette_count) {
+		return false;
+	}
+	
+	palettes.resize(palette_count * palette_color_count);
+	
+	for(std::size_t k = 0; k < palettes.size(); k++) {
+		const char* rgb = lump + 3 * k;
+		palettes [k] = PackRgba(rgb [0], rgb [1], rgb [2]);
+	}
+	
+	return true;
+}
+
+bool DoomPalette::ReadColormap (const char* lump, std::size_t size) {
+	std::size_t map_count = size / palette_color_count;
+	
+	if(0 == map_count) {
+		return false;
+	}
+	
+	colormaps.assign(lump, lump + map_count * palette_color_count);
+	return true;
+}
+
+// The data of the lump that wins in the stack, null when there is none.
+static const char* FindStackLump (const WadStack& wads, const char* name, std::size_t& size) {
+	auto ref = wads.FindLump(DoomWad::LumpKey(name));
+	
+	if(ref.wad_index < 0) {
+		return nullptr;
+	}
+	
+	const auto& wad = wads.Wad(ref.wad_index);
+	const auto& lump = wad.Lump(ref.index);
+	
+	if(!wad.IsLumpValid(lump)) {
+		return nullptr;
+	}
+	
+	size = lump.size;
+	return wad.LumpData(lump);
+}
+
+bool DoomPalette::Read (const WadStack& wads) {
+	std::size_t playpal_size = 0;
+	std::size_t colormap_size = 0;
+	const char* playpal = FindStackLump(wads, "PLAYPAL", playpal_size);
+	const char* colormap = FindStackLump(wads, "COLORMAP", colormap_size);
+	bool is_playpal_read = playpal && ReadPlaypal(playpal, playpal_size);
+	bool is_colormap_read = colormap && ReadColormap(colormap, colormap_size);
+	return is_playpal_read && is_colormap_read;
+}
+
+int DoomPalette::PaletteCount () const {
+	return palettes.size() / palette_color_count;
+}
+
+int DoomPalette::ColormapCount () const {
+	return colormaps.size() / palette_color_count;
+}
+
+int DoomPalette::LightColormap (int sector_light) {
+	return std::clamp((255 - sector_light) >> 3, 0, colormap_light_levels - 1);
+}
+
+void DoomPalette::LightTable (int palette, int colormap, std::uint32_t* table) const {
+	const auto* colors = palettes.data() + palette_color_count * std::clamp(palette, 0, PaletteCount() - 1);
+	const auto* map = colormaps.data() + palette_color_count * std::clamp(colormap, 0, ColormapCount() - 1);
+	
+	for(int c = 0; c < palette_color_count; c++) {
+		table [c] = colors [map [c]];
+	}
+}
+
+static void ScalarExpand (const std::uint8_t* pixels, std::size_t count, const std::uint32_t* table, std::uint32_t* rgba) {
+	for(std::size_t k = 0; k < count; k++) {
+		rgba [k] = table [pixels [k]];
+	}
+}
+
+#ifdef PALETTE_X86
+
+// Byte shuffles can only look up 16 entries at a time, a 256 color table would take sixteen of
+// them per byte of output. The table is small enough to stay in L1, so eight gathered lookups
+// at a time win instead.
+PALETTE_AVX2 static void Avx2Expand (const std::uint8_t* pixels, std::size_t count, const std::uint32_t* table, std::uint32_t* rgba) {
+	const int* colors = reinterpret_cast <const int*> (table);
+	std::size_t k = 0;
+	
+	for(; k + 32 <= count; k += 32) {
+		__m256i p = _mm256_loadu_si256(reinterpret_cast <const __m256i*> (pixels + k));
+		__m128i lo = _mm256_castsi256_si128(p);
+		__m128i hi = _mm256_extracti128_si256(p, 1);
+		__m256i c0 = _mm256_i32gather_epi32(colors, _mm256_cvtepu8_epi32(lo), 4);
+		__m256i c1 = _mm256_i32gather_epi32(colors, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)), 4);
+		__m256i c2 = _mm256_i32gather_epi32(colors, _mm256_cvtepu8_epi32(hi), 4);
+		__m256i c3 = _mm256_i32gather_epi32(colors, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)), 4);
+		_mm256_storeu_si256(reinterpret_cast <__m256i*> (rgba + k + 0), c0);
+		_mm256_storeu_si256(reinterpret_cast <__m256i*> (rgba + k + 8), c1);
+		_mm256_storeu_si256(reinterpret_cast <__m256i*> (rgba + k + 16), c2);
+		_mm256_storeu_si256(reinterpret_cast <__m256i*> (rgba + k + 24), c3);
+	}
+	
+	ScalarExpand(pixels + k, count - k, table, rgba + k);
+}
+
+#endif
+
+const PaletteKernels* ScalarPaletteKernels () {
+	static const PaletteKernels kernels = { ScalarExpand, "scalar" };
+	return &kernels;
+}
+
+const PaletteKernels* Avx2PaletteKernels () {
+	#ifdef PALETTE_X86
+		static const PaletteKernels kernels = { Avx2Expand, "avx2" };
+		static const bool is_supported = CpuHasAvx2();
+		return is_supported ? &kernels : nullptr;
+	#else
+		return nullptr;
+	#endif
+}
+
+const PaletteKernels& BestPaletteKernels () {
+	static const PaletteKernels* best = Avx2PaletteKernels() ? Avx2PaletteKernels() : ScalarPaletteKernels();
+	return *best;
+}
@@ -0,0 +1,59 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "wad_stack.h"
+
+// PLAYPAL is a run of palettes of 256 RGB triplets, 14 in DOOM: the normal one followed by the
+// red, yellow and green tints for pain, pickups and the radiation suit. COLORMAP maps palette
+// indices to darker ones, 32 light levels from full bright down, then the invulnerability map and
+// an all black one. Every graphic in a wad is made of palette indices.
+constexpr int palette_color_count = 256;
+constexpr int playpal_palette_size = 3 * palette_color_count;
+constexpr int colormap_light_levels = 32;
+
+// Colors are RGBA in memory order, as open-gl takes them with GL_RGBA and GL_UNSIGNED_BYTE.
+struct DoomPalette {
+	
+	// A gray ramp with light levels of its own, for wads without a palette.
+	DoomPalette ();
+	
+	// Lump contents. Partial palettes and colormaps at the end of a lump are ignored. Returns false
+	// and keeps what was there when the lump holds none.
+	bool ReadPlaypal (const char* lump, std::size_t size);
+	bool ReadColormap (const char* lump, std::size_t size);
+	
+	// Both lumps from the topmost wad that has them. Returns false when either is missing.
+	bool Read (const WadStack& wads);
+	
+	int PaletteCount () const;
+	int ColormapCount () const;
+	
+	// The colormap for a sector light level of 0 to 255, as the original draws flats seen up close.
+	static int LightColormap (int sector_light);
+	
+	// The 256 colors of a palette seen through a colormap, for the expand kernels.
+	void LightTable (int palette, int colormap, std::uint32_t* table) const;
+	
+	std::vector <std::uint32_t> palettes;
+	std::vector <std::uint8_t> colormaps;
+};
+
+// Expanding paletted pixels to RGBA through a table of 256 colors. A scalar version and an AVX2
+// version with gathers on x86, picked at run time the way the lump kernels are.
+struct PaletteKernels {
+	void (*expand) (const std::uint8_t* pixels, std::size_t count, const std::uint32_t* table, std::uint32_t* rgba);
+	
+	const char* name;
+};
+
+// The kernels for an instruction set, or null when the CPU does not have it.
+const PaletteKernels* ScalarPaletteKernels ();
+const PaletteKernels* Avx2PaletteKernels ();
+
+// The fastest kernels the CPU supports.
+const PaletteKernels& BestPaletteKernels ();
+
+#endif
@@ -0,0 +1,144 @@
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+// Small stable ids for threads, in the order they first record something.
+static std::uint32_t ProfilerThreadId () {
+	static std::atomic <std::uint32_t> next_id = 0;
+	thread_local std::uint32_t id = next_id++;
+	return id;
+}
+
+Profiler::Scope::Scope (const char* name) {
+	this->name = name;
+	start_ns = GlobalProfiler().is_enabled ? Now() : 0;
+}
+
+Profiler::Scope::~Scope () {
+	auto& profiler = GlobalProfiler();
+	
+	if(profiler.is_enabled && 0 != start_ns) {
+		profiler.Record(name, start_ns, Now() - start_ns);
+	}
+}
+
+Profiler::Profiler (int sample_capacity, int frame_capacity) {
+	is_enabled = true;
+	samples.resize(std::max(1, sample_capacity));
+	sample_count = 0;
+	frame_ms.assign(std::max(1, frame_capacity), 0);
+	frame_count = 0;
+	frame_start_ns = Now();
+}
+
+std::uint64_t Profiler::Now () {
+	auto since_start = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast <std::chrono::nanoseconds> (since_start).count();
+}
+
+void Profiler::Record (const char* name, std::uint64_t start_ns, std::uint64_t duration_ns, SampleKind kind, std::int64_t frame) {
+	if(!is_enabled) {
+		return;
+	}
+	
+	auto thread = ProfilerThreadId();
+	std::lock_guard <std::mutex> lock(mutex);
+	auto& sample = samples [sample_count % samples.size()];
+	sample.name = name;
+	sample.start_ns = start_ns;
+	sample.duration_ns = duration_ns;
+	sample.frame = frame < 0 ? frame_count : frame;
+	sample.thread = thread;
+	sample.kind = kind;
+	sample_count++;
+}
+
+void Profiler::EndFrame () {
+	auto now = Now();
+	std::lock_guard <std::mutex> lock(mutex);
+	frame_ms [frame_count % frame_ms.size()] = 1e-6 * (now - frame_start_ns);
+	frame_count++;
+	frame_start_ns = now;
+}
+
+void Profiler::RecentFrameTimes (int count, std::vector <float>& frame_ms) const {
+	std::lock_guard <std::mutex> lock(mutex);
+	count = std::min <std::uint64_t> (count, std::min <std::uint64_t> (frame_count, this->frame_ms.size()));
+	frame_ms.resize(count);
+	
+	for(int k = 0; k < count; k++) {
+		frame_ms [k] = this->frame_ms [(frame_count - count + k) % this->frame_ms.size()];
+	}
+}
+
+void Profiler::RecentSampleTimes (const char* name, int count, std::vector <float>& sample_ms) const {
+	std::lock_guard <std::mutex> lock(mutex);
+	sample_ms.assign(count, 0);
+	
+	// GPU samples arrive a few frames late, so the walk back goes a little past the oldest frame
+	// asked for before it stops.
+	static constexpr std::uint64_t late_frame_count = 8;
+	std::uint64_t first_frame = frame_count < static_cast <std::uint64_t> (count) ? 0 : frame_count - count;
+	std::uint64_t stored_count = std::min <std::uint64_t> (sample_count, samples.size());
+	
+	for(std::uint64_t k = 0; k < stored_count; k++) {
+		const auto& sample = samples [(sample_count - 1 - k) % samples.size()];
+		
+		if(sample.frame + late_frame_count < first_frame) {
+			break;
+		}
+		
+		if(first_frame <= sample.frame && sample.frame < frame_count && 0 == std::strcmp(name, sample.name)) {
+			sample_ms [count - (frame_count - sample.frame)] += 1e-6 * sample.duration_ns;
+		}
+	}
+}
+
+bool Profiler::WriteChromeTrace (const std::string& path) const {
+	std::ofstream f(path);
+	
+	if(!f.good()) {
+		return false;
+	}
+	
+	std::lock_guard <std::mutex> lock(mutex);
+	std::uint64_t stored_count = std::min <std::uint64_t> (sample_count, samples.size());
+	std::uint64_t first_sample = sample_count - stored_count;
+	
+	// Times are in microseconds from the oldest sample. GPU passes get their own track.
+	std::uint64_t origin_ns = ~0ULL;
+	
+	for(std::uint64_t k = first_sample; k < sample_count; k++) {
+		origin_ns = std::min(origin_ns, samples [k % samples.size()].start_ns);
+	}
+	
+	f << std::fixed << std::setprecision(3);
+	f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	
+	for(std::uint64_t k = first_sample; k < sample_count; k++) {
+		const auto& sample = samples [k % samples.size()];
+		bool is_gpu = gpu_sample == sample.kind;
+		
+		f << (k == first_sample ? "" : ",\n")
+			<< "{\"name\":\"" << sample.name << "\""
+			<< ",\"cat\":\"" << (is_gpu ? "gpu" : "cpu") << "\""
+			<< ",\"ph\":\"X\""
+			<< ",\"ts\":" << 1e-3 * (sample.start_ns - origin_ns)
+			<< ",\"dur\":" << 1e-3 * sample.duration_ns
+			<< ",\"pid\":1"
+			<< ",\"tid\":" << (is_gpu ? 1000 : sample.thread)
+			<< ",\"args\":{\"frame\":" << sample.frame << "}}";
+	}
+	
+	f << "\n]}\n";
+	return f.good();
+}
+
+Profiler& GlobalProfiler () {
+	static Profiler profiler;
+	return profiler;
+}
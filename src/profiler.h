@@ -0,0 +1,71 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timing samples from any thread, kept in a fixed ring so recording never allocates and the
+// newest samples are always there. CPU scopes measure themselves, GPU passes come in as finished
+// durations from timer queries. Names must be string literals or otherwise outlive the profiler.
+struct Profiler {
+	enum SampleKind {
+		cpu_sample,
+		gpu_sample
+	};
+	
+	struct Sample {
+		const char* name;
+		std::uint64_t start_ns;
+		std::uint64_t duration_ns;
+		std::uint32_t frame;
+		std::uint32_t thread;
+		SampleKind kind;
+	};
+	
+	// Times a block of code on the calling thread.
+	struct Scope {
+		Scope (const char* name);
+		~Scope ();
+		
+		const char* name;
+		std::uint64_t start_ns;
+	};
+	
+	Profiler (int sample_capacity = 1 << 16, int frame_capacity = 256);
+	
+	// Nanoseconds on a steady clock shared by all samples.
+	static std::uint64_t Now ();
+	
+	// Frames are counted by EndFrame. Samples belong to the current frame unless given one, which
+	// is how GPU results that come back later find their frame.
+	void Record (const char* name, std::uint64_t start_ns, std::uint64_t duration_ns, SampleKind kind = cpu_sample, std::int64_t frame = -1);
+	
+	// Close the current frame, its length goes into the frame time ring.
+	void EndFrame ();
+	
+	// The last count frame times in milliseconds, oldest first.
+	void RecentFrameTimes (int count, std::vector <float>& frame_ms) const;
+	
+	// The last count durations of a named sample in milliseconds, oldest first, one per frame.
+	// Frames without that sample count as zero.
+	void RecentSampleTimes (const char* name, int count, std::vector <float>& sample_ms) const;
+	
+	// Write every sample in the ring in Chrome trace format, for chrome://tracing or Perfetto.
+	bool WriteChromeTrace (const std::string& path) const;
+	
+	bool is_enabled;
+	
+	mutable std::mutex mutex;
+	std::vector <Sample> samples;
+	std::uint64_t sample_count;
+	std::vector <float> frame_ms;
+	std::uint64_t frame_count;
+	std::uint64_t frame_start_ns;
+};
+
+// The profiler the viewer and the loaders record into.
+Profiler& GlobalProfiler ();
+
+#endif
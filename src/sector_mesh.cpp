@@ -0,0 +1,647 @@
+#include "sector_mesh.h"
+#include "vec2.h"
+#include "work_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// A side of a sector, from vertex to vertex with the sector on its right.
+struct SectorSide {
+	std::uint32_t from;
+	std::uint32_t to;
+	
+	bool operator< (const SectorSide& r) const {
+		return from < r.from || (from == r.from && to < r.to);
+	}
+};
+
+static double Cross (const Vec2d& a, const Vec2d& b) {
+	return a.Dot(b.Rot90as());
+}
+
+// Strictly inside, points on the edges are not. The triangle can be either way around.
+static bool IsInsideTriangle (const Vec2d& a, const Vec2d& b, const Vec2d& c, const Vec2d& p) {
+	double ab = Cross(b - a, p - a);
+	double bc = Cross(c - b, p - b);
+	double ca = Cross(a - c, p - c);
+	return (0 < ab && 0 < bc && 0 < ca) || (ab < 0 && bc < 0 && ca < 0);
+}
+
+// Inside or on the edges of a counter-clockwise triangle.
+static bool IsOnOrInsideTriangle (const Vec2d& a, const Vec2d& b, const Vec2d& c, const Vec2d& p) {
+	return 0 <= Cross(b - a, p - a) && 0 <= Cross(c - b, p - b) && 0 <= Cross(a - c, p - c);
+}
+
+static bool IsInsidePolygon (const Vec2d* points, int count, const Vec2d& p) {
+	bool is_inside = false;
+	
+	for(int i = 0, j = count - 1; i < count; j = i++) {
+		const auto& a = points [i];
+		const auto& b = points [j];
+		
+		if((p.y < a.y) != (p.y < b.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y)) {
+			is_inside = !is_inside;
+		}
+	}
+	
+	return is_inside;
+}
+
+// Scratch space of one thread, reused from sector to sector, and the triangles it made so far.
+struct SectorTriangulator {
+	void Triangulate (const DoomMap& map, const SectorSide* sector_sides, int side_count) {
+		loop_points.clear();
+		loop_first.assign(1, 0);
+		loop_areas.clear();
+		loop_inside_points.clear();
+		
+		TraceLoops(map, sector_sides, side_count);
+		
+		// Outlines run clockwise around the sector and holes the other way. Outlines are
+		// turned counter-clockwise for clipping and holes clockwise for bridging into them.
+		std::vector <int>& outlines = loop_kinds [0];
+		std::vector <int>& holes = loop_kinds [1];
+		outlines.clear();
+		holes.clear();
+		
+		for(std::size_t loop = 0; loop < loop_areas.size(); loop++) {
+			(loop_areas [loop] < 0 ? outlines : holes).push_back(loop);
+			std::reverse(loop_points.begin() + loop_first [loop], loop_points.begin() + loop_first [loop + 1]);
+		}
+		
+		// A hole belongs to the smallest outline around it. Holes without one come from sectors
+		// that are not closed and are left out.
+		hole_outlines.assign(holes.size(), -1);
+		
+		for(std::size_t h = 0; h < holes.size(); h++) {
+			double smallest_area = std::numeric_limits <double>::max();
+			
+			for(int outline: outlines) {
+				const auto* points = loop_points.data() + loop_first [outline];
+				int count = loop_first [outline + 1] - loop_first [outline];
+				
+				if(-loop_areas [outline] < smallest_area && IsInsidePolygon(points, count, loop_inside_points [holes [h]])) {
+					smallest_area = -loop_areas [outline];
+					hole_outlines [h] = outline;
+				}
+			}
+		}
+		
+		for(int outline: outlines) {
+			polygon.assign(loop_points.begin() + loop_first [outline], loop_points.begin() + loop_first [outline + 1]);
+			
+			// Bridge the holes from right to left, so every bridge reaches the outline or a hole
+			// already bridged into it.
+			outline_holes.clear();
+			
+			for(std::size_t h = 0; h < holes.size(); h++) {
+				if(outline == hole_outlines [h]) {
+					outline_holes.push_back(holes [h]);
+				}
+			}
+			
+			auto max_x = [&] (int loop) {
+				double x = std::numeric_limits <double>::lowest();
+				
+				for(int k = loop_first [loop]; k < loop_first [loop + 1]; k++) {
+					x = std::max(x, loop_points [k].x);
+				}
+				
+				return x;
+			};
+			
+			std::sort(outline_holes.begin(), outline_holes.end(), [&] (int a, int b) {
+				return max_x(b) < max_x(a);
+			});
+			
+			for(int hole: outline_holes) {
+				BridgeHole(loop_points.data() + loop_first [hole], loop_first [hole + 1] - loop_first [hole]);
+			}
+			
+			ClipEars();
+		}
+	}
+	
+	// Chain the sides into loops. At a vertex with several ways on, the sharpest turn to the
+	// right keeps to the smallest loop. Coming back to a vertex already on the chain closes the
+	// loop from there, so loops touching at a vertex come out separate.
+	void TraceLoops (const DoomMap& map, const SectorSide* sector_sides, int side_count) {
+		sides.assign(sector_sides, sector_sides + side_count);
+		std::sort(sides.begin(), sides.end());
+		is_side_used.assign(side_count, 0);
+		
+		auto point = [&] (std::uint32_t v) {
+			return Vec2d { map.vertex_x [v], map.vertex_y [v] };
+		};
+		
+		auto next_side = [&] (int side) {
+			auto v = sides [side].to;
+			auto incoming = point(v) - point(sides [side].from);
+			auto range = std::equal_range(sides.begin(), sides.end(), SectorSide { v, 0 }, [] (const SectorSide& a, const SectorSide& b) {
+				return a.from < b.from;
+			});
+			
+			int best = -1;
+			double best_turn = 0;
+			
+			for(auto it = range.first; it != range.second; ++it) {
+				int candidate = it - sides.begin();
+				
+				if(is_side_used [candidate]) {
+					continue;
+				}
+				
+				auto outgoing = point(it->to) - point(v);
+				double turn = std::atan2(Cross(incoming, outgoing), incoming.Dot(outgoing));
+				
+				if(best < 0 || turn < best_turn) {
+					best = candidate;
+					best_turn = turn;
+				}
+			}
+			
+			return best;
+		};
+		
+		for(int first_side = 0; first_side < side_count; first_side++) {
+			if(is_side_used [first_side]) {
+				continue;
+			}
+			
+			chain.assign(1, sides [first_side].from);
+			chain_position [chain [0]] = 0;
+			int side = first_side;
+			
+			while(0 <= side) {
+				is_side_used [side] = 1;
+				auto v = sides [side].to;
+				int position = chain_position [v];
+				
+				if(0 <= position) {
+					AddLoop(map, position);
+					
+					for(std::size_t k = position + 1; k < chain.size(); k++) {
+						chain_position [chain [k]] = -1;
+					}
+					
+					chain.resize(position + 1);
+				}
+				
+				else {
+					chain_position [v] = chain.size();
+					chain.push_back(v);
+				}
+				
+				side = next_side(side);
+			}
+			
+			open_side_count += chain.size() - 1;
+			
+			for(auto v: chain) {
+				chain_position [v] = -1;
+			}
+		}
+	}
+	
+	// The chain from a position to its end is a closed loop.
+	void AddLoop (const DoomMap& map, int position) {
+		int first = loop_points.size();
+		
+		for(std::size_t k = position; k < chain.size(); k++) {
+			loop_points.push_back(Vec2d { map.vertex_x [chain [k]], map.vertex_y [chain [k]] });
+		}
+		
+		int count = loop_points.size() - first;
+		double area = 0;
+		
+		for(int k = 0; k < count; k++) {
+			area += Cross(loop_points [first + k], loop_points [first + (k + 1) % count]);
+		}
+		
+		area *= 0.5;
+		
+		// Lines folding back on themselves enclose nothing.
+		if(count < 3 || std::abs(area) < 1e-6) {
+			loop_points.resize(first);
+			return;
+		}
+		
+		// A point just right of the middle of the first side is inside the sector, it tells which
+		// outline a hole lies in without touching the outline itself.
+		auto side = loop_points [first + 1] - loop_points [first];
+		auto normal = side.Rot90as() * (0.01 / std::max(1e-9, side.Length()));
+		loop_inside_points.push_back((loop_points [first] + loop_points [first + 1]) * 0.5 + normal);
+		
+		loop_areas.push_back(area);
+		loop_first.push_back(loop_points.size());
+	}
+	
+	// Join a clockwise hole to the polygon through a pair of seam edges, from the rightmost hole
+	// vertex to a polygon vertex it can see, found by casting a ray to the right.
+	void BridgeHole (const Vec2d* hole, int hole_count) {
+		int hole_start = 0;
+		
+		for(int k = 1; k < hole_count; k++) {
+			if(hole [hole_start].x < hole [k].x) {
+				hole_start = k;
+			}
+		}
+		
+		const auto m = hole [hole_start];
+		int n = polygon.size();
+		int target = -1;
+		double hit_x = std::numeric_limits <double>::max();
+		
+		for(int i = 0; i < n; i++) {
+			const auto& a = polygon [i];
+			const auto& b = polygon [(i + 1) % n];
+			
+			if((a.y <= m.y) == (b.y <= m.y)) {
+				continue;
+			}
+			
+			double x = a.x + (m.y - a.y) * (b.x - a.x) / (b.y - a.y);
+			
+			if(m.x <= x && x < hit_x) {
+				hit_x = x;
+				target = a.x > b.x ? i : (i + 1) % n;
+			}
+		}
+		
+		// Vertices inside the triangle between the hole, the hit point and the target would cut
+		// the seam. The one nearest in angle to the ray can be seen.
+		if(0 <= target) {
+			Vec2d hit { hit_x, m.y };
+			auto candidate = polygon [target];
+			double best_cos = -2;
+			double best_distance = 0;
+			
+			for(int i = 0; i < n; i++) {
+				const auto& r = polygon [i];
+				
+				if(!IsInsideTriangle(m, hit, candidate, r)) {
+					continue;
+				}
+				
+				auto to_r = r - m;
+				double distance = to_r.Length();
+				double cos = to_r.x / std::max(1e-9, distance);
+				
+				if(best_cos < cos || (best_cos == cos && distance < best_distance)) {
+					target = i;
+					best_cos = cos;
+					best_distance = distance;
+				}
+			}
+		}
+		
+		// Nothing to the right, which only happens for holes poking out of their outline.
+		else {
+			double best_distance = std::numeric_limits <double>::max();
+			
+			for(int i = 0; i < n; i++) {
+				double distance = (polygon [i] - m).LengthSquared();
+				
+				if(distance < best_distance) {
+					target = i;
+					best_distance = distance;
+				}
+			}
+		}
+		
+		bridged.assign(polygon.begin(), polygon.begin() + target + 1);
+		
+		for(int k = 0; k <= hole_count; k++) {
+			bridged.push_back(hole [(hole_start + k) % hole_count]);
+		}
+		
+		bridged.insert(bridged.end(), polygon.begin() + target, polygon.end());
+		std::swap(polygon, bridged);
+	}
+	
+	// Cut ears off the counter-clockwise polygon until one triangle is left. Only reflex
+	// vertices can lie inside an ear, so only they are tested. Touching counts, a vertex where
+	// the polygon passes twice, at a bridge or where a hole meets its outline, lies on the tip
+	// of the ears that would cut across the other pass. When no ear is left, which
+	// happens with overlapping or self touching outlines, a degenerate vertex is dropped or the
+	// current vertex is cut off anyway, so clipping always ends.
+	void ClipEars () {
+		int n = polygon.size();
+		
+		if(n < 3) {
+			return;
+		}
+		
+		int first_vertex = vertices.size() / 2;
+		
+		for(const auto& p: polygon) {
+			vertices.push_back(p.x);
+			vertices.push_back(p.y);
+		}
+		
+		prev.resize(n);
+		next.resize(n);
+		is_reflex.assign(n, 0);
+		is_removed.assign(n, 0);
+		reflex.clear();
+		
+		for(int i = 0; i < n; i++) {
+			prev [i] = (i + n - 1) % n;
+			next [i] = (i + 1) % n;
+		}
+		
+		auto turn = [&] (int i) {
+			return Cross(polygon [i] - polygon [prev [i]], polygon [next [i]] - polygon [i]);
+		};
+		
+		int reflex_count = 0;
+		
+		auto update_reflex = [&] (int i) {
+			bool was_reflex = is_reflex [i];
+			is_reflex [i] = turn(i) <= 0;
+			
+			if(is_reflex [i] && !was_reflex) {
+				reflex.push_back(i);
+				reflex_count++;
+			}
+			
+			else if(!is_reflex [i] && was_reflex) {
+				reflex_count--;
+			}
+		};
+		
+		for(int i = 0; i < n; i++) {
+			update_reflex(i);
+		}
+		
+		auto is_ear = [&] (int i) {
+			if(is_reflex [i]) {
+				return false;
+			}
+			
+			const auto& a = polygon [prev [i]];
+			const auto& b = polygon [i];
+			const auto& c = polygon [next [i]];
+			
+			for(int r: reflex) {
+				if(is_reflex [r] && !is_removed [r] && r != prev [i] && r != next [i] && IsOnOrInsideTriangle(a, b, c, polygon [r])) {
+					return false;
+				}
+			}
+			
+			return true;
+		};
+		
+		auto cut = [&] (int i) {
+			if(0 < turn(i)) {
+				indices.push_back(first_vertex + prev [i]);
+				indices.push_back(first_vertex + i);
+				indices.push_back(first_vertex + next [i]);
+			}
+			
+			int a = prev [i];
+			int c = next [i];
+			next [a] = c;
+			prev [c] = a;
+			is_removed [i] = 1;
+			
+			if(is_reflex [i]) {
+				is_reflex [i] = 0;
+				reflex_count--;
+			}
+			
+			update_reflex(a);
+			update_reflex(c);
+			
+			// Drop the entries of vertices that are convex or gone by now once they pile up.
+			if(2 * reflex_count + 16 < static_cast <int> (reflex.size())) {
+				std::erase_if(reflex, [&] (int r) { return !is_reflex [r] || is_removed [r]; });
+			}
+		};
+		
+		int remaining = n;
+		int i = 0;
+		int miss_count = 0;
+		
+		while(3 < remaining) {
+			if(is_ear(i)) {
+				int c = next [i];
+				cut(i);
+				remaining--;
+				i = c;
+				miss_count = 0;
+				continue;
+			}
+			
+			if(miss_count < remaining) {
+				i = next [i];
+				miss_count++;
+				continue;
+			}
+			
+			// A full round without an ear. Prefer dropping a vertex that turns nowhere.
+			int degenerate = i;
+			
+			for(int k = 0, j = i; k < remaining; k++, j = next [j]) {
+				if(std::abs(turn(j)) < 1e-9) {
+					degenerate = j;
+					break;
+				}
+			}
+			
+			int c = next [degenerate];
+			cut(degenerate);
+			remaining--;
+			i = c;
+			miss_count = 0;
+		}
+		
+		cut(i);
+	}
+	
+	// Sides of the sector and where map vertices sit on the chain being traced, -1 when not on
+	// it. The positions cover the whole map and are reset after every chain.
+	std::vector <SectorSide> sides;
+	std::vector <char> is_side_used;
+	std::vector <std::uint32_t> chain;
+	std::vector <int> chain_position;
+	
+	// Closed loops of the sector, one range of points each.
+	std::vector <Vec2d> loop_points;
+	std::vector <int> loop_first;
+	std::vector <double> loop_areas;
+	std::vector <Vec2d> loop_inside_points;
+	std::vector <int> loop_kinds [2];
+	std::vector <int> hole_outlines;
+	std::vector <int> outline_holes;
+	
+	// The polygon being clipped.
+	std::vector <Vec2d> polygon;
+	std::vector <Vec2d> bridged;
+	std::vector <int> prev;
+	std::vector <int> next;
+	std::vector <char> is_reflex;
+	std::vector <char> is_removed;
+	std::vector <int> reflex;
+	
+	std::vector <float> vertices;
+	std::vector <int> indices;
+	int open_side_count = 0;
+};
+
+SectorMesh::SectorMesh () {
+	Clear();
+}
+
+void SectorMesh::Clear () {
+	vertices.clear();
+	vertex_sectors.clear();
+	indices.clear();
+	sector_first_index.clear();
+	sector_index_count.clear();
+	open_side_count = 0;
+}
+
+int SectorMesh::VertexCount () const {
+	return vertices.size() / 2;
+}
+
+int SectorMesh::TriangleCount () const {
+	return indices.size() / 3;
+}
+
+void SectorMesh::Build (const DoomMap& map, int thread_count) {
+	Clear();
+	
+	int sector_count = map.SectorCount();
+	std::uint32_t vertex_count = map.VertexCount();
+	
+	if(0 == sector_count) {
+		return;
+	}
+	
+	auto side_sector = [&] (std::uint32_t sidedef) {
+		return sidedef < map.sidedef_sector.size() ? map.sidedef_sector [sidedef] : DoomMap::no_index;
+	};
+	
+	// Sides sorted by sector. A line gives its front sector a side along it and its back sector
+	// one the other way, unless both are the same sector.
+	std::vector <int> side_first(sector_count + 1, 0);
+	std::vector <SectorSide> sides;
+	
+	for(int pass = 0; pass < 2; pass++) {
+		for(int l = 0; l < map.LinedefCount(); l++) {
+			auto v1 = map.linedef_v1 [l];
+			auto v2 = map.linedef_v2 [l];
+			auto front = side_sector(map.linedef_front [l]);
+			auto back = side_sector(map.linedef_back [l]);
+			
+			if(vertex_count <= v1 || vertex_count <= v2 || v1 == v2 || front == back) {
+				continue;
+			}
+			
+			const SectorSide line_sides [2] = { { v1, v2 }, { v2, v1 } };
+			const std::uint32_t line_sectors [2] = { front, back };
+			
+			for(int k = 0; k < 2; k++) {
+				auto sector = line_sectors [k];
+				
+				if(sector < static_cast <std::uint32_t> (sector_count)) {
+					if(0 == pass) {
+						side_first [sector + 1]++;
+					}
+					
+					else {
+						sides [side_first [sector]++] = line_sides [k];
+					}
+				}
+			}
+		}
+		
+		// Counts become starts for filling, and filling moves every start to the next sector.
+		if(0 == pass) {
+			for(int s = 0; s < sector_count; s++) {
+				side_first [s + 1] += side_first [s];
+			}
+			
+			sides.resize(side_first [sector_count]);
+		}
+		
+		else {
+			for(int s = sector_count; 0 < s; s--) {
+				side_first [s] = side_first [s - 1];
+			}
+			
+			side_first [0] = 0;
+		}
+	}
+	
+	WorkPool pool(thread_count);
+	std::vector <SectorTriangulator> triangulators(pool.thread_count);
+	
+	for(auto& triangulator: triangulators) {
+		triangulator.chain_position.assign(vertex_count, -1);
+	}
+	
+	struct SectorRange {
+		int thread;
+		int first_vertex;
+		int vertex_count;
+		int first_index;
+		int index_count;
+	};
+	
+	std::vector <SectorRange> ranges(sector_count);
+	
+	pool.Run(sector_count, [&] (int s, int thread) {
+		auto& triangulator = triangulators [thread];
+		auto& range = ranges [s];
+		range.thread = thread;
+		range.first_vertex = triangulator.vertices.size() / 2;
+		range.first_index = triangulator.indices.size();
+		
+		triangulator.Triangulate(map, sides.data() + side_first [s], side_first [s + 1] - side_first [s]);
+		
+		range.vertex_count = triangulator.vertices.size() / 2 - range.first_vertex;
+		range.index_count = triangulator.indices.size() - range.first_index;
+	});
+	
+	// Gather the sectors in order from the threads that made them.
+	int total_vertex_count = 0;
+	int total_index_count = 0;
+	
+	for(const auto& range: ranges) {
+		total_vertex_count += range.vertex_count;
+		total_index_count += range.index_count;
+	}
+	
+	vertices.resize(2 * total_vertex_count);
+	vertex_sectors.resize(total_vertex_count);
+	indices.resize(total_index_count);
+	sector_first_index.resize(sector_count);
+	sector_index_count.resize(sector_count);
+	
+	int vertex_fill = 0;
+	int index_fill = 0;
+	
+	for(int s = 0; s < sector_count; s++) {
+		const auto& range = ranges [s];
+		const auto& triangulator = triangulators [range.thread];
+		
+		std::copy_n(triangulator.vertices.begin() + 2 * range.first_vertex, 2 * range.vertex_count, vertices.begin() + 2 * vertex_fill);
+		std::fill_n(vertex_sectors.begin() + vertex_fill, range.vertex_count, s);
+		
+		for(int k = 0; k < range.index_count; k++) {
+			indices [index_fill + k] = triangulator.indices [range.first_index + k] - range.first_vertex + vertex_fill;
+		}
+		
+		sector_first_index [s] = index_fill;
+		sector_index_count [s] = range.index_count;
+		vertex_fill += range.vertex_count;
+		index_fill += range.index_count;
+	}
+	
+	for(const auto& triangulator: triangulators) {
+		open_side_count += triangulator.open_side_count;
+	}
+}
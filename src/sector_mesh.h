@@ -0,0 +1,41 @@
+#ifndef SECTOR_MESH_H
+#define SECTOR_MESH_H
+
+#include <cstdint>
+#include <vector>
+#include "doom_map.h"
+
+// Sectors as filled triangles. The sides of a sector are chained into closed loops, the loops
+// around the sector become outlines and the loops inside of them holes. Holes are bridged into
+// their outline and the outline is cut into triangles by ear clipping. Every sector has its own
+// copies of its vertices, so per sector values can go into vertex attributes.
+//
+// DOOM geometry is often not simple. Lines with the same sector on both sides are left out,
+// vertices shared by two loops split them, open chains are dropped and counted, and outlines
+// that do not clip cleanly still end up triangulated.
+struct SectorMesh {
+	SectorMesh ();
+	
+	void Clear ();
+	
+	// Sectors are triangulated in parallel, zero threads means one per core. The result is the
+	// same for any thread count.
+	void Build (const DoomMap& map, int thread_count = 0);
+	
+	int VertexCount () const;
+	int TriangleCount () const;
+	
+	// Vertex x, y pairs and the sector of every vertex.
+	std::vector <float> vertices;
+	std::vector <std::uint32_t> vertex_sectors;
+	
+	// Three vertex indices per triangle. The triangles of a sector are one range, in sector order.
+	std::vector <int> indices;
+	std::vector <int> sector_first_index;
+	std::vector <int> sector_index_count;
+	
+	// Sides that did not close into a loop.
+	int open_side_count;
+};
+
+#endif
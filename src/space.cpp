@@ -128,5 +128,3 @@ void Mat3x3toString (std::string& s, const Mat3x3 <X>& m) {
 	// Output.
 	s = ss.str();
 }
-
-#endif
@@ -0,0 +1,651 @@
+#include "udmf.h"
+#include "space.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && 2 <= _M_IX86_FP)
+	#define UDMF_SSE2
+	#include <emmintrin.h>
+#endif
+
+// Block and field names the parser knows. A name used for a block kind and a field, like sector,
+// is one id that means either by where it appears. Flag fields carry their vanilla bit, action
+// arguments their number.
+enum UdmfName : std::uint8_t {
+	udmf_unknown,
+	udmf_namespace,
+	udmf_vertex,
+	udmf_linedef,
+	udmf_sidedef,
+	udmf_sector,
+	udmf_thing,
+	udmf_x,
+	udmf_y,
+	udmf_angle,
+	udmf_type,
+	udmf_v1,
+	udmf_v2,
+	udmf_sidefront,
+	udmf_sideback,
+	udmf_special,
+	udmf_id,
+	udmf_offsetx,
+	udmf_offsety,
+	udmf_texturetop,
+	udmf_texturebottom,
+	udmf_texturemiddle,
+	udmf_heightfloor,
+	udmf_heightceiling,
+	udmf_texturefloor,
+	udmf_textureceiling,
+	udmf_lightlevel,
+	udmf_height,
+	udmf_arg,
+	udmf_line_flag,
+	udmf_thing_flag,
+	udmf_skill_flag,
+	udmf_single,
+	udmf_true,
+	udmf_false
+};
+
+struct UdmfNameInfo {
+	const char* text;
+	UdmfName name;
+	std::uint16_t flag;
+};
+
+// Things are not in single player unless single says so, the vanilla flag is set by default.
+static constexpr std::uint16_t udmf_not_single_flag = 0x0010;
+
+static const UdmfNameInfo udmf_names [] = {
+	{ "namespace", udmf_namespace, 0 },
+	{ "vertex", udmf_vertex, 0 },
+	{ "linedef", udmf_linedef, 0 },
+	{ "sidedef", udmf_sidedef, 0 },
+	{ "sector", udmf_sector, 0 },
+	{ "thing", udmf_thing, 0 },
+	{ "x", udmf_x, 0 },
+	{ "y", udmf_y, 0 },
+	{ "angle", udmf_angle, 0 },
+	{ "type", udmf_type, 0 },
+	{ "v1", udmf_v1, 0 },
+	{ "v2", udmf_v2, 0 },
+	{ "sidefront", udmf_sidefront, 0 },
+	{ "sideback", udmf_sideback, 0 },
+	{ "special", udmf_special, 0 },
+	{ "id", udmf_id, 0 },
+	{ "offsetx", udmf_offsetx, 0 },
+	{ "offsety", udmf_offsety, 0 },
+	{ "texturetop", udmf_texturetop, 0 },
+	{ "texturebottom", udmf_texturebottom, 0 },
+	{ "texturemiddle", udmf_texturemiddle, 0 },
+	{ "heightfloor", udmf_heightfloor, 0 },
+	{ "heightceiling", udmf_heightceiling, 0 },
+	{ "texturefloor", udmf_texturefloor, 0 },
+	{ "textureceiling", udmf_textureceiling, 0 },
+	{ "lightlevel", udmf_lightlevel, 0 },
+	{ "height", udmf_height, 0 },
+	{ "arg0", udmf_arg, 0 },
+	{ "arg1", udmf_arg, 1 },
+	{ "arg2", udmf_arg, 2 },
+	{ "arg3", udmf_arg, 3 },
+	{ "arg4", udmf_arg, 4 },
+	{ "blocking", udmf_line_flag, 0x0001 },
+	{ "blockmonsters", udmf_line_flag, 0x0002 },
+	{ "twosided", udmf_line_flag, 0x0004 },
+	{ "dontpegtop", udmf_line_flag, 0x0008 },
+	{ "dontpegbottom", udmf_line_flag, 0x0010 },
+	{ "secret", udmf_line_flag, 0x0020 },
+	{ "blocksound", udmf_line_flag, 0x0040 },
+	{ "dontdraw", udmf_line_flag, 0x0080 },
+	{ "mapped", udmf_line_flag, 0x0100 },
+	{ "skill1", udmf_skill_flag, 0x0001 },
+	{ "skill2", udmf_skill_flag, 0x0001 },
+	{ "skill3", udmf_skill_flag, 0x0002 },
+	{ "skill4", udmf_skill_flag, 0x0004 },
+	{ "skill5", udmf_skill_flag, 0x0004 },
+	{ "ambush", udmf_thing_flag, 0x0008 },
+	{ "single", udmf_single, udmf_not_single_flag },
+	{ "true", udmf_true, 0 },
+	{ "false", udmf_false, 0 }
+};
+
+// Names are case insensitive.
+static unsigned char LowerCase (char c) {
+	auto u = static_cast <unsigned char> (c);
+	return u + (static_cast <unsigned> (u - 'A') < 26 ? 'a' - 'A' : 0);
+}
+
+static std::uint32_t NameHash (const char* name, std::size_t length) {
+	std::uint32_t hash = 2166136261u;
+	
+	for(std::size_t k = 0; k < length; k++) {
+		hash = (hash ^ LowerCase(name [k])) * 16777619u;
+	}
+	
+	return hash;
+}
+
+// Open addressing over the known names, built once. Misses end on an empty slot.
+struct UdmfNameTable {
+	static constexpr int slot_count = 256;
+	
+	UdmfNameTable () {
+		std::fill(std::begin(slots), std::end(slots), -1);
+		
+		for(std::size_t k = 0; k < std::size(udmf_names); k++) {
+			const char* text = udmf_names [k].text;
+			int slot = NameHash(text, std::strlen(text)) & (slot_count - 1);
+			
+			while(0 <= slots [slot]) {
+				slot = (slot + 1) & (slot_count - 1);
+			}
+			
+			slots [slot] = k;
+			lengths [k] = std::strlen(text);
+		}
+	}
+	
+	const UdmfNameInfo& Find (const char* name, std::size_t length) const {
+		static const UdmfNameInfo unknown = { "", udmf_unknown, 0 };
+		
+		for(int slot = NameHash(name, length) & (slot_count - 1); 0 <= slots [slot]; slot = (slot + 1) & (slot_count - 1)) {
+			const auto& info = udmf_names [slots [slot]];
+			
+			if(lengths [slots [slot]] == length && std::equal(name, name + length, info.text, [] (char a, char b) { return LowerCase(a) == b; })) {
+				return info;
+			}
+		}
+		
+		return unknown;
+	}
+	
+	std::int16_t slots [slot_count];
+	std::size_t lengths [std::size(udmf_names)];
+};
+
+static bool IsDigit (char c) {
+	return static_cast <unsigned> (c - '0') < 10;
+}
+
+static bool IsNameStart (char c) {
+	return static_cast <unsigned> (LowerCase(c) - 'a') < 26 || '_' == c;
+}
+
+static bool IsNameChar (char c) {
+	return IsNameStart(c) || IsDigit(c);
+}
+
+#ifdef UDMF_SSE2
+
+// Bytes in lo to hi as unsigned values, by saturating the distance from lo.
+static __m128i InRange (__m128i bytes, char lo, char hi) {
+	__m128i span = _mm_set1_epi8(hi - lo);
+	return _mm_cmpeq_epi8(_mm_max_epu8(_mm_sub_epi8(bytes, _mm_set1_epi8(lo)), span), span);
+}
+
+#endif
+
+// End of a run of spaces, tabs and line breaks. Control characters count as space too.
+static const char* SkipSpaceRun (const char* p, const char* end) {
+#ifdef UDMF_SSE2
+	for(; p + 16 <= end; p += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast <const __m128i*> (p));
+		unsigned text_mask = ~_mm_movemask_epi8(InRange(bytes, 0, ' ')) & 0xFFFF;
+		
+		if(0 != text_mask) {
+			return p + std::countr_zero(text_mask);
+		}
+	}
+#endif
+	
+	while(p < end && static_cast <unsigned char> (*p) <= ' ') {
+		p++;
+	}
+	
+	return p;
+}
+
+static const char* SkipNameRun (const char* p, const char* end) {
+#ifdef UDMF_SSE2
+	for(; p + 16 <= end; p += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast <const __m128i*> (p));
+		__m128i letters = InRange(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z');
+		__m128i digits = InRange(bytes, '0', '9');
+		__m128i underscores = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_'));
+		unsigned name_mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letters, digits), underscores));
+		
+		if(0xFFFF != name_mask) {
+			return p + std::countr_one(name_mask);
+		}
+	}
+#endif
+	
+	while(p < end && IsNameChar(*p)) {
+		p++;
+	}
+	
+	return p;
+}
+
+// The closing quote of a string, past escaped quotes. Null when the string is not closed.
+static const char* FindStringEnd (const char* p, const char* end) {
+	while(p < end) {
+		auto quote = static_cast <const char*> (std::memchr(p, '"', end - p));
+		
+		if(!quote) {
+			return nullptr;
+		}
+		
+		const char* escape = quote;
+		
+		while(p < escape && '\\' == escape [-1]) {
+			escape--;
+		}
+		
+		if(0 == (quote - escape) % 2) {
+			return quote;
+		}
+		
+		p = quote + 1;
+	}
+	
+	return nullptr;
+}
+
+// A value after the equals sign. Numbers, quoted strings, or true and false.
+struct UdmfValue {
+	double number;
+	const char* text;
+	std::size_t length;
+	bool is_true;
+};
+
+// Holds the read position. Everything returns false on text it can not read and leaves the
+// position where the problem is.
+struct UdmfScanner {
+	bool SkipSpace () {
+		while(p < end) {
+			if(static_cast <unsigned char> (*p) <= ' ') {
+				p = SkipSpaceRun(p, end);
+			}
+			
+			else if('/' != *p || end <= p + 1) {
+				return true;
+			}
+			
+			else if('/' == p [1]) {
+				auto line_end = static_cast <const char*> (std::memchr(p, '\n', end - p));
+				p = line_end ? line_end + 1 : end;
+			}
+			
+			else if('*' == p [1]) {
+				const char* q = p + 2;
+				
+				while(q + 1 < end && !('*' == q [0] && '/' == q [1])) {
+					auto star = static_cast <const char*> (std::memchr(q + 1, '*', end - q - 1));
+					q = star ? star : end;
+				}
+				
+				if(end <= q + 1) {
+					return false;
+				}
+				
+				p = q + 2;
+			}
+			
+			else {
+				return true;
+			}
+		}
+		
+		return true;
+	}
+	
+	bool Expect (char c) {
+		if(!SkipSpace() || end <= p || c != *p) {
+			return false;
+		}
+		
+		p++;
+		return true;
+	}
+	
+	bool ReadName (const char*& name, std::size_t& length) {
+		if(!SkipSpace() || end <= p || !IsNameStart(*p)) {
+			return false;
+		}
+		
+		name = p;
+		p = SkipNameRun(p + 1, end);
+		length = p - name;
+		return true;
+	}
+	
+	// Decimal numbers of up to 18 digits without an exponent are the common case and are read
+	// here. Others go through from_chars.
+	bool ReadNumber (double& number) {
+		static const double powers_of_ten [] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+			1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+		};
+		
+		const char* q = p;
+		bool is_negative = q < end && '-' == *q;
+		q += q < end && ('-' == *q || '+' == *q);
+		const char* digits = q;
+		
+		if(q + 1 < end && '0' == q [0] && 'x' == LowerCase(q [1])) {
+			std::uint64_t value = 0;
+			auto result = std::from_chars(q + 2, end, value, 16);
+			
+			if(std::errc() != result.ec) {
+				return false;
+			}
+			
+			number = is_negative ? -static_cast <double> (value) : value;
+			p = result.ptr;
+			return true;
+		}
+		
+		std::uint64_t mantissa = 0;
+		int digit_count = 0;
+		int fraction_count = 0;
+		
+		for(; q < end && IsDigit(*q); q++, digit_count++) {
+			mantissa = 10 * mantissa + (*q - '0');
+		}
+		
+		if(q < end && '.' == *q) {
+			for(q++; q < end && IsDigit(*q); q++, digit_count++, fraction_count++) {
+				mantissa = 10 * mantissa + (*q - '0');
+			}
+		}
+		
+		if(0 == digit_count) {
+			return false;
+		}
+		
+		if(18 < digit_count || (q < end && 'e' == LowerCase(*q))) {
+			auto result = std::from_chars(digits, end, number);
+			
+			if(std::errc() != result.ec) {
+				return false;
+			}
+			
+			q = result.ptr;
+		}
+		
+		else {
+			number = mantissa / powers_of_ten [fraction_count];
+		}
+		
+		number = is_negative ? -number : number;
+		p = q;
+		return true;
+	}
+	
+	bool ReadValue (UdmfValue& value, const UdmfNameTable& names) {
+		if(!SkipSpace() || end <= p) {
+			return false;
+		}
+		
+		value.number = 0;
+		value.text = nullptr;
+		value.length = 0;
+		value.is_true = false;
+		
+		if('"' == *p) {
+			const char* string_end = FindStringEnd(p + 1, end);
+			
+			if(!string_end) {
+				return false;
+			}
+			
+			value.text = p + 1;
+			value.length = string_end - value.text;
+			p = string_end + 1;
+			return true;
+		}
+		
+		if(IsNameStart(*p)) {
+			const char* name = p;
+			std::size_t length = 0;
+			ReadName(name, length);
+			value.is_true = udmf_true == names.Find(name, length).name;
+			return true;
+		}
+		
+		if(!ReadNumber(value.number)) {
+			return false;
+		}
+		
+		value.is_true = 0 != value.number;
+		return true;
+	}
+	
+	const char* p;
+	const char* end;
+};
+
+// Negative references mean none, and so do ones past 32 bits.
+static std::uint32_t ToIndex (double value) {
+	return value < 0 || 4294967295.0 <= value ? DoomMap::no_index : static_cast <std::uint32_t> (value);
+}
+
+// 16 bit fields wrap like the binary lumps, and values outside of any integer are clamped first.
+static std::uint16_t ToField (double value) {
+	return static_cast <std::uint16_t> (static_cast <std::int32_t> (std::clamp(value, -2147483648.0, 2147483647.0)));
+}
+
+static std::int32_t ToArg (double value) {
+	return static_cast <std::int32_t> (std::clamp(value, -2147483648.0, 2147483647.0));
+}
+
+static void SetFlag (std::uint16_t& flags, std::uint16_t flag, bool is_set) {
+	flags = is_set ? flags | flag : flags & ~flag;
+}
+
+// Adds a record with the UDMF defaults for a block.
+static void BeginBlock (UdmfName kind, DoomMap& map) {
+	static const std::uint64_t no_texture = DoomWad::LumpKey("-");
+	
+	switch(kind) {
+		case udmf_vertex:
+			map.vertex_x.push_back(0);
+			map.vertex_y.push_back(0);
+			break;
+		
+		case udmf_linedef:
+			map.linedef_v1.push_back(DoomMap::no_index);
+			map.linedef_v2.push_back(DoomMap::no_index);
+			map.linedef_flags.push_back(0);
+			map.linedef_special.push_back(0);
+			map.linedef_tag.push_back(0);
+			map.linedef_front.push_back(DoomMap::no_index);
+			map.linedef_back.push_back(DoomMap::no_index);
+			map.linedef_args.resize(map.linedef_args.size() + special_arg_count);
+			break;
+		
+		case udmf_sidedef:
+			map.sidedef_x_offset.push_back(0);
+			map.sidedef_y_offset.push_back(0);
+			map.sidedef_upper.push_back(no_texture);
+			map.sidedef_lower.push_back(no_texture);
+			map.sidedef_middle.push_back(no_texture);
+			map.sidedef_sector.push_back(DoomMap::no_index);
+			break;
+		
+		case udmf_sector:
+			map.sector_floor_height.push_back(0);
+			map.sector_ceiling_height.push_back(0);
+			map.sector_floor_flat.push_back(0);
+			map.sector_ceiling_flat.push_back(0);
+			map.sector_light.push_back(160);
+			map.sector_special.push_back(0);
+			map.sector_tag.push_back(0);
+			break;
+		
+		case udmf_thing:
+			map.thing_x.push_back(0);
+			map.thing_y.push_back(0);
+			map.thing_angle.push_back(0);
+			map.thing_type.push_back(0);
+			map.thing_flags.push_back(udmf_not_single_flag);
+			map.thing_z.push_back(0);
+			map.thing_tid.push_back(0);
+			map.thing_special.push_back(0);
+			map.thing_args.resize(map.thing_args.size() + special_arg_count);
+			break;
+		
+		default:
+			break;
+	}
+}
+
+// Stores a field into the newest record of the block kind. Fields of other blocks are ignored.
+static void SetField (UdmfName kind, const UdmfNameInfo& field, const UdmfValue& value, DoomMap& map) {
+	// Texture names are not case sensitive in UDMF, lump names are upper case.
+	auto name = [&] () {
+		char upper [8] = {};
+		
+		for(std::size_t k = 0; k < value.length && k < 8; k++) {
+			upper [k] = 'a' <= value.text [k] && value.text [k] <= 'z' ? value.text [k] - 'a' + 'A' : value.text [k];
+		}
+		
+		return DoomWad::LumpKey(upper, 8);
+	};
+	
+	if(udmf_vertex == kind) {
+		switch(field.name) {
+			case udmf_x: map.vertex_x.back() = value.number; break;
+			case udmf_y: map.vertex_y.back() = value.number; break;
+			default: break;
+		}
+	}
+	
+	else if(udmf_linedef == kind) {
+		switch(field.name) {
+			case udmf_v1: map.linedef_v1.back() = ToIndex(value.number); break;
+			case udmf_v2: map.linedef_v2.back() = ToIndex(value.number); break;
+			case udmf_sidefront: map.linedef_front.back() = ToIndex(value.number); break;
+			case udmf_sideback: map.linedef_back.back() = ToIndex(value.number); break;
+			case udmf_special: map.linedef_special.back() = ToField(value.number); break;
+			case udmf_id: map.linedef_tag.back() = ToField(std::max(0.0, value.number)); break;
+			case udmf_line_flag: SetFlag(map.linedef_flags.back(), field.flag, value.is_true); break;
+			case udmf_arg: map.linedef_args.end() [field.flag - special_arg_count] = ToArg(value.number); break;
+			default: break;
+		}
+	}
+	
+	else if(udmf_sidedef == kind) {
+		switch(field.name) {
+			case udmf_offsetx: map.sidedef_x_offset.back() = value.number; break;
+			case udmf_offsety: map.sidedef_y_offset.back() = value.number; break;
+			case udmf_texturetop: map.sidedef_upper.back() = name(); break;
+			case udmf_texturebottom: map.sidedef_lower.back() = name(); break;
+			case udmf_texturemiddle: map.sidedef_middle.back() = name(); break;
+			case udmf_sector: map.sidedef_sector.back() = ToIndex(value.number); break;
+			default: break;
+		}
+	}
+	
+	else if(udmf_sector == kind) {
+		switch(field.name) {
+			case udmf_heightfloor: map.sector_floor_height.back() = value.number; break;
+			case udmf_heightceiling: map.sector_ceiling_height.back() = value.number; break;
+			case udmf_texturefloor: map.sector_floor_flat.back() = name(); break;
+			case udmf_textureceiling: map.sector_ceiling_flat.back() = name(); break;
+			case udmf_lightlevel: map.sector_light.back() = ToField(value.number); break;
+			case udmf_special: map.sector_special.back() = ToField(value.number); break;
+			case udmf_id: map.sector_tag.back() = ToField(std::max(0.0, value.number)); break;
+			default: break;
+		}
+	}
+	
+	else if(udmf_thing == kind) {
+		switch(field.name) {
+			case udmf_x: map.thing_x.back() = value.number; break;
+			case udmf_y: map.thing_y.back() = value.number; break;
+			case udmf_angle: map.thing_angle.back() = value.number * SpaceConst::DegToRadFactor(); break;
+			case udmf_type: map.thing_type.back() = ToField(value.number); break;
+			case udmf_height: map.thing_z.back() = value.number; break;
+			case udmf_id: map.thing_tid.back() = ToField(std::max(0.0, value.number)); break;
+			case udmf_special: map.thing_special.back() = ToField(value.number); break;
+			case udmf_arg: map.thing_args.end() [field.flag - special_arg_count] = ToArg(value.number); break;
+			case udmf_thing_flag: SetFlag(map.thing_flags.back(), field.flag, value.is_true); break;
+			
+			// Two skills share a vanilla bit, either sets it and false leaves it to the other.
+			case udmf_skill_flag: map.thing_flags.back() |= value.is_true ? field.flag : 0; break;
+			
+			case udmf_single: SetFlag(map.thing_flags.back(), field.flag, !value.is_true); break;
+			default: break;
+		}
+	}
+}
+
+UdmfParser::UdmfParser () {
+	error_offset = 0;
+	block_count = 0;
+}
+
+bool UdmfParser::Parse (const char* text, std::size_t size, DoomMap& map) {
+	static const UdmfNameTable names;
+	UdmfScanner scanner { text, text + size };
+	error_offset = 0;
+	block_count = 0;
+	map_namespace.clear();
+	
+	auto fail = [&] () {
+		error_offset = scanner.p - text;
+		return false;
+	};
+	
+	// The text is a list of global assignments and blocks of assignments.
+	while(scanner.SkipSpace() && scanner.p < scanner.end) {
+		const char* name = nullptr;
+		std::size_t length = 0;
+		UdmfValue value;
+		
+		if(!scanner.ReadName(name, length) || !scanner.SkipSpace() || scanner.end <= scanner.p) {
+			return fail();
+		}
+		
+		const auto& global = names.Find(name, length);
+		
+		if('=' == *scanner.p) {
+			scanner.p++;
+			
+			if(!scanner.ReadValue(value, names) || !scanner.Expect(';')) {
+				return fail();
+			}
+			
+			if(udmf_namespace == global.name && value.text) {
+				map_namespace.assign(value.text, value.length);
+			}
+			
+			continue;
+		}
+		
+		if(!scanner.Expect('{')) {
+			return fail();
+		}
+		
+		BeginBlock(global.name, map);
+		block_count++;
+		
+		while(!scanner.Expect('}')) {
+			if(!scanner.ReadName(name, length) || !scanner.Expect('=') || !scanner.ReadValue(value, names) || !scanner.Expect(';')) {
+				return fail();
+			}
+			
+			SetField(global.name, names.Find(name, length), value, map);
+		}
+	}
+	
+	return scanner.p == scanner.end || fail();
+}
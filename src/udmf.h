@@ -0,0 +1,29 @@
+#ifndef UDMF_H
+#define UDMF_H
+
+#include <cstddef>
+#include <string>
+#include "doom_map.h"
+
+// Parser for TEXTMAP lumps, the UDMF text format that modern maps use in place of the binary
+// map lumps. The text is scanned where it lies without copying it or making strings of its
+// tokens. Runs of spaces, names and strings are scanned 16 bytes at a time with SSE2, and field
+// names are looked up in a fixed hash table that turns them into small ids. Fields that are not
+// known are skipped.
+//
+// Records go into the same arrays the binary lumps decode into. Line and thing flags are the
+// vanilla bits built from the UDMF flag fields, missing sides are no_index and coordinates keep
+// their fractions.
+struct UdmfParser {
+	UdmfParser ();
+	
+	// Appends the blocks of the text to the map. Stops at the first syntax error and returns
+	// false, keeping the fields read before it, with error_offset at the byte it stopped on.
+	bool Parse (const char* text, std::size_t size, DoomMap& map);
+	
+	std::string map_namespace;
+	std::size_t error_offset;
+	int block_count;
+};
+
+#endif
@@ -33,7 +33,7 @@ Vec2 <X> Vec2 <X>::Abs () const {
 
 template <typename X>
 Vec2 <X> Vec2 <X>::operator- () const {
-	return Vec2 <X> (x, y);
+	return Vec2 <X> (-x, -y);
 }
 
 template <typename X>
@@ -92,3 +92,13 @@ Vec2 <X> DegVec2 (double deg) {
 	auto rad = DegToRad(deg);
 	return Vec2 <X> (cos(rad), sin(rad));
 }
+
+// The types in use, compiled once here.
+template struct Vec2 <float>;
+template struct Vec2 <double>;
+template Vec2 <float> operator* (double f, const Vec2 <float>& v);
+template Vec2 <double> operator* (double f, const Vec2 <double>& v);
+template Vec2 <float> RadVec2 <float> (double rad);
+template Vec2 <double> RadVec2 <double> (double rad);
+template Vec2 <float> DegVec2 <float> (double deg);
+template Vec2 <double> DegVec2 <double> (double deg);
@@ -0,0 +1,168 @@
+#include "wad_catalog.h"
+#include "file_helper.h"
+#include "hash_helper.h"
+#include "udmf.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+// The file is this header, the map records and then the wad paths, each ended by a null byte.
+struct CatalogHeader {
+	char magic [4];
+	std::uint32_t version;
+	std::uint32_t wad_count;
+	std::uint32_t map_count;
+	std::uint64_t path_bytes;
+};
+
+static constexpr char catalog_magic [4] = { 'W', 'C', 'A', 'T' };
+static constexpr std::uint32_t catalog_version = 1;
+
+void WadCatalog::ScanWad (const DoomWad& wad, std::uint32_t wad_index, std::vector <CatalogMap>& wad_maps, std::uint64_t& bytes_read) {
+	static const std::uint64_t vertexes_key = DoomWad::LumpKey("VERTEXES");
+	static const std::uint64_t linedefs_key = DoomWad::LumpKey("LINEDEFS");
+	static const std::uint64_t things_key = DoomWad::LumpKey("THINGS");
+	static const std::uint64_t textmap_key = DoomWad::LumpKey("TEXTMAP");
+	
+	for(const auto& map_info: wad.maps) {
+		CatalogMap map;
+		std::memset(&map, 0, sizeof(map));
+		map.name_key = map_info.key;
+		map.wad_index = wad_index;
+		
+		wad.PageInLumps(map_info.first_lump, map_info.end_lump - map_info.first_lump);
+		
+		for(int k = map_info.first_lump; k < map_info.end_lump; k++) {
+			const auto& lump = wad.Lump(k);
+			
+			if(!wad.IsLumpValid(lump)) {
+				continue;
+			}
+			
+			const char* lump_data = wad.LumpData(lump);
+			auto key = wad.lump_keys [k];
+			map.content_hash = HashBytes(&key, sizeof(key), map.content_hash);
+			map.content_hash = HashBytes(lump_data, lump.size, map.content_hash);
+			bytes_read += lump.size;
+			
+			if(linedefs_key == key) {
+				map.linedef_count = lump.size / LinedefRecordSize(map_info.format);
+			}
+			
+			else if(things_key == key) {
+				map.thing_count = lump.size / ThingRecordSize(map_info.format);
+			}
+			
+			else if(vertexes_key == key) {
+				map.vertex_count = lump.size / 4;
+				
+				short min_x = std::numeric_limits <short>::max();
+				short min_y = min_x;
+				short max_x = std::numeric_limits <short>::min();
+				short max_y = max_x;
+				
+				for(std::uint32_t v = 0; v < map.vertex_count; v++) {
+					short xy [2];
+					std::memcpy(xy, lump_data + 4 * v, sizeof(xy));
+					min_x = std::min(min_x, xy [0]);
+					max_x = std::max(max_x, xy [0]);
+					min_y = std::min(min_y, xy [1]);
+					max_y = std::max(max_y, xy [1]);
+				}
+				
+				if(0 < map.vertex_count) {
+					map.min_x = min_x;
+					map.min_y = min_y;
+					map.max_x = max_x;
+					map.max_y = max_y;
+				}
+			}
+			
+			// UDMF maps only have their counts and bounds after parsing.
+			else if(textmap_key == key) {
+				DoomMap text_map;
+				UdmfParser().Parse(lump_data, lump.size, text_map);
+				map.vertex_count = text_map.VertexCount();
+				map.linedef_count = text_map.LinedefCount();
+				map.thing_count = text_map.ThingCount();
+				
+				auto clamp_short = [] (float value) {
+					return static_cast <short> (std::clamp <float> (value, std::numeric_limits <short>::min(), std::numeric_limits <short>::max()));
+				};
+				
+				if(0 < map.vertex_count) {
+					auto x_range = std::minmax_element(text_map.vertex_x.begin(), text_map.vertex_x.end());
+					auto y_range = std::minmax_element(text_map.vertex_y.begin(), text_map.vertex_y.end());
+					map.min_x = clamp_short(*x_range.first);
+					map.min_y = clamp_short(*y_range.first);
+					map.max_x = clamp_short(*x_range.second);
+					map.max_y = clamp_short(*y_range.second);
+				}
+			}
+		}
+		
+		wad_maps.push_back(map);
+	}
+}
+
+bool WadCatalog::Save (const std::string& path) const {
+	std::string path_table;
+	
+	for(const auto& wad_path: wad_paths) {
+		path_table += wad_path;
+		path_table.push_back('\0');
+	}
+	
+	CatalogHeader header;
+	std::copy(catalog_magic, catalog_magic + 4, header.magic);
+	header.version = catalog_version;
+	header.wad_count = wad_paths.size();
+	header.map_count = maps.size();
+	header.path_bytes = path_table.size();
+	
+	std::ofstream f(path, std::ios::binary);
+	f.write(reinterpret_cast <const char*> (&header), sizeof(header));
+	f.write(reinterpret_cast <const char*> (maps.data()), sizeof(CatalogMap) * maps.size());
+	f.write(path_table.data(), path_table.size());
+	return f.good();
+}
+
+bool WadCatalog::Load (const std::string& path) {
+	std::vector <char> file;
+	wad_paths.clear();
+	maps.clear();
+	
+	if(!SlurpByteFile(file, path) || file.size() < sizeof(CatalogHeader)) {
+		return false;
+	}
+	
+	CatalogHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	
+	std::size_t map_bytes = sizeof(CatalogMap) * static_cast <std::size_t> (header.map_count);
+	
+	if(
+	!std::equal(catalog_magic, catalog_magic + 4, header.magic) ||
+	catalog_version != header.version ||
+	file.size() != sizeof(header) + map_bytes + header.path_bytes) {
+		return false;
+	}
+	
+	maps.resize(header.map_count);
+	std::memcpy(maps.data(), file.data() + sizeof(header), map_bytes);
+	
+	const char* path_table = file.data() + sizeof(header) + map_bytes;
+	const char* path_table_end = path_table + header.path_bytes;
+	
+	while(path_table < path_table_end) {
+		const char* path_end = std::find(path_table, path_table_end, '\0');
+		wad_paths.emplace_back(path_table, path_end);
+		path_table = path_end + 1;
+	}
+	
+	// Every map has to point at a wad.
+	return
+		wad_paths.size() == header.wad_count &&
+		std::all_of(maps.begin(), maps.end(), [&] (const CatalogMap& m) { return m.wad_index < wad_paths.size(); });
+}
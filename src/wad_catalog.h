@@ -0,0 +1,38 @@
+#ifndef WAD_CATALOG_H
+#define WAD_CATALOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "wad_file.h"
+
+// Summary of one map. Fixed size, the catalog file stores these as they are in memory.
+struct CatalogMap {
+	std::uint64_t name_key;
+	std::uint64_t content_hash;
+	std::uint32_t wad_index;
+	std::uint32_t vertex_count;
+	std::uint32_t linedef_count;
+	std::uint32_t thing_count;
+	std::int16_t min_x;
+	std::int16_t min_y;
+	std::int16_t max_x;
+	std::int16_t max_y;
+};
+
+// A compact index over the maps of many wads, so questions like which wads have a map with more
+// than 20000 lines are answered without opening any wad.
+struct WadCatalog {
+	
+	// Summarise every map of a wad. The content hash covers all lumps of the map in directory
+	// order. Adds the number of lump bytes read to bytes_read.
+	static void ScanWad (const DoomWad& wad, std::uint32_t wad_index, std::vector <CatalogMap>& wad_maps, std::uint64_t& bytes_read);
+	
+	bool Save (const std::string& path) const;
+	bool Load (const std::string& path);
+	
+	std::vector <std::string> wad_paths;
+	std::vector <CatalogMap> maps;
+};
+
+#endif
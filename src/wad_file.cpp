@@ -1,19 +1,115 @@
 #include "wad_file.h"
 #include "file_helper.h"
+#include <algorithm>
+#include <utility>
+
+static int LumpKeySlot (std::uint64_t key, int slot_mask) {
+	
+	// Fibonacci hashing. The high bits of the product depend on every byte of the name.
+	return static_cast <int> ((key * 0x9E3779B97F4A7C15ULL) >> 40) & slot_mask;
+}
+
+LumpKeyTable::LumpKeyTable () {
+	slot_mask = 0;
+	used_count = 0;
+}
+
+void LumpKeyTable::Reset (int expected_count) {
+	
+	// Keep the table at most half full so probe chains stay short.
+	int slot_count = 16;
+	
+	while(slot_count < 2 * expected_count) {
+		slot_count *= 2;
+	}
+	
+	keys.assign(slot_count, 0);
+	values.assign(slot_count, -1);
+	slot_mask = slot_count - 1;
+	used_count = 0;
+}
+
+int LumpKeyTable::Find (std::uint64_t key) const {
+	if(values.empty()) {
+		return -1;
+	}
+	
+	for(int slot = LumpKeySlot(key, slot_mask); ; slot = (slot + 1) & slot_mask) {
+		if(values [slot] < 0 || keys [slot] == key) {
+			return values [slot];
+		}
+	}
+}
+
+int LumpKeyTable::Insert (std::uint64_t key, int value) {
+	if(values.size() <= 2 * (used_count + 1)) {
+		auto old_keys = std::move(keys);
+		auto old_values = std::move(values);
+		Reset(used_count + 1);
+		
+		for(std::size_t k = 0; k < old_values.size(); k++) {
+			if(0 <= old_values [k]) {
+				Insert(old_keys [k], old_values [k]);
+			}
+		}
+	}
+	
+	int slot = LumpKeySlot(key, slot_mask);
+	
+	while(0 <= values [slot] && keys [slot] != key) {
+		slot = (slot + 1) & slot_mask;
+	}
+	
+	if(values [slot] < 0) {
+		keys [slot] = key;
+		values [slot] = value;
+		used_count++;
+	}
+	
+	return values [slot];
+}
 
 DoomWad::DoomWad () {
+	bytes = nullptr;
+	byte_count = 0;
 	ParseHeader();
 }
 
-DoomWad::DoomWad (std::string path) {
-	SlurpByteFile(data, path);
+DoomWad::DoomWad (std::string path, bool map_file) : path(path) {
+	if(map_file && mapping.Open(path)) {
+		bytes = mapping.data;
+		byte_count = mapping.size;
+	}
+	
+	else {
+		SlurpByteFile(data, path);
+		bytes = data.data();
+		byte_count = data.size();
+	}
+	
+	ParseHeader();
+}
+
+DoomWad::DoomWad (std::vector <char> data) : data(std::move(data)) {
+	bytes = this->data.data();
+	byte_count = this->data.size();
+	ParseHeader();
+}
+
+DoomWad::DoomWad (const char* bytes, std::size_t byte_count) {
+	this->bytes = bytes;
+	this->byte_count = byte_count;
 	ParseHeader();
 }
 
 void DoomWad::ParseHeader () {
+	lump_exists = false;
+	current_lump = nullptr;
+	lump_pos = 0;
+	
 	// The DOOM wad header is 4 bytes of identification, followed by the count of lumps and
 	// the location of the directory list. It can only be PWAD or IWAD.
-	if(data.size() < 12) {
+	if(byte_count < 12) {
 		header [0] = ' ';
 		header [1] = ' ';
 		header [2] = ' ';
@@ -23,12 +119,12 @@ void DoomWad::ParseHeader () {
 	}
 	
 	else {
-		header [0] = data [0];
-		header [1] = data [1];
-		header [2] = data [2];
-		header [3] = data [3];
-		lump_count = *reinterpret_cast <int*> (&data [4]);
-		table_offset = *reinterpret_cast <int*> (&data [8]);
+		header [0] = bytes [0];
+		header [1] = bytes [1];
+		header [2] = bytes [2];
+		header [3] = bytes [3];
+		lump_count = *reinterpret_cast <const int*> (&bytes [4]);
+		table_offset = *reinterpret_cast <const int*> (&bytes [8]);
 	}
 	
 	// Determine correctness of wad header.
@@ -44,45 +140,156 @@ void DoomWad::ParseHeader () {
 	else {
 		has_wad_data = false;
 	}
+	
+	// The directory has to lie inside the file. A mapped file would fault on reading past its end.
+	std::size_t table_size = sizeof(LumpInfo) * static_cast <std::size_t> (std::max(0, lump_count));
+	
+	if(lump_count < 0 || table_offset < 0 || byte_count < table_offset + table_size) {
+		has_wad_data = false;
+		lump_count = 0;
+		table_offset = 0;
+	}
+	
+	// Only the directory is needed up front, lumps are paged in when a map asks for them.
+	if(has_wad_data && IsMapped()) {
+		mapping.AdviseRandom();
+		mapping.AdviseWillNeed(table_offset, table_size);
+	}
+	
+	if(!has_wad_data) {
+		lump_count = 0;
+	}
+	
+	BuildIndex();
+}
+
+void DoomWad::BuildIndex () {
+	lump_keys.resize(lump_count);
+	name_table.Reset(lump_count);
+	
+	// Give every distinct name an id and count how often it occurs.
+	std::vector <int> lump_name_ids(lump_count);
+	std::vector <int> name_counts;
+	
+	for(int k = 0; k < lump_count; k++) {
+		lump_keys [k] = LumpKey(Lump(k).name, 8);
+		int name_id = name_table.Insert(lump_keys [k], name_counts.size());
+		
+		if(name_id == name_counts.size()) {
+			name_counts.push_back(0);
+		}
+		
+		name_counts [name_id]++;
+		lump_name_ids [k] = name_id;
+	}
+	
+	// Prefix sums give each name its range. Filling them in directory order keeps every range
+	// sorted, so searching from a position is a binary search.
+	name_first.assign(name_counts.size() + 1, 0);
+	
+	for(std::size_t k = 0; k < name_counts.size(); k++) {
+		name_first [k + 1] = name_first [k] + name_counts [k];
+	}
+	
+	std::vector <int> name_fill(name_first.begin(), name_first.end() - 1);
+	name_lumps.resize(lump_count);
+	
+	for(int k = 0; k < lump_count; k++) {
+		name_lumps [name_fill [lump_name_ids [k]]++] = k;
+	}
+	
+	// A map is a marker followed by THINGS for binary maps or TEXTMAP for UDMF maps. Binary
+	// maps end at the first lump that is not a map lump, UDMF maps end with ENDMAP. Binary maps
+	// with a BEHAVIOR lump are in Hexen format.
+	static const std::uint64_t things_key = LumpKey("THINGS");
+	static const std::uint64_t textmap_key = LumpKey("TEXTMAP");
+	static const std::uint64_t endmap_key = LumpKey("ENDMAP");
+	static const std::uint64_t behavior_key = LumpKey("BEHAVIOR");
+	static const std::uint64_t binary_map_keys [] = {
+		LumpKey("THINGS"), LumpKey("LINEDEFS"), LumpKey("SIDEDEFS"), LumpKey("VERTEXES"),
+		LumpKey("SEGS"), LumpKey("SSECTORS"), LumpKey("NODES"), LumpKey("SECTORS"),
+		LumpKey("REJECT"), LumpKey("BLOCKMAP"), LumpKey("BEHAVIOR"), LumpKey("SCRIPTS")
+	};
+	
+	auto is_binary_map_key = [] (std::uint64_t key) {
+		return std::end(binary_map_keys) != std::find(std::begin(binary_map_keys), std::end(binary_map_keys), key);
+	};
+	
+	maps.clear();
+	map_table.Reset(0);
+	
+	for(int k = 0; k + 1 < lump_count; k++) {
+		auto next_key = lump_keys [k + 1];
+		
+		if(things_key != next_key && textmap_key != next_key) {
+			continue;
+		}
+		
+		MapInfo map;
+		map.key = lump_keys [k];
+		map.marker_lump = k;
+		map.first_lump = k + 1;
+		map.end_lump = k + 1;
+		map.format = doom_map_format;
+		
+		if(textmap_key == next_key) {
+			map.format = udmf_map_format;
+			
+			while(map.end_lump < lump_count && endmap_key != lump_keys [map.end_lump]) {
+				map.end_lump++;
+			}
+			
+			map.end_lump = std::min(lump_count, map.end_lump + 1);
+		}
+		
+		else {
+			while(map.end_lump < lump_count && is_binary_map_key(lump_keys [map.end_lump])) {
+				if(behavior_key == lump_keys [map.end_lump]) {
+					map.format = hexen_map_format;
+				}
+				
+				map.end_lump++;
+			}
+		}
+		
+		// The first marker with a name wins, the same as searching the directory from the top.
+		map_table.Insert(map.key, maps.size());
+		maps.push_back(map);
+		k = map.end_lump - 1;
+	}
 }
 
 bool DoomWad::IsLoaded () const {
-	return has_wad_data && 12 <= data.size();
+	return has_wad_data && 12 <= byte_count;
+}
+
+bool DoomWad::IsMapped () const {
+	return mapping.IsOpen();
 }
 
 void DoomWad::BeginLumpSearch () {
 	lump_pos = 0;
-	current_lump = reinterpret_cast <LumpInfo*> (&data [table_offset]);
+	current_lump = reinterpret_cast <const LumpInfo*> (&bytes [table_offset]);
 }
 
 bool DoomWad::FindLump (std::string name) {
-	char buffer [8] = { '\0' };
 	lump_exists = false;
 	
 	if(lump_count <= lump_pos) {
 		return false;
 	}
 	
-	int name_count = std::min(8ULL, name.size());
-	std::copy(name.begin(), name.begin() + name_count, buffer);
-	bool searching = true;
+	int found_lump = FindLumpIndex(LumpKey(name), lump_pos);
 	
-	while(searching) {
-		
-		if(std::equal(buffer, buffer + 8, current_lump->name)) {
-			searching = false;
-		}
-		
-		else {
-			current_lump++;
-			lump_pos++;
-			
-			if(lump_count <= lump_pos) {
-				return false;
-			}
-		}
+	// Like a search to the end of the directory, nothing is left to find after a miss.
+	if(found_lump < 0) {
+		lump_pos = lump_count;
+		current_lump = &Lump(0) + lump_count;
+		return false;
 	}
 	
+	lump_pos = found_lump;
+	current_lump = &Lump(found_lump);
 	lump_exists = true;
 	return true;
 }
@@ -90,3 +297,94 @@ bool DoomWad::FindLump (std::string name) {
 bool DoomWad::LumpExists () const {
 	return lump_exists;
 }
+
+std::uint64_t DoomWad::LumpKey (const char* name, std::size_t count) {
+	std::uint64_t key = 0;
+	
+	for(std::size_t k = 0; k < count && k < 8 && '\0' != name [k]; k++) {
+		key |= static_cast <std::uint64_t> (static_cast <unsigned char> (name [k])) << (8 * k);
+	}
+	
+	return key;
+}
+
+std::uint64_t DoomWad::LumpKey (const std::string& name) {
+	return LumpKey(name.data(), name.size());
+}
+
+std::string DoomWad::LumpKeyName (std::uint64_t key) {
+	std::string name;
+	
+	for(; 0 != key; key >>= 8) {
+		name.push_back(static_cast <char> (key & 0xFF));
+	}
+	
+	return name;
+}
+
+const DoomWad::LumpInfo& DoomWad::Lump (int lump_index) const {
+	return reinterpret_cast <const LumpInfo*> (&bytes [table_offset]) [lump_index];
+}
+
+std::string DoomWad::LumpName (int lump_index) const {
+	const char* name = Lump(lump_index).name;
+	return std::string(name, std::find(name, name + 8, '\0'));
+}
+
+int DoomWad::FindLumpIndex (std::uint64_t key, int from_lump) const {
+	int name_id = name_table.Find(key);
+	
+	if(name_id < 0) {
+		return -1;
+	}
+	
+	auto begin = name_lumps.begin() + name_first [name_id];
+	auto end = name_lumps.begin() + name_first [name_id + 1];
+	auto found = std::lower_bound(begin, end, from_lump);
+	return end == found ? -1 : *found;
+}
+
+int DoomWad::FindMapIndex (std::uint64_t key) const {
+	return map_table.Find(key);
+}
+
+// A map only has a dozen lumps, so a scan over its range costs the same for any wad size.
+int DoomWad::FindMapLump (int map_index, std::uint64_t key) const {
+	if(map_index < 0 || maps.size() <= map_index) {
+		return -1;
+	}
+	
+	const auto& map = maps [map_index];
+	
+	for(int k = map.first_lump; k < map.end_lump; k++) {
+		if(key == lump_keys [k]) {
+			return k;
+		}
+	}
+	
+	return -1;
+}
+
+bool DoomWad::IsLumpValid (const LumpInfo& lump) const {
+	return
+		0 <= lump.offset && 0 <= lump.size &&
+		static_cast <std::size_t> (lump.offset) + lump.size <= byte_count;
+}
+
+const char* DoomWad::LumpData (const LumpInfo& lump) const {
+	return bytes + lump.offset;
+}
+
+void DoomWad::PageInLump (const LumpInfo& lump) const {
+	if(IsMapped() && IsLumpValid(lump)) {
+		mapping.AdviseWillNeed(lump.offset, lump.size);
+	}
+}
+
+void DoomWad::PageInLumps (int first_lump, int count) const {
+	first_lump = std::max(0, first_lump);
+	int last_lump = std::min(lump_count, first_lump + count);
+	for(int k = first_lump; k < last_lump; k++) {
+		PageInLump(Lump(k));
+	}
+}
@@ -1,22 +1,62 @@
 #ifndef WAD_FILE_H
 #define WAD_FILE_H
 
+#include "file_helper.h"
+#include "map_records.h"
 #include <string>
 #include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Open addressing hash table from packed 64 bit lump names to an int value. Used for the wad
+// directory index, so it only grows and never removes keys.
+struct LumpKeyTable {
+	LumpKeyTable ();
+	
+	void Reset (int expected_count);
+	int Find (std::uint64_t key) const;
+	
+	// Returns the value stored for the key. If the key is new it is inserted with the given value.
+	int Insert (std::uint64_t key, int value);
+	
+	std::vector <std::uint64_t> keys;
+	std::vector <int> values;
+	int slot_mask;
+	int used_count;
+};
 
 struct DoomWad {
 	
 	// Empty wad file.
 	DoomWad ();
 	
-	// Read from file.
-	DoomWad (std::string path);
+	// Read from file. The file is memory mapped so only the directory and the lumps that are
+	// actually used get read from disk. If mapping fails the whole file is read into memory.
+	DoomWad (std::string path, bool map_file = true);
+	
+	// A wad held in memory, such as one read out of an archive. The first owns its bytes, the
+	// second only views them and the bytes have to outlive the wad.
+	DoomWad (std::vector <char> data);
+	DoomWad (const char* bytes, std::size_t byte_count);
 	
 	void ParseHeader ();
+	void BuildIndex ();
 	bool IsLoaded () const;
+	bool IsMapped () const;
 	
 	bool has_wad_data;
+	
+	// The file the wad was read from, empty for a wad in memory. Lump offsets are offsets
+	// into this file, so writers can copy lumps straight from it.
+	std::string path;
+	
+	// Storage. Either the file mapping or the data vector holds the bytes, and bytes points to
+	// whichever is used. Both keep their address when a DoomWad is moved. A view of bytes held
+	// elsewhere uses neither.
+	MappedFile mapping;
 	std::vector <char> data;
+	const char* bytes;
+	std::size_t byte_count;
 	
 	// Header info.
 	char header [4];
@@ -34,9 +74,51 @@ struct DoomWad {
 	bool FindLump (std::string name);
 	bool LumpExists () const;
 	
-	bool		lump_exists;
-	LumpInfo*	current_lump;
-	int			lump_pos;
+	// Lump names packed into 64 bits, up to the first null character. Eight bytes compare as one
+	// integer and hash well.
+	static std::uint64_t LumpKey (const char* name, std::size_t count);
+	static std::uint64_t LumpKey (const std::string& name);
+	static std::string LumpKeyName (std::uint64_t key);
+	
+	// A map marker and the range of lumps belonging to the map after it.
+	struct MapInfo {
+		std::uint64_t key;
+		int marker_lump;
+		int first_lump;
+		int end_lump;
+		MapFormat format;
+	};
+	
+	// Indexed directory lookups. These do not touch the lump iterator and are safe to use from
+	// several threads at once. All return -1 when nothing is found.
+	const LumpInfo& Lump (int lump_index) const;
+	std::string LumpName (int lump_index) const;
+	int FindLumpIndex (std::uint64_t key, int from_lump = 0) const;
+	int FindMapIndex (std::uint64_t key) const;
+	int FindMapLump (int map_index, std::uint64_t key) const;
+	
+	// Access to the bytes of a lump. Lumps pointing outside of the file are not valid.
+	bool IsLumpValid (const LumpInfo& lump) const;
+	const char* LumpData (const LumpInfo& lump) const;
+	
+	// Ask for lumps to be paged in ahead of reading them. Does nothing when the file is not mapped.
+	void PageInLump (const LumpInfo& lump) const;
+	void PageInLumps (int first_lump, int count) const;
+	
+	bool			lump_exists;
+	const LumpInfo*	current_lump;
+	int				lump_pos;
+	
+	// Directory index. Every distinct name gets an id in the name table, and the lumps with that
+	// name are listed in directory order in name_lumps [name_first [id] .. name_first [id + 1]).
+	std::vector <std::uint64_t> lump_keys;
+	LumpKeyTable name_table;
+	std::vector <int> name_first;
+	std::vector <int> name_lumps;
+	
+	// Maps in directory order, found by marker name through the map table.
+	std::vector <MapInfo> maps;
+	LumpKeyTable map_table;
 };
 
 #endif
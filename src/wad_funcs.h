@@ -0,0 +1,319 @@
+#ifndef WAD_FUNCS_H
+#define WAD_FUNCS_H
+
+#include <span>
+#include <string>
+#include <vector>
+#include "space.h"
+#include "file_helper.h"
+#include "wad_file.h"
+#include "doom_map.h"
+#include "map_grid.h"
+#include "map_tiles.h"
+#include "sector_mesh.h"
+#include "map_bsp.h"
+#include "profiler.h"
+#include "lump_kernels.h"
+
+// Everything the renderer needs to show a map, ready to be uploaded.
+struct MapPackage {
+	MapPackage () {
+		is_wad_loaded = false;
+		is_map_loaded = false;
+		map_index = 0;
+		flat_generation = -1;
+	}
+	
+	bool is_wad_loaded;
+	bool is_map_loaded;
+	int map_index;
+	std::string wad_path;
+	std::string map_name;
+	
+	// Every record of the map, for anything beyond drawing lines and things, and the grid for
+	// picking from it.
+	DoomMap map;
+	MapGrid grid;
+	
+	// The line indices to upload, sorted into tiles for culling.
+	MapTiles tiles;
+	
+	// Sectors as triangles, for filled floors.
+	SectorMesh sector_mesh;
+	
+	// The floor flat of every sector as a layer of the flat array built for the wad stack, -1 for
+	// flats it does not have. Layers are only good for the flat array of the same generation.
+	std::vector <int> sector_floor_layer;
+	int flat_generation;
+	
+	// The node builder's BSP tree, for subsector queries.
+	MapBsp bsp;
+	
+	std::vector <float> vertices;
+	std::vector <int> indices;
+	std::vector <float> things;
+	
+	// The arrays to draw. A decoded map views its own vectors, a map from the cache views its
+	// mapped cache entry and leaves the vectors empty.
+	MappedFile cache_entry;
+	std::span <const float> vertex_view;
+	std::span <const int> index_view;
+	std::span <const float> thing_view;
+	
+	void ViewOwnArrays () {
+		vertex_view = vertices;
+		index_view = indices;
+		thing_view = things;
+	}
+};
+
+struct WadFuncs {
+	WadFuncs () {
+		lump_data = nullptr;
+		lump_size = 0;
+		sector_thread_count = 0;
+	}
+	
+	const char* lump_data;
+	int lump_size;
+	
+	// Threads for triangulating sectors, zero for one per core. Callers that already decode
+	// maps on every core set one.
+	int sector_thread_count;
+	
+	// Find these lumps in the directory in order. For example, { "MAP01", "VERTEXES" } will search
+	// from the top of the wad directory for the VERTEXES lump of MAP01 and store the data and size
+	// of VERTEXES. The data points straight into the wad storage and stays valid as long as the
+	// wad does.
+	bool StoreLump (DoomWad& wad, std::vector <std::string> lump_order) {
+		wad.BeginLumpSearch();
+		
+		for(int k = 0; k < lump_order.size(); k++) {
+			const auto& lump_name = lump_order [k];
+			
+			if(!wad.FindLump(lump_name)) {
+				return false;
+			}
+			
+			// The last will be stored.
+			else if(k == lump_order.size() - 1) {
+				if(!wad.IsLumpValid(*wad.current_lump)) {
+					return false;
+				}
+				
+				wad.PageInLump(*wad.current_lump);
+				lump_data = wad.LumpData(*wad.current_lump);
+				lump_size = wad.current_lump->size;
+			}
+		}
+		
+		return true;
+	}
+	
+	// Store a lump of a map, for example the VERTEXES lump of MAP01. This uses the map index of
+	// the wad directory and does not depend on the size of the wad.
+	bool StoreMapLump (const DoomWad& wad, int map_index, const std::string& lump_name) {
+		int lump_index = wad.FindMapLump(map_index, DoomWad::LumpKey(lump_name));
+		
+		if(lump_index < 0 || !wad.IsLumpValid(wad.Lump(lump_index))) {
+			lump_data = nullptr;
+			lump_size = 0;
+			return false;
+		}
+		
+		const auto& lump = wad.Lump(lump_index);
+		lump_data = wad.LumpData(lump);
+		lump_size = lump.size;
+		return true;
+	}
+	
+	// Decode the vertices, lines and things of a map in the wad map index into the package views,
+	// all a thumbnail needs. The viewer adds the rest with DecodeMapModel. Only reads from the
+	// wad, so threads can share one.
+	bool BuildMapPackage (const DoomWad& wad, int map_index, MapPackage& package) {
+		package.is_map_loaded = false;
+		
+		if(map_index < 0 || wad.maps.size() <= map_index) {
+			return false;
+		}
+		
+		// Start reading the map lumps that follow the marker in the background.
+		const auto& map_info = wad.maps [map_index];
+		wad.PageInLumps(map_info.first_lump, map_info.end_lump - map_info.first_lump);
+		package.map_name = wad.LumpName(map_info.marker_lump);
+		
+		// UDMF maps are parsed once into the map records, the arrays to draw come from those.
+		if(udmf_map_format == map_info.format) {
+			{
+				Profiler::Scope scope("TEXTMAP");
+				package.map.Decode(wad, map_index);
+				MapRecordsToFloat(package);
+			}
+			
+			package.ViewOwnArrays();
+			package.is_map_loaded = true;
+			return true;
+		}
+		
+		// Every lump decode is timed on its own.
+		{
+			Profiler::Scope scope("VERTEXES");
+			StoreMapLump(wad, map_index, "VERTEXES");
+			package.vertices = VanillaVertexesLumpToFloat();
+		}
+		
+		{
+			Profiler::Scope scope("LINEDEFS");
+			StoreMapLump(wad, map_index, "LINEDEFS");
+			package.indices = VanillaLinedefsLumpToVertexIndices(map_info.format);
+		}
+		
+		{
+			Profiler::Scope scope("THINGS");
+			StoreMapLump(wad, map_index, "THINGS");
+			package.things = VanillaThingsLumpToFloat(map_info.format);
+		}
+		
+		package.ViewOwnArrays();
+		package.is_map_loaded = true;
+		return true;
+	}
+	
+	// Decode the full map records and their BSP tree, build the picking grid over them, tile the
+	// lines to draw and triangulate the sectors. Needs the package views in place. The records
+	// are kept when the map was decoded already, as BuildMapPackage does for UDMF maps.
+	void DecodeMapModel (const DoomWad& wad, int map_index, MapPackage& package, bool is_map_decoded = false) {
+		if(!is_map_decoded) {
+			Profiler::Scope scope("DoomMap::Decode");
+			package.map.Decode(wad, map_index);
+		}
+		
+		{
+			Profiler::Scope scope("MapBsp::Decode");
+			package.bsp.Decode(wad, map_index, package.map);
+		}
+		
+		{
+			Profiler::Scope scope("MapGrid::Build");
+			package.grid.Build(package.map);
+		}
+		
+		{
+			Profiler::Scope scope("MapTiles::Build");
+			package.tiles.Build(package.vertex_view, package.index_view);
+		}
+		
+		{
+			Profiler::Scope scope("SectorMesh::Build");
+			package.sector_mesh.Build(package.map, sector_thread_count);
+		}
+	}
+	
+	// The arrays to draw from decoded map records, in the layout the lump conversions produce.
+	void MapRecordsToFloat (MapPackage& package) {
+		const auto& map = package.map;
+		package.vertices.resize(2 * map.VertexCount());
+		package.indices.resize(2 * map.LinedefCount());
+		package.things.resize(3 * map.ThingCount());
+		
+		for(int v = 0; v < map.VertexCount(); v++) {
+			package.vertices [2 * v] = map.vertex_x [v];
+			package.vertices [2 * v + 1] = map.vertex_y [v];
+		}
+		
+		// Lines with a missing vertex collapse onto vertex 0 instead of pointing outside.
+		for(int l = 0; l < map.LinedefCount(); l++) {
+			package.indices [2 * l] = map.linedef_v1 [l] < map.VertexCount() ? map.linedef_v1 [l] : 0;
+			package.indices [2 * l + 1] = map.linedef_v2 [l] < map.VertexCount() ? map.linedef_v2 [l] : 0;
+		}
+		
+		for(int t = 0; t < map.ThingCount(); t++) {
+			package.things [3 * t] = map.thing_x [t];
+			package.things [3 * t + 1] = map.thing_y [t];
+			package.things [3 * t + 2] = map.thing_angle [t];
+		}
+	}
+	
+	// Convert VERTEXES lump into a list of float positions. Vanilla DOOM format, so it's short
+	// to float conversion, particularly good for open-gl.
+	std::vector <float> VanillaVertexesLumpToFloat () {
+		
+		struct vertexes_entry {
+			short x;
+			short y;
+		};
+		
+		int count = lump_size / sizeof(vertexes_entry);
+		int coord_count = count + count;
+		
+		// The whole lump goes through the fastest kernel for this CPU.
+		std::vector <float> float_xy(coord_count);
+		BestLumpKernels().vertexes_to_float(lump_data, count, float_xy.data());
+		
+		return float_xy;
+	}
+	
+	// Convert a map THINGS lump into a vector of { x pos, y pos, spawn angle radians } triplets.
+	// Records are in the layout of the binary map format, DOOM or Hexen.
+	std::vector <float> VanillaThingsLumpToFloat (MapFormat format = doom_map_format) {
+		int count = lump_size / ThingRecordSize(format);
+		int info_count = 3 * count; // x, y and radiant
+		
+		std::vector <float> float_thing(info_count);
+		BestLumpKernels().things_to_float [format] (lump_data, count, float_thing.data());
+		
+		return float_thing;
+	}
+	
+	// Convert a map LINEDEFS lump into a vector of indices into VERTEXES lump vertices. Records
+	// are in the layout of the binary map format, DOOM or Hexen.
+	std::vector <int> VanillaLinedefsLumpToVertexIndices (MapFormat format = doom_map_format) {
+		int count = lump_size / LinedefRecordSize(format);
+		int index_count = count + count;
+		std::vector <int> indices(index_count);
+		BestLumpKernels().linedefs_to_indices [format] (lump_data, count, indices.data());
+		
+		return indices;
+	}
+	
+	// Convert an index into a DOOM2 compatible map lump name ("MAP01" to "MAP32" inclusive).
+	void Doom2MapLumpName (std::string& buffer, int zero_based_map_index) {
+		static constexpr int map_count = 32;
+		zero_based_map_index %= map_count;
+		
+		if(zero_based_map_index < 0) {
+			zero_based_map_index += map_count;
+		}
+		
+		int map_num = 1 + zero_based_map_index;
+		buffer = "MAP01";
+		
+		buffer [3] = '0' + (map_num / 10);
+		buffer [4] = '0' + (map_num % 10);
+	}
+	
+	void UltimateDoomMapLumpName (std::string& buffer, int zero_based_episode_index, int zero_based_map_index) {
+		static constexpr int episode_count = 4;
+		static constexpr int map_count = 9;
+		
+		zero_based_episode_index %= episode_count;
+		zero_based_map_index %= map_count;
+		
+		if(zero_based_episode_index < 0) {
+			zero_based_episode_index += episode_count;
+		}
+		
+		if(zero_based_map_index < 0) {
+			zero_based_map_index += map_count;
+		}
+		
+		int episode_num = 1 + zero_based_episode_index;
+		int map_num = 1 + zero_based_map_index;
+		
+		buffer = "E1M1";
+		buffer [1] = '0' + (episode_num % 10);
+		buffer [3] = '0' + (map_num % 10);
+	}
+};
+
+#endif
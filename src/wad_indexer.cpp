@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wad_file.h"
+#include "wad_catalog.h"
+#include "work_pool.h"
+
+// Builds a catalog of every map in a directory tree of wads and answers questions from it.
+//
+//	wad_indexer scan <directory> <catalog file> [-j threads]
+//	wad_indexer query <catalog file> [-map NAME] [-min-lines N] [-min-things N] [-min-vertices N]
+struct WadIndexer {
+	
+	// Per thread counters, padded so that threads do not share cache lines.
+	struct alignas(64) ThreadCounters {
+		std::atomic <long long> wad_count;
+		std::atomic <long long> map_count;
+		std::atomic <long long> byte_count;
+		std::atomic <long long> busy_ns;
+	};
+	
+	static void FindWads (const std::string& directory, std::vector <std::string>& paths) {
+		namespace fs = std::filesystem;
+		std::error_code error;
+		auto options = fs::directory_options::skip_permission_denied;
+		
+		for(fs::recursive_directory_iterator it(directory, options, error), end; it != end; it.increment(error)) {
+			auto extension = it->path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			
+			if(".wad" == extension && it->is_regular_file(error)) {
+				paths.push_back(it->path().string());
+			}
+		}
+		
+		// Sorted so the same tree always gives the same catalog.
+		std::sort(paths.begin(), paths.end());
+	}
+	
+	int Scan (const std::string& directory, const std::string& catalog_path, int thread_count) {
+		auto start_time = std::chrono::steady_clock::now();
+		
+		WadCatalog catalog;
+		FindWads(directory, catalog.wad_paths);
+		
+		int wad_count = catalog.wad_paths.size();
+		std::vector <std::vector <CatalogMap>> wad_maps(wad_count);
+		
+		WorkPool pool(thread_count);
+		std::vector <ThreadCounters> counters(pool.thread_count);
+		std::atomic <int> done_count(0);
+		
+		for(auto& c: counters) {
+			c.wad_count = 0;
+			c.map_count = 0;
+			c.byte_count = 0;
+			c.busy_ns = 0;
+		}
+		
+		// Scan on the pool while this thread reports progress.
+		std::thread scan_thread( [&] () {
+			pool.Run(wad_count, [&] (int job, int thread) {
+				auto job_start = std::chrono::steady_clock::now();
+				std::uint64_t bytes_read = 0;
+				
+				DoomWad wad(catalog.wad_paths [job]);
+				WadCatalog::ScanWad(wad, job, wad_maps [job], bytes_read);
+				
+				auto& c = counters [thread];
+				c.wad_count++;
+				c.map_count += wad_maps [job].size();
+				c.byte_count += bytes_read;
+				c.busy_ns += std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::steady_clock::now() - job_start).count();
+				done_count++;
+			});
+		});
+		
+		auto seconds_since_start = [&] () {
+			return std::chrono::duration <double> (std::chrono::steady_clock::now() - start_time).count();
+		};
+		
+		while(done_count < wad_count) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+			
+			long long byte_count = 0;
+			
+			for(const auto& c: counters) {
+				byte_count += c.byte_count;
+			}
+			
+			std::cout << "\r" << done_count << " / " << wad_count << " wads, "
+				<< std::fixed << std::setprecision(1) << byte_count / 1e6 / std::max(1e-6, seconds_since_start()) << " MB/s   "
+				<< std::flush;
+		}
+		
+		scan_thread.join();
+		std::cout << std::endl;
+		
+		for(auto& m: wad_maps) {
+			catalog.maps.insert(catalog.maps.end(), m.begin(), m.end());
+		}
+		
+		if(!catalog.Save(catalog_path)) {
+			std::cout << "Could not write catalog: " << catalog_path << std::endl;
+			return 1;
+		}
+		
+		double seconds = seconds_since_start();
+		std::cout << "Indexed " << catalog.maps.size() << " maps in " << wad_count << " wads in " << seconds << " s" << std::endl;
+		
+		// Per thread throughput, to see how well the pool balances and how many cores pay off.
+		for(int t = 0; t < pool.thread_count; t++) {
+			const auto& c = counters [t];
+			double busy_seconds = c.busy_ns / 1e9;
+			
+			std::cout << "thread " << t << ": " << c.wad_count << " wads, " << c.map_count << " maps, "
+				<< c.byte_count / 1e6 << " MB, busy " << busy_seconds << " s, "
+				<< c.byte_count / 1e6 / std::max(1e-6, busy_seconds) << " MB/s" << std::endl;
+		}
+		
+		return 0;
+	}
+	
+	int Query (const std::string& catalog_path, int arg_count, char** args) {
+		std::uint64_t map_key = 0;
+		std::uint32_t min_lines = 0;
+		std::uint32_t min_things = 0;
+		std::uint32_t min_vertices = 0;
+		
+		for(int k = 0; k + 1 < arg_count; k += 2) {
+			std::string arg = args [k];
+			
+			if("-map" == arg) {
+				map_key = DoomWad::LumpKey(args [k + 1]);
+			}
+			
+			else if("-min-lines" == arg) {
+				min_lines = std::atoi(args [k + 1]);
+			}
+			
+			else if("-min-things" == arg) {
+				min_things = std::atoi(args [k + 1]);
+			}
+			
+			else if("-min-vertices" == arg) {
+				min_vertices = std::atoi(args [k + 1]);
+			}
+		}
+		
+		auto start_time = std::chrono::steady_clock::now();
+		WadCatalog catalog;
+		
+		if(!catalog.Load(catalog_path)) {
+			std::cout << "Could not read catalog: " << catalog_path << std::endl;
+			return 1;
+		}
+		
+		int match_count = 0;
+		
+		for(const auto& map: catalog.maps) {
+			if(
+			(0 == map_key || map_key == map.name_key) &&
+			min_lines <= map.linedef_count &&
+			min_things <= map.thing_count &&
+			min_vertices <= map.vertex_count) {
+				std::cout << catalog.wad_paths [map.wad_index] << " " << DoomWad::LumpKeyName(map.name_key)
+					<< " lines " << map.linedef_count << " things " << map.thing_count << " vertices " << map.vertex_count
+					<< " bounds " << map.min_x << " " << map.min_y << " " << map.max_x << " " << map.max_y
+					<< " hash " << std::hex << map.content_hash << std::dec << std::endl;
+				
+				match_count++;
+			}
+		}
+		
+		std::chrono::duration <double, std::milli> ms = std::chrono::steady_clock::now() - start_time;
+		std::cout << match_count << " of " << catalog.maps.size() << " maps match (" << ms.count() << " ms)" << std::endl;
+		return 0;
+	}
+};
+
+int main (int argc, char * argv []) {
+	WadIndexer indexer;
+	std::string command = 2 <= argc ? argv [1] : "";
+	
+	if("scan" == command && 4 <= argc) {
+		int thread_count = 6 <= argc && std::string("-j") == argv [4] ? std::atoi(argv [5]) : 0;
+		return indexer.Scan(argv [2], argv [3], thread_count);
+	}
+	
+	if("query" == command && 3 <= argc) {
+		return indexer.Query(argv [2], argc - 3, argv + 3);
+	}
+	
+	std::cout << "Usage: wad_indexer scan <directory> <catalog file> [-j threads]" << std::endl;
+	std::cout << "       wad_indexer query <catalog file> [-map NAME] [-min-lines N] [-min-things N] [-min-vertices N]" << std::endl;
+	return 1;
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "doom_map.h"
+#include "map_bsp.h"
+#include "node_builder.h"
+#include "wad_file.h"
+#include "wad_writer.h"
+
+// Builds nodes for the maps of a wad that have none or broken ones and writes everything as a
+// new PWAD. Lumps that do not change are copied as they are. -a rebuilds the nodes of every map.
+// With the output the same as the input, the new lumps are appended to the wad in place. UDMF maps
+// are copied as they are, their nodes would go into a ZNODES lump that is not written yet.
+//
+//	wad_nodes <input wad> <output wad> [-a] [-j threads]
+struct WadNodes {
+	WadNodes () {
+		is_rebuilding_all = false;
+		thread_count = 0;
+	}
+	
+	// Nodes that decode with every child in place.
+	static bool HasWorkingNodes (const DoomWad& wad, int map_index, const DoomMap& map) {
+		MapBsp bsp;
+		
+		if(!bsp.Decode(wad, map_index, map)) {
+			return false;
+		}
+		
+		for(const auto& node : bsp.nodes) {
+			if(DoomMap::no_index == node.children [0] || DoomMap::no_index == node.children [1]) {
+				return false;
+			}
+		}
+		
+		return true;
+	}
+	
+	// The map lumps in their order, with the new VERTEXES followed by the BSP lumps.
+	void AddBuiltMap (const DoomWad& wad, const DoomWad::MapInfo& map_info, const DoomMap& map, const NodeBuilder& builder) {
+		static const std::uint64_t vertexes_key = DoomWad::LumpKey("VERTEXES");
+		static const std::uint64_t segs_key = DoomWad::LumpKey("SEGS");
+		static const std::uint64_t ssectors_key = DoomWad::LumpKey("SSECTORS");
+		static const std::uint64_t nodes_key = DoomWad::LumpKey("NODES");
+		
+		std::vector <char> vertexes, segs, ssectors, nodes;
+		builder.WriteLumps(map, vertexes, segs, ssectors, nodes);
+		writer.AddLump(wad, map_info.marker_lump);
+		
+		for(int k = map_info.first_lump; k < map_info.end_lump; k++) {
+			auto key = wad.lump_keys [k];
+			
+			if(vertexes_key == key) {
+				writer.AddLump("VERTEXES", std::move(vertexes));
+				writer.AddLump("SEGS", std::move(segs));
+				writer.AddLump("SSECTORS", std::move(ssectors));
+				writer.AddLump("NODES", std::move(nodes));
+			}
+			
+			else if(segs_key != key && ssectors_key != key && nodes_key != key) {
+				writer.AddLump(wad, k);
+			}
+		}
+	}
+	
+	int Run (const std::string& input_path, const std::string& output_path) {
+		DoomWad wad(input_path);
+		
+		if(!wad.IsLoaded()) {
+			std::cout << "Can not read " << input_path << std::endl;
+			return 1;
+		}
+		
+		int map_index = 0;
+		int built_count = 0;
+		double build_seconds = 0;
+		DoomMap map;
+		NodeBuilder builder;
+		
+		for(int k = 0; k < wad.lump_count; k++) {
+			if(wad.maps.size() <= map_index || wad.maps [map_index].marker_lump != k) {
+				writer.AddLump(wad, k);
+				continue;
+			}
+			
+			const auto& map_info = wad.maps [map_index];
+			bool is_udmf = udmf_map_format == map_info.format;
+			std::cout << std::left << std::setw(10) << wad.LumpName(k) << std::right;
+			
+			if(!is_udmf) {
+				map.Decode(wad, map_index);
+			}
+			
+			bool is_kept = !is_udmf && !is_rebuilding_all && HasWorkingNodes(wad, map_index, map);
+			auto start = std::chrono::steady_clock::now();
+			
+			if(!is_udmf && !is_kept && builder.Build(map, thread_count)) {
+				std::chrono::duration <double> seconds = std::chrono::steady_clock::now() - start;
+				build_seconds += seconds.count();
+				built_count++;
+				
+				AddBuiltMap(wad, map_info, map, builder);
+				std::cout << std::setw(8) << map.LinedefCount() << " lines "
+					<< std::setw(8) << builder.SegCount() << " segs "
+					<< std::setw(8) << builder.SubsectorCount() << " subsectors "
+					<< std::setw(8) << builder.NodeCount() << " nodes, "
+					<< (builder.IsVanillaCompatible() ? "vanilla " : "extended")
+					<< std::fixed << std::setprecision(3) << std::setw(10) << 1e3 * seconds.count() << " ms" << std::endl;
+			}
+			
+			else {
+				writer.AddLump(wad, map_info.marker_lump);
+				
+				for(int l = map_info.first_lump; l < map_info.end_lump; l++) {
+					writer.AddLump(wad, l);
+				}
+				
+				std::cout << (is_udmf ? "UDMF, copied without new nodes" : is_kept ? "nodes kept" : "no lines, copied") << std::endl;
+			}
+			
+			k = map_info.end_lump - 1;
+			map_index++;
+		}
+		
+		// Writing over the input only appends the new lumps and directory.
+		std::error_code error;
+		bool is_in_place = std::filesystem::equivalent(input_path, output_path, error) && !error;
+		writer.is_iwad = is_in_place && std::equal(wad.header, wad.header + 4, "IWAD");
+		
+		if(is_in_place && 0 == built_count) {
+			std::cout << "No maps built, " << output_path << " left as it is" << std::endl;
+			return 0;
+		}
+		
+		if(!(is_in_place ? writer.WriteInPlace(output_path) : writer.Write(output_path))) {
+			std::cout << "Can not write " << output_path << std::endl;
+			return 1;
+		}
+		
+		std::cout << "Built " << built_count << " of " << wad.maps.size() << " maps in "
+			<< std::fixed << std::setprecision(3) << 1e3 * build_seconds << " ms, wrote "
+			<< writer.LumpCount() << " lumps to " << output_path << std::endl;
+		return 0;
+	}
+	
+	bool is_rebuilding_all;
+	int thread_count;
+	WadWriter writer;
+};
+
+int main (int argc, char * argv []) {
+	WadNodes nodes;
+	
+	if(argc < 3) {
+		std::cout << "Usage: wad_nodes <input wad> <output wad> [-a] [-j threads]" << std::endl;
+		return 1;
+	}
+	
+	for(int k = 3; k < argc; k++) {
+		std::string option = argv [k];
+		
+		if("-a" == option) {
+			nodes.is_rebuilding_all = true;
+		}
+		
+		else if("-j" == option && k + 1 < argc) {
+			nodes.thread_count = std::atoi(argv [++k]);
+		}
+	}
+	
+	return nodes.Run(argv [1], argv [2]);
+}
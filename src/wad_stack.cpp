@@ -0,0 +1,105 @@
+#include "wad_stack.h"
+#include <cstring>
+#include <utility>
+
+// Points the name at the ref, adding a slot for names not seen before.
+static void SetRef (LumpKeyTable& table, std::vector <WadStack::Ref>& refs, std::uint64_t key, WadStack::Ref ref) {
+	int slot = table.Insert(key, refs.size());
+	
+	if(slot == refs.size()) {
+		refs.push_back(ref);
+	}
+	
+	else {
+		refs [slot] = ref;
+	}
+}
+
+WadStack::WadStack () {
+	Clear();
+}
+
+void WadStack::Clear () {
+	wads.clear();
+	archives.clear();
+	lump_table.Reset(0);
+	lump_refs.clear();
+	map_table.Reset(0);
+	map_refs.clear();
+}
+
+bool WadStack::Push (const std::string& path) {
+	DoomWad wad(path);
+	
+	if(!wad.IsLoaded() && 4 <= wad.byte_count && 0 == std::memcmp(wad.bytes, "PK\x03\x04", 4)) {
+		return Push(ZipArchive(path));
+	}
+	
+	return Push(std::move(wad));
+}
+
+bool WadStack::Push (ZipArchive archive) {
+	auto map_wads = archive.OpenWads(archive.MapWadEntries());
+	
+	if(map_wads.empty()) {
+		return false;
+	}
+	
+	archives.push_back(std::move(archive));
+	bool is_any_pushed = false;
+	
+	for(auto& wad: map_wads) {
+		is_any_pushed = Push(std::move(wad)) || is_any_pushed;
+	}
+	
+	return is_any_pushed;
+}
+
+bool WadStack::Push (DoomWad wad) {
+	if(!wad.IsLoaded()) {
+		return false;
+	}
+	
+	int wad_index = wads.size();
+	wads.push_back(std::move(wad));
+	const auto& top = wads.back();
+	
+	// Only the distinct names of the new wad are visited, the wads below are not touched.
+	for(std::size_t name_id = 0; name_id + 1 < top.name_first.size(); name_id++) {
+		int lump = top.name_lumps [top.name_first [name_id + 1] - 1];
+		SetRef(lump_table, lump_refs, top.lump_keys [lump], { wad_index, lump });
+	}
+	
+	// Maps go in directory order, so a later marker of a name replaces an earlier one.
+	for(int m = 0; m < top.maps.size(); m++) {
+		SetRef(map_table, map_refs, top.maps [m].key, { wad_index, m });
+	}
+	
+	return true;
+}
+
+int WadStack::WadCount () const {
+	return wads.size();
+}
+
+const DoomWad& WadStack::Wad (int wad_index) const {
+	return wads [wad_index];
+}
+
+WadStack::Ref WadStack::FindLump (std::uint64_t key) const {
+	int slot = lump_table.Find(key);
+	return slot < 0 ? Ref { -1, -1 } : lump_refs [slot];
+}
+
+WadStack::Ref WadStack::FindMap (std::uint64_t key) const {
+	int slot = map_table.Find(key);
+	return slot < 0 ? Ref { -1, -1 } : map_refs [slot];
+}
+
+int WadStack::LumpNameCount () const {
+	return lump_refs.size();
+}
+
+int WadStack::MapCount () const {
+	return map_refs.size();
+}
@@ -0,0 +1,55 @@
+#ifndef WAD_STACK_H
+#define WAD_STACK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "wad_file.h"
+#include "zip_archive.h"
+
+// An ordered stack of wads, usually an IWAD with PWADs over it. Lumps and maps are found by name
+// through one merged index, where a name in a later wad hides the same name in the wads below.
+// Within a wad the last lump or map marker of a name wins, the way the original engine searches,
+// so a wad with a map twice shows the copy the game would load. The index is updated with the
+// names of every wad pushed, so a lookup costs one hash probe for any number of wads.
+struct WadStack {
+	WadStack ();
+	
+	void Clear ();
+	
+	// Wads that do not load are not pushed. Pushing moves the wads already on the stack, which
+	// keeps their lump data in place but not references to the wads themselves. A path to a zip
+	// archive such as a PK3 pushes the wads under its maps/ folder, in directory order.
+	bool Push (const std::string& path);
+	bool Push (DoomWad wad);
+	bool Push (ZipArchive archive);
+	
+	int WadCount () const;
+	const DoomWad& Wad (int wad_index) const;
+	
+	// A lump or map index into one of the wads. Both are -1 when nothing is found.
+	struct Ref {
+		int wad_index;
+		int index;
+	};
+	
+	Ref FindLump (std::uint64_t key) const;
+	Ref FindMap (std::uint64_t key) const;
+	
+	// Distinct names over all wads.
+	int LumpNameCount () const;
+	int MapCount () const;
+	
+	std::vector <DoomWad> wads;
+	
+	// Archives stay open for the wads that view their stored entries.
+	std::vector <ZipArchive> archives;
+	
+	// Merged index. The tables give a slot in the refs, which is overwritten by later wads.
+	LumpKeyTable lump_table;
+	std::vector <Ref> lump_refs;
+	LumpKeyTable map_table;
+	std::vector <Ref> map_refs;
+};
+
+#endif
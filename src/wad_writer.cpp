@@ -0,0 +1,506 @@
+#include "wad_writer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#ifdef __linux__
+	#include <sys/sendfile.h>
+#endif
+
+// Little endian 32 bit fields of the header and directory.
+static void Put32 (char* at, std::uint32_t value) {
+	for(int k = 0; k < 4; k++) {
+		at [k] = static_cast <char> (value >> (8 * k));
+	}
+}
+
+// Plain file output with the position kept by the system, so kernel copies and writes can
+// follow each other.
+struct WadOutputFile {
+	WadOutputFile ();
+	~WadOutputFile ();
+	
+	// Truncates, or opens the existing file for appending and patching.
+	bool Open (const std::string& path, bool is_existing);
+	void Close ();
+	
+	std::size_t SeekEnd ();
+	bool Write (const char* data, std::size_t size);
+	bool WriteAt (std::size_t offset, const char* data, std::size_t size);
+	bool Sync ();
+	
+	// Copies bytes of the source file to the output without them passing through the process.
+	// Returns how many were copied, the caller writes the rest.
+	std::size_t Copy (int source_handle, std::size_t offset, std::size_t size);
+	
+	static int OpenSource (const std::string& path);
+	static void CloseSource (int source_handle);
+
+#ifdef _WIN32
+	std::FILE* file;
+#else
+	int fd;
+#endif
+	bool is_good;
+};
+
+#ifdef _WIN32
+
+WadOutputFile::WadOutputFile () {
+	file = nullptr;
+	is_good = false;
+}
+
+bool WadOutputFile::Open (const std::string& path, bool is_existing) {
+	file = std::fopen(path.c_str(), is_existing ? "r+b" : "wb");
+	is_good = nullptr != file;
+	return is_good;
+}
+
+void WadOutputFile::Close () {
+	if(file) {
+		is_good = 0 == std::fclose(file) && is_good;
+	}
+	
+	file = nullptr;
+}
+
+std::size_t WadOutputFile::SeekEnd () {
+	is_good = is_good && 0 == _fseeki64(file, 0, SEEK_END);
+	return is_good ? _ftelli64(file) : 0;
+}
+
+bool WadOutputFile::Write (const char* data, std::size_t size) {
+	is_good = is_good && std::fwrite(data, 1, size, file) == size;
+	return is_good;
+}
+
+bool WadOutputFile::WriteAt (std::size_t offset, const char* data, std::size_t size) {
+	is_good = is_good && 0 == _fseeki64(file, offset, SEEK_SET) && std::fwrite(data, 1, size, file) == size;
+	return is_good;
+}
+
+bool WadOutputFile::Sync () {
+	is_good = is_good && 0 == std::fflush(file);
+	return is_good;
+}
+
+std::size_t WadOutputFile::Copy (int source_handle, std::size_t offset, std::size_t size) {
+	return 0;
+}
+
+int WadOutputFile::OpenSource (const std::string& path) {
+	return -1;
+}
+
+void WadOutputFile::CloseSource (int source_handle) {
+}
+
+#else
+
+WadOutputFile::WadOutputFile () {
+	fd = -1;
+	is_good = false;
+}
+
+bool WadOutputFile::Open (const std::string& path, bool is_existing) {
+	fd = open(path.c_str(), is_existing ? O_RDWR : O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	is_good = 0 <= fd;
+	return is_good;
+}
+
+void WadOutputFile::Close () {
+	if(0 <= fd) {
+		is_good = 0 == close(fd) && is_good;
+	}
+	
+	fd = -1;
+}
+
+std::size_t WadOutputFile::SeekEnd () {
+	off_t end = is_good ? lseek(fd, 0, SEEK_END) : -1;
+	is_good = 0 <= end;
+	return is_good ? end : 0;
+}
+
+bool WadOutputFile::Write (const char* data, std::size_t size) {
+	while(is_good && 0 < size) {
+		ssize_t count = write(fd, data, size);
+		is_good = 0 < count;
+		data += is_good ? count : 0;
+		size -= is_good ? count : 0;
+	}
+	
+	return is_good;
+}
+
+bool WadOutputFile::WriteAt (std::size_t offset, const char* data, std::size_t size) {
+	while(is_good && 0 < size) {
+		ssize_t count = pwrite(fd, data, size, offset);
+		is_good = 0 < count;
+		data += is_good ? count : 0;
+		offset += is_good ? count : 0;
+		size -= is_good ? count : 0;
+	}
+	
+	return is_good;
+}
+
+bool WadOutputFile::Sync () {
+	is_good = is_good && 0 == fsync(fd);
+	return is_good;
+}
+
+std::size_t WadOutputFile::Copy (int source_handle, std::size_t offset, std::size_t size) {
+	std::size_t copied = 0;
+
+#ifdef __linux__
+	if(!is_good || source_handle < 0) {
+		return 0;
+	}
+	
+	// copy_file_range shares the blocks on file systems that can, and copies in the page cache
+	// otherwise. It can refuse files on different file systems, sendfile takes those.
+	loff_t source_offset = offset;
+	
+	while(copied < size) {
+		ssize_t count = copy_file_range(source_handle, &source_offset, fd, nullptr, size - copied, 0);
+		
+		if(count <= 0) {
+			break;
+		}
+		
+		copied += count;
+	}
+	
+	off_t send_offset = offset + copied;
+	
+	while(copied < size) {
+		ssize_t count = sendfile(fd, source_handle, &send_offset, size - copied);
+		
+		if(count <= 0) {
+			break;
+		}
+		
+		copied += count;
+	}
+#endif
+	
+	return copied;
+}
+
+int WadOutputFile::OpenSource (const std::string& path) {
+	return open(path.c_str(), O_RDONLY);
+}
+
+void WadOutputFile::CloseSource (int source_handle) {
+	if(0 <= source_handle) {
+		close(source_handle);
+	}
+}
+
+#endif
+
+WadOutputFile::~WadOutputFile () {
+	Close();
+}
+
+WadWriter::WadWriter () {
+	is_iwad = false;
+	is_copying_in_kernel = true;
+}
+
+void WadWriter::Clear () {
+	*this = WadWriter();
+}
+
+void WadWriter::AddLump (const std::string& name, std::vector <char> data) {
+	InsertLump(entries.size(), name, std::move(data));
+}
+
+void WadWriter::AddLump (const DoomWad& wad, int lump_index) {
+	const auto& lump = wad.Lump(lump_index);
+	Entry entry;
+	entry.key = wad.lump_keys [lump_index];
+	entry.data = wad.IsLumpValid(lump) ? wad.LumpData(lump) : nullptr;
+	entry.size = entry.data ? lump.size : 0;
+	entry.owned_index = -1;
+	entry.source_index = -1;
+	entry.source_offset = entry.data ? lump.offset : 0;
+	
+	if(entry.data && !wad.path.empty()) {
+		auto source = std::find(source_paths.begin(), source_paths.end(), wad.path);
+		entry.source_index = source - source_paths.begin();
+		
+		if(source_paths.end() == source) {
+			source_paths.push_back(wad.path);
+		}
+	}
+	
+	entries.push_back(entry);
+}
+
+void WadWriter::AddWad (const DoomWad& wad) {
+	entries.reserve(entries.size() + wad.lump_count);
+	
+	for(int k = 0; k < wad.lump_count; k++) {
+		AddLump(wad, k);
+	}
+}
+
+int WadWriter::FindLump (const std::string& name, int from_lump) const {
+	auto key = DoomWad::LumpKey(name);
+	
+	for(int k = std::max(0, from_lump); k < entries.size(); k++) {
+		if(entries [k].key == key) {
+			return k;
+		}
+	}
+	
+	return -1;
+}
+
+bool WadWriter::ReplaceLump (int lump_index, std::vector <char> data) {
+	if(lump_index < 0 || entries.size() <= lump_index) {
+		return false;
+	}
+	
+	auto& entry = entries [lump_index];
+	
+	// A new lump replaced again reuses its slot.
+	if(entry.owned_index < 0) {
+		entry.owned_index = owned_data.size();
+		owned_data.emplace_back();
+	}
+	
+	entry.data = nullptr;
+	entry.size = data.size();
+	entry.source_index = -1;
+	entry.source_offset = 0;
+	owned_data [entry.owned_index] = std::move(data);
+	return true;
+}
+
+bool WadWriter::InsertLump (int lump_index, const std::string& name, std::vector <char> data) {
+	if(lump_index < 0 || entries.size() < lump_index) {
+		return false;
+	}
+	
+	Entry entry;
+	entry.key = DoomWad::LumpKey(name);
+	entry.data = nullptr;
+	entry.size = data.size();
+	entry.owned_index = owned_data.size();
+	entry.source_index = -1;
+	entry.source_offset = 0;
+	owned_data.push_back(std::move(data));
+	entries.insert(entries.begin() + lump_index, entry);
+	return true;
+}
+
+bool WadWriter::RemoveLump (int lump_index) {
+	if(lump_index < 0 || entries.size() <= lump_index) {
+		return false;
+	}
+	
+	// Owned data stays until Clear, so the indices of the other entries hold.
+	if(0 <= entries [lump_index].owned_index) {
+		owned_data [entries [lump_index].owned_index].clear();
+		owned_data [entries [lump_index].owned_index].shrink_to_fit();
+	}
+	
+	entries.erase(entries.begin() + lump_index);
+	return true;
+}
+
+bool WadWriter::RenameLump (int lump_index, const std::string& name) {
+	if(lump_index < 0 || entries.size() <= lump_index) {
+		return false;
+	}
+	
+	entries [lump_index].key = DoomWad::LumpKey(name);
+	return true;
+}
+
+// Directory of the entries at the given file offsets.
+static std::vector <char> BuildDirectory (const std::vector <WadWriter::Entry>& entries, const std::vector <std::size_t>& offsets) {
+	std::vector <char> directory(16 * entries.size());
+	
+	for(std::size_t k = 0; k < entries.size(); k++) {
+		char* record = directory.data() + 16 * k;
+		auto name = DoomWad::LumpKeyName(entries [k].key);
+		Put32(record, offsets [k]);
+		Put32(record + 4, entries [k].size);
+		std::memset(record + 8, 0, 8);
+		std::memcpy(record + 8, name.data(), std::min <std::size_t> (8, name.size()));
+	}
+	
+	return directory;
+}
+
+bool WadWriter::Write (const std::string& path) const {
+	std::size_t total_size = 12 + 16 * entries.size();
+	
+	for(const auto& entry : entries) {
+		total_size += entry.size;
+	}
+	
+	// Offsets in the directory are signed 32 bit.
+	if(0x7FFFFFFF < total_size) {
+		return false;
+	}
+	
+	std::vector <int> source_handles(source_paths.size(), -1);
+	
+	if(is_copying_in_kernel) {
+		for(std::size_t k = 0; k < source_paths.size(); k++) {
+			source_handles [k] = WadOutputFile::OpenSource(source_paths [k]);
+		}
+	}
+	
+	std::error_code error;
+	auto temp_path = UniqueTempPath(path);
+	bool is_written = false;
+	
+	{
+		WadOutputFile f;
+		std::vector <std::size_t> offsets(entries.size());
+		std::size_t offset = 12;
+		
+		// Lumps go straight out, the directory follows them and the header points to it.
+		char header [12] = {};
+		f.Open(temp_path, false);
+		f.Write(header, sizeof(header));
+		
+		for(std::size_t k = 0; k < entries.size(); ) {
+			const auto& entry = entries [k];
+			std::size_t run_size = entry.size;
+			std::size_t end = k + 1;
+			
+			// Lumps that follow each other in the same source file are one copy.
+			if(0 <= entry.source_index) {
+				while(end < entries.size() && entries [end].source_index == entry.source_index && entries [end].source_offset == entry.source_offset + run_size) {
+					run_size += entries [end].size;
+					end++;
+				}
+			}
+			
+			for(std::size_t l = k; l < end; l++) {
+				offsets [l] = offset;
+				offset += entries [l].size;
+			}
+			
+			const char* data = 0 <= entry.owned_index ? owned_data [entry.owned_index].data() : entry.data;
+			std::size_t copied = 0;
+			
+			if(0 <= entry.source_index) {
+				copied = f.Copy(source_handles [entry.source_index], entry.source_offset, run_size);
+			}
+			
+			if(copied < run_size) {
+				f.Write(data + copied, run_size - copied);
+			}
+			
+			k = end;
+		}
+		
+		auto directory = BuildDirectory(entries, offsets);
+		f.Write(directory.data(), directory.size());
+		
+		std::memcpy(header, is_iwad ? "IWAD" : "PWAD", 4);
+		Put32(header + 4, entries.size());
+		Put32(header + 8, offset);
+		f.WriteAt(0, header, sizeof(header));
+		f.Close();
+		is_written = f.is_good;
+	}
+	
+	for(int handle : source_handles) {
+		WadOutputFile::CloseSource(handle);
+	}
+	
+	if(is_written) {
+		std::filesystem::rename(temp_path, path, error);
+	}
+	
+	if(!is_written || error) {
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+	
+	return true;
+}
+
+bool WadWriter::WriteInPlace (const std::string& path) const {
+	std::vector <bool> is_source_in_place(source_paths.size());
+	std::error_code error;
+	
+	for(std::size_t k = 0; k < source_paths.size(); k++) {
+		is_source_in_place [k] = std::filesystem::equivalent(source_paths [k], path, error) && !error;
+	}
+	
+	// Every lump has to be new or already in the file.
+	std::size_t appended_size = 16 * entries.size();
+	
+	for(const auto& entry : entries) {
+		if(0 <= entry.owned_index) {
+			appended_size += entry.size;
+		}
+		
+		else if(0 < entry.size && (entry.source_index < 0 || !is_source_in_place [entry.source_index])) {
+			return false;
+		}
+	}
+	
+	WadOutputFile f;
+	
+	if(!f.Open(path, true)) {
+		return false;
+	}
+	
+	std::size_t offset = f.SeekEnd();
+	
+	if(!f.is_good || 0x7FFFFFFF < offset + appended_size) {
+		return false;
+	}
+	
+	std::vector <std::size_t> offsets(entries.size());
+	
+	for(std::size_t k = 0; k < entries.size(); k++) {
+		const auto& entry = entries [k];
+		
+		if(0 <= entry.owned_index) {
+			offsets [k] = offset;
+			offset += entry.size;
+			f.Write(owned_data [entry.owned_index].data(), entry.size);
+		}
+		
+		else {
+			offsets [k] = entry.source_offset;
+		}
+	}
+	
+	auto directory = BuildDirectory(entries, offsets);
+	f.Write(directory.data(), directory.size());
+	
+	// The old header stays valid until everything it will point to is on disk.
+	char header [12];
+	std::memcpy(header, is_iwad ? "IWAD" : "PWAD", 4);
+	Put32(header + 4, entries.size());
+	Put32(header + 8, offset);
+	f.Sync();
+	f.WriteAt(0, header, sizeof(header));
+	f.Sync();
+	f.Close();
+	return f.is_good;
+}
+
+int WadWriter::LumpCount () const {
+	return entries.size();
+}
@@ -0,0 +1,69 @@
+#ifndef WAD_WRITER_H
+#define WAD_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "wad_file.h"
+
+// Puts together a new wad from lumps of open wads and new data, and edits it lump by lump. Lumps
+// taken from a wad are never read into the writer, they remember where they are in the file and
+// get copied by the system when written, so that wad has to stay open until then.
+struct WadWriter {
+	WadWriter ();
+	
+	void Clear ();
+	
+	void AddLump (const std::string& name, std::vector <char> data);
+	void AddLump (const DoomWad& wad, int lump_index);
+	void AddWad (const DoomWad& wad);
+	
+	// Editing by position in the new directory. All return false for a position out of range.
+	int FindLump (const std::string& name, int from_lump = 0) const;
+	bool ReplaceLump (int lump_index, std::vector <char> data);
+	bool InsertLump (int lump_index, const std::string& name, std::vector <char> data);
+	bool RemoveLump (int lump_index);
+	bool RenameLump (int lump_index, const std::string& name);
+	
+	// Streams out all lumps in order and the directory at the end. Runs of lumps that lie
+	// back to back in a source file are copied in one go by the kernel. Written to the side and
+	// renamed over the path when complete, so the output can replace one of the input wads.
+	bool Write (const std::string& path) const;
+	
+	// Edits the wad at path in place when every lump taken from a wad comes from that file.
+	// Those lumps stay where they are, new lumps and the new directory are appended, and the
+	// header is rewritten last, so the wad is never left half written. The space of replaced
+	// lumps and of the old directory is not reused, a later Write packs the wad again. Returns
+	// false without touching the file when the lumps do not allow it.
+	bool WriteInPlace (const std::string& path) const;
+	
+	int LumpCount () const;
+	
+	struct Entry {
+		std::uint64_t key;
+		const char* data;
+		std::size_t size;
+		
+		// Index into owned_data for new lumps, -1 for lumps of a wad.
+		int owned_index;
+		
+		// Index into source_paths and the offset in that file for lumps of a wad read from a
+		// file, -1 otherwise.
+		int source_index;
+		std::size_t source_offset;
+	};
+	
+	// PWAD unless set to an IWAD.
+	bool is_iwad;
+	
+	// Copy lumps of source files with copy_file_range or sendfile. When off, or where the
+	// system has neither, the bytes go through write from the loaded wad.
+	bool is_copying_in_kernel;
+	
+	std::vector <Entry> entries;
+	std::vector <std::vector <char>> owned_data;
+	std::vector <std::string> source_paths;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "work_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+WorkPool::WorkPool (int thread_count) {
+	if(thread_count <= 0) {
+		thread_count = std::thread::hardware_concurrency();
+	}
+	
+	this->thread_count = std::max(1, thread_count);
+}
+
+void WorkPool::Run (int job_count, const std::function <void (int job, int thread)>& func) {
+	if(job_count <= 0) {
+		return;
+	}
+	
+	int used_thread_count = std::min(thread_count, job_count);
+	
+	// The jobs a thread still has to do. Padded to a cache line each so threads working on their
+	// own share do not slow each other down.
+	// Both ends only change under the mutex, but are read without it to pick whom to steal from.
+	struct alignas(64) JobShare {
+		std::mutex mutex;
+		std::atomic <int> begin;
+		std::atomic <int> end;
+	};
+	
+	std::vector <JobShare> shares(used_thread_count);
+	
+	for(int t = 0; t < used_thread_count; t++) {
+		shares [t].begin = static_cast <long long> (job_count) * t / used_thread_count;
+		shares [t].end = static_cast <long long> (job_count) * (t + 1) / used_thread_count;
+	}
+	
+	auto take_own_job = [&] (int thread, int& job) {
+		std::lock_guard <std::mutex> lock(shares [thread].mutex);
+		
+		if(shares [thread].begin < shares [thread].end) {
+			job = shares [thread].begin++;
+			return true;
+		}
+		
+		return false;
+	};
+	
+	// Move the back half of the largest other share over to this thread.
+	auto steal_jobs = [&] (int thread) {
+		while(true) {
+			int victim = -1;
+			int victim_count = 0;
+			
+			for(int t = 0; t < used_thread_count; t++) {
+				int count = shares [t].end - shares [t].begin;
+				
+				if(t != thread && victim_count < count) {
+					victim = t;
+					victim_count = count;
+				}
+			}
+			
+			if(victim < 0) {
+				return false;
+			}
+			
+			int begin = 0;
+			int end = 0;
+			
+			{
+				std::lock_guard <std::mutex> lock(shares [victim].mutex);
+				int count = shares [victim].end - shares [victim].begin;
+				
+				// Lost a race with the owner or another thief, look again.
+				if(count <= 0) {
+					continue;
+				}
+				
+				end = shares [victim].end;
+				begin = end - (count + 1) / 2;
+				shares [victim].end = begin;
+			}
+			
+			std::lock_guard <std::mutex> lock(shares [thread].mutex);
+			shares [thread].begin = begin;
+			shares [thread].end = end;
+			return true;
+		}
+	};
+	
+	auto thread_loop = [&] (int thread) {
+		int job = 0;
+		
+		while(true) {
+			if(take_own_job(thread, job)) {
+				func(job, thread);
+			}
+			
+			else if(!steal_jobs(thread)) {
+				return;
+			}
+		}
+	};
+	
+	std::vector <std::thread> threads;
+	
+	for(int t = 1; t < used_thread_count; t++) {
+		threads.emplace_back(thread_loop, t);
+	}
+	
+	thread_loop(0);
+	
+	for(auto& thread: threads) {
+		thread.join();
+	}
+}
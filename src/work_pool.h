@@ -0,0 +1,21 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <functional>
+
+// Runs a batch of independent jobs on all cores. Every thread starts with an even share of the
+// job indices and works through it from the front. A thread that runs out steals the back half
+// of the largest share left, so a few slow jobs do not leave the other cores idle.
+struct WorkPool {
+	
+	// Zero threads means one per core.
+	WorkPool (int thread_count = 0);
+	
+	// Call the function with every job index in [0, job_count) and the index of the thread that
+	// runs it. Returns when every job is done.
+	void Run (int job_count, const std::function <void (int job, int thread)>& func);
+	
+	int thread_count;
+};
+
+#endif
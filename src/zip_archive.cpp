@@ -0,0 +1,290 @@
+#include "zip_archive.h"
+#include "inflate.h"
+#include "work_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+// Record signatures and the fixed part of each record.
+static constexpr std::uint32_t local_header_signature = 0x04034B50;
+static constexpr std::uint32_t central_header_signature = 0x02014B50;
+static constexpr std::uint32_t end_record_signature = 0x06054B50;
+static constexpr std::uint32_t zip64_end_record_signature = 0x06064B50;
+static constexpr std::uint32_t zip64_locator_signature = 0x07064B50;
+static constexpr std::size_t local_header_size = 30;
+static constexpr std::size_t central_header_size = 46;
+static constexpr std::size_t end_record_size = 22;
+static constexpr std::size_t zip64_end_record_size = 56;
+static constexpr std::size_t zip64_locator_size = 20;
+
+// Extra field with the 64 bit values of the fields that are all ones in the header.
+static constexpr std::uint16_t zip64_extra_id = 0x0001;
+static constexpr std::uint32_t zip64_marker = 0xFFFFFFFF;
+
+static constexpr std::uint16_t stored_method = 0;
+static constexpr std::uint16_t deflated_method = 8;
+static constexpr std::uint16_t encrypted_flag = 0x0001;
+
+// Records are little endian and not aligned.
+template <typename T>
+static T ReadField (const char* p, std::size_t offset) {
+	T value;
+	std::memcpy(&value, p + offset, sizeof(T));
+	return value;
+}
+
+static std::string LowerCaseName (std::string name) {
+	for(auto& c: name) {
+		c = 'A' <= c && c <= 'Z' ? c - 'A' + 'a' : c;
+	}
+	
+	return name;
+}
+
+ZipArchive::ZipArchive () {
+	bytes = nullptr;
+	byte_count = 0;
+}
+
+ZipArchive::ZipArchive (const std::string& path) : path(path) {
+	if(mapping.Open(path)) {
+		bytes = mapping.data;
+		byte_count = mapping.size;
+		mapping.AdviseRandom();
+	}
+	
+	else {
+		SlurpByteFile(data, path);
+		bytes = data.data();
+		byte_count = data.size();
+	}
+	
+	ReadDirectory();
+}
+
+bool ZipArchive::ReadDirectory () {
+	entries.clear();
+	name_index.clear();
+	
+	if(byte_count < end_record_size) {
+		return false;
+	}
+	
+	// The end record is last, followed only by a comment of up to 64 kB.
+	std::size_t end_offset = byte_count - end_record_size;
+	std::size_t search_end = end_offset - std::min <std::size_t> (end_offset, 0xFFFF);
+	
+	while(end_record_signature != ReadField <std::uint32_t> (bytes, end_offset)) {
+		if(end_offset == search_end) {
+			return false;
+		}
+		
+		end_offset--;
+	}
+	
+	std::uint64_t entry_count = ReadField <std::uint16_t> (bytes, end_offset + 10);
+	std::uint64_t directory_size = ReadField <std::uint32_t> (bytes, end_offset + 12);
+	std::uint64_t directory_offset = ReadField <std::uint32_t> (bytes, end_offset + 16);
+	
+	// Archives with more entries or bytes than the end record holds have a zip64 end record,
+	// found through the locator in front of the end record.
+	if(
+	zip64_locator_size <= end_offset &&
+	zip64_locator_signature == ReadField <std::uint32_t> (bytes, end_offset - zip64_locator_size)) {
+		auto zip64_offset = ReadField <std::uint64_t> (bytes, end_offset - zip64_locator_size + 8);
+		
+		if(
+		zip64_end_record_size <= byte_count &&
+		zip64_offset <= byte_count - zip64_end_record_size &&
+		zip64_end_record_signature == ReadField <std::uint32_t> (bytes, zip64_offset)) {
+			entry_count = ReadField <std::uint64_t> (bytes, zip64_offset + 32);
+			directory_size = ReadField <std::uint64_t> (bytes, zip64_offset + 40);
+			directory_offset = ReadField <std::uint64_t> (bytes, zip64_offset + 48);
+		}
+	}
+	
+	if(byte_count < directory_offset || byte_count - directory_offset < directory_size) {
+		return false;
+	}
+	
+	// Only the directory is needed up front, entries are paged in when they are read.
+	if(mapping.IsOpen()) {
+		mapping.AdviseWillNeed(directory_offset, directory_size);
+	}
+	
+	const char* p = bytes + directory_offset;
+	const char* end = p + directory_size;
+	entries.reserve(std::min <std::uint64_t> (entry_count, directory_size / central_header_size));
+	name_index.reserve(entries.capacity());
+	
+	while(central_header_size <= static_cast <std::size_t> (end - p) && central_header_signature == ReadField <std::uint32_t> (p, 0)) {
+		std::size_t name_length = ReadField <std::uint16_t> (p, 28);
+		std::size_t extra_length = ReadField <std::uint16_t> (p, 30);
+		std::size_t comment_length = ReadField <std::uint16_t> (p, 32);
+		std::size_t record_size = central_header_size + name_length + extra_length + comment_length;
+		
+		if(static_cast <std::size_t> (end - p) < record_size) {
+			return false;
+		}
+		
+		Entry entry;
+		entry.name.assign(p + central_header_size, name_length);
+		entry.flags = ReadField <std::uint16_t> (p, 8);
+		entry.method = ReadField <std::uint16_t> (p, 10);
+		entry.crc = ReadField <std::uint32_t> (p, 16);
+		entry.compressed_size = ReadField <std::uint32_t> (p, 20);
+		entry.size = ReadField <std::uint32_t> (p, 24);
+		entry.local_offset = ReadField <std::uint32_t> (p, 42);
+		
+		// The zip64 field lists only the values that did not fit, in this order.
+		const char* extra = p + central_header_size + name_length;
+		const char* extra_end = extra + extra_length;
+		
+		while(4 <= extra_end - extra) {
+			std::size_t field_size = ReadField <std::uint16_t> (extra, 2);
+			const char* field = extra + 4;
+			const char* field_end = field + std::min <std::size_t> (field_size, extra_end - field);
+			
+			if(zip64_extra_id == ReadField <std::uint16_t> (extra, 0)) {
+				for(auto* value: { &entry.size, &entry.compressed_size, &entry.local_offset }) {
+					if(zip64_marker == *value && 8 <= field_end - field) {
+						*value = ReadField <std::uint64_t> (field, 0);
+						field += 8;
+					}
+				}
+			}
+			
+			extra = field + std::min <std::size_t> (field_size, extra_end - field);
+		}
+		
+		// Folders are entries of their own, with a name ending in a slash.
+		if(!entry.name.empty() && '/' != entry.name.back()) {
+			name_index.emplace(LowerCaseName(entry.name), entries.size());
+			entries.push_back(std::move(entry));
+		}
+		
+		p += record_size;
+	}
+	
+	return true;
+}
+
+bool ZipArchive::IsLoaded () const {
+	return !entries.empty();
+}
+
+int ZipArchive::FindEntry (const std::string& name) const {
+	auto found = name_index.find(LowerCaseName(name));
+	return name_index.end() == found ? -1 : found->second;
+}
+
+const char* ZipArchive::EntryData (int entry_index) const {
+	const auto& entry = entries [entry_index];
+	
+	if(byte_count < local_header_size || byte_count - local_header_size < entry.local_offset) {
+		return nullptr;
+	}
+	
+	// The local header repeats the name and has an extra field of its own, which can differ
+	// in length from the one in the directory.
+	const char* header = bytes + entry.local_offset;
+	
+	if(local_header_signature != ReadField <std::uint32_t> (header, 0)) {
+		return nullptr;
+	}
+	
+	std::uint64_t data_offset = entry.local_offset + local_header_size + ReadField <std::uint16_t> (header, 26) + ReadField <std::uint16_t> (header, 28);
+	
+	if(byte_count < data_offset || byte_count - data_offset < entry.compressed_size) {
+		return nullptr;
+	}
+	
+	return bytes + data_offset;
+}
+
+bool ZipArchive::IsStored (int entry_index) const {
+	const auto& entry = entries [entry_index];
+	return stored_method == entry.method && 0 == (entry.flags & encrypted_flag) && entry.size == entry.compressed_size;
+}
+
+bool ZipArchive::ReadEntry (int entry_index, std::vector <char>& out) const {
+	const auto& entry = entries [entry_index];
+	const char* entry_data = EntryData(entry_index);
+	out.clear();
+	
+	if(!entry_data || (entry.flags & encrypted_flag)) {
+		return false;
+	}
+	
+	if(IsStored(entry_index)) {
+		out.assign(entry_data, entry_data + entry.size);
+	}
+	
+	else if(deflated_method != entry.method || !InflateRaw(entry_data, entry.compressed_size, out, entry.size)) {
+		return false;
+	}
+	
+	return out.size() == entry.size && Crc32(out.data(), out.size()) == entry.crc;
+}
+
+bool ZipArchive::ReadEntries (const std::vector <int>& entry_indices, std::vector <std::vector <char>>& out, int thread_count) const {
+	std::atomic <bool> is_all_read(true);
+	out.resize(entry_indices.size());
+	WorkPool pool(thread_count);
+	
+	pool.Run(entry_indices.size(), [&] (int k, int thread) {
+		if(!ReadEntry(entry_indices [k], out [k])) {
+			is_all_read = false;
+		}
+	});
+	
+	return is_all_read;
+}
+
+std::vector <int> ZipArchive::MapWadEntries () const {
+	std::vector <int> map_wads;
+	
+	for(int k = 0; k < entries.size(); k++) {
+		auto name = LowerCaseName(entries [k].name);
+		
+		if(name.starts_with("maps/") && name.ends_with(".wad")) {
+			map_wads.push_back(k);
+		}
+	}
+	
+	return map_wads;
+}
+
+std::vector <DoomWad> ZipArchive::OpenWads (const std::vector <int>& entry_indices, int thread_count) const {
+	std::vector <DoomWad> wads(entry_indices.size());
+	std::vector <int> inflated_entries;
+	std::vector <int> inflated_wads;
+	
+	for(int k = 0; k < entry_indices.size(); k++) {
+		const char* entry_data = EntryData(entry_indices [k]);
+		
+		if(IsStored(entry_indices [k]) && entry_data) {
+			wads [k] = DoomWad(entry_data, entries [entry_indices [k]].size);
+		}
+		
+		else {
+			inflated_entries.push_back(entry_indices [k]);
+			inflated_wads.push_back(k);
+		}
+	}
+	
+	// Inflating is the slow part and every entry is independent. The wads are built on the same
+	// threads, reading their directories as well.
+	WorkPool pool(thread_count);
+	
+	pool.Run(inflated_entries.size(), [&] (int k, int thread) {
+		std::vector <char> wad_data;
+		
+		if(ReadEntry(inflated_entries [k], wad_data)) {
+			wads [inflated_wads [k]] = DoomWad(std::move(wad_data));
+		}
+	});
+	
+	return wads;
+}
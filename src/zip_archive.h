@@ -0,0 +1,72 @@
+#ifndef ZIP_ARCHIVE_H
+#define ZIP_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "file_helper.h"
+#include "wad_file.h"
+
+// Reader for zip archives, such as the PK3 files of source ports. The file is memory mapped and
+// opening reads only the end record and the central directory. Entries are inflated when asked
+// for, and entries that are stored without compression can be used where they lie.
+struct ZipArchive {
+	ZipArchive ();
+	ZipArchive (const std::string& path);
+	
+	// Finds the end record and reads the central directory into the entries.
+	bool ReadDirectory ();
+	bool IsLoaded () const;
+	
+	// Zip64 sizes and offsets are read into the same fields.
+	struct Entry {
+		std::string name;
+		std::uint64_t local_offset;
+		std::uint64_t compressed_size;
+		std::uint64_t size;
+		std::uint32_t crc;
+		std::uint16_t method;
+		std::uint16_t flags;
+	};
+	
+	// Names use forward slashes and are not case sensitive. Returns -1 when nothing is found.
+	int FindEntry (const std::string& name) const;
+	
+	// The bytes of an entry as stored, null when they do not lie inside the file.
+	const char* EntryData (int entry_index) const;
+	bool IsStored (int entry_index) const;
+	
+	// Copies or inflates an entry into out and checks its CRC. Only reads the archive, so
+	// threads can share one.
+	bool ReadEntry (int entry_index, std::vector <char>& out) const;
+	
+	// Reads every entry of the list on the work pool, out [k] gets entry_indices [k]. Returns
+	// false when any of them failed.
+	bool ReadEntries (const std::vector <int>& entry_indices, std::vector <std::vector <char>>& out, int thread_count = 0) const;
+	
+	// Wads under maps/, in directory order.
+	std::vector <int> MapWadEntries () const;
+	
+	// Opens wad entries as wads in memory, inflating the compressed ones on the work pool.
+	// Stored entries are views into the archive without a copy or a CRC check, the archive has
+	// to stay open for as long as those wads are used. Entries that fail give wads that are not
+	// loaded.
+	std::vector <DoomWad> OpenWads (const std::vector <int>& entry_indices, int thread_count = 0) const;
+	
+	std::string path;
+	
+	// Storage, as in DoomWad.
+	MappedFile mapping;
+	std::vector <char> data;
+	const char* bytes;
+	std::size_t byte_count;
+	
+	std::vector <Entry> entries;
+	
+	// Lower case names to entries.
+	std::unordered_map <std::string, int> name_index;
+};
+
+#endif